@@ -7,11 +7,90 @@
  */
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include "vlePlan.h"
+#include "vlePlanFeed.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption listenOption("listen",
+        "Receive activities from a live feed on local socket <name>.", "name");
+    QCommandLineOption producerOption("feed-producer",
+        "Send the plan <csv> to the live feed <name> (test producer), then exit.", "name");
+    QCommandLineOption rateOption("feed-rate",
+        "Number of activities per second sent by the test producer.", "rows", "0");
+    QCommandLineOption decodeOption("decode-names",
+        "Store VLE activity names (Operation@parcel:cycle#repeat) as compact keys.");
+    QCommandLineOption resolutionOption("resolution",
+        "Time resolution of plans : day, hour or minute.", "unit", "day");
+    QCommandLineOption gapsOption("compress-gaps",
+        "Replace periods of more than <days> without activity by breaks on the time axis.", "days", "0");
+    QCommandLineOption separatorOption("group-separator",
+        "Build a tree of groups by splitting their names with <sep> (like farm/parcel).", "sep");
+    QCommandLineOption orderOption("group-order",
+        "Custom order of groups : <file> contains one group name per line.", "file");
+    QCommandLineOption transformOption("transform",
+        "Post-process the generated plan : style:<selector>:<property>=<value>, "
+        "annotate:<selector>:<text> or filter:<attribute>=<pattern>. May be repeated.", "stage");
+    parser.addOption(listenOption);
+    parser.addOption(producerOption);
+    parser.addOption(rateOption);
+    parser.addOption(decodeOption);
+    parser.addOption(resolutionOption);
+    parser.addOption(gapsOption);
+    parser.addOption(separatorOption);
+    parser.addOption(orderOption);
+    parser.addOption(transformOption);
+    parser.addPositionalArgument("csv", "Plan file sent by --feed-producer.");
+    parser.process(a);
+
+    vlePlanTime::Resolution resolution;
+    if ( ! vlePlanTime::parseResolution(parser.value(resolutionOption), &resolution))
+        parser.showHelp(1);
+
+    // Stand-in for a running simulation : replay a CSV plan to a feed
+    if (parser.isSet(producerOption))
+    {
+        if (parser.positionalArguments().isEmpty())
+            parser.showHelp(1);
+        vlePlan plan;
+        plan.setResolution(resolution);
+        QString error;
+        if ( ! plan.loadFile(parser.positionalArguments().first(), &error))
+        {
+            qWarning() << "Failed to read plan :" << error;
+            return 1;
+        }
+        bool ok = vlePlanFeed::sendPlan(&plan, parser.value(producerOption),
+                                        parser.value(rateOption).toInt());
+        return (ok ? 0 : 1);
+    }
+
     MainWindow w;
+    w.setDecodeNames(parser.isSet(decodeOption));
+    w.setResolution(resolution);
+    w.setGapCompression(parser.value(gapsOption).toInt());
+    w.setGroupSeparator(parser.value(separatorOption));
+    if (parser.isSet(orderOption) && ( ! w.loadGroupOrder(parser.value(orderOption))))
+        qWarning() << "Failed to read group order from" << parser.value(orderOption);
+    QStringList stages = parser.values(transformOption);
+    for (int i = 0; i < stages.count(); i++)
+    {
+        SvgTransform *stage = SvgTransform::fromString(stages.at(i));
+        if ( ! stage)
+        {
+            qWarning() << "Invalid transform" << stages.at(i);
+            parser.showHelp(1);
+        }
+        w.addTransform(stage);
+    }
+    if (parser.isSet(listenOption))
+        w.listenFeed(parser.value(listenOption));
     w.show();
 
     return a.exec();
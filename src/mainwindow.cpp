@@ -5,10 +5,16 @@
  *
  * Copyright (c) 2016 Agilack
  */
+#include <QApplication>
 #include <QColorDialog>
+#include <QEventLoop>
 #include <QFile>
 #include <QFileDialog>
+#include <QFutureWatcher>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QtConcurrent>
 #include <QtXml>
 #include <QDebug>
 
@@ -19,33 +25,122 @@ MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
+    mFeed       = NULL;
+    mFeedGroups = 0;
+    mTplReload  = false;
+
     ui->setupUi(this);
     setWindowTitle("VLE plan Widget Unit-test");
 
+    // Statistics are shown into the configuration tab
+    mPlan.setStatistics(true);
+    // Compared runs are similar, they use the same strings table
+    mPlanCompare.shareStrings(&mPlan);
+
     // Set some default color values
     ui->svgUi->setConfig("color", "Irrigation", "#aa0000");
 
     connect(ui->buttonSelectCSV, SIGNAL(clicked(bool)), this, SLOT (buttonLoadCSV(bool)));
+    connect(ui->buttonCompareCSV,SIGNAL(clicked(bool)), this, SLOT (buttonCompareCSV(bool)));
     connect(ui->buttonSelectSVG, SIGNAL(clicked(bool)), this, SLOT (buttonLoadSVG(bool)));
     connect(ui->buttonConvert,   SIGNAL(clicked(bool)), this, SLOT (buttonConvert(bool)));
+    connect(ui->buttonExportPDF, SIGNAL(clicked(bool)), this, SLOT (buttonExportPDF(bool)));
+    connect(ui->buttonExportPNG, SIGNAL(clicked(bool)), this, SLOT (buttonExportPNG(bool)));
+    connect(ui->buttonExportSelection, SIGNAL(clicked(bool)), this, SLOT (buttonExportSelection(bool)));
+
+    // Templates can be edited live, changes are applied after a short delay
+    mTplTimer.setSingleShot(true);
+    mTplTimer.setInterval(300);
+    connect(&mTplTimer, SIGNAL(timeout()), this, SLOT(templateUpdate()));
+    connect(ui->svgEditHeader, SIGNAL(textChanged()), this, SLOT(templateEdited()));
+    connect(ui->svgEditTask,   SIGNAL(textChanged()), this, SLOT(templateEdited()));
+    connect(ui->svgEditTime,   SIGNAL(textChanged()), this, SLOT(templateEdited()));
+    connect(&mTplWatcher, SIGNAL(fileChanged(QString)), this, SLOT(templateFileChanged(QString)));
 
     // Configuration widget
     ui->planConfig->setDefaultColor("#1234cc");
     ui->planConfig->setView(ui->svgUi);
+    ui->planMinimap->setView(ui->svgUi);
+    ui->planPlayback->setView(ui->svgUi);
 }
 
 MainWindow::~MainWindow()
 {
+    if (mFeed)
+        mFeed->close();
     delete ui;
     mPlan.clear();
 }
 
+bool MainWindow::listenFeed(const QString &name)
+{
+    if (mFeed == NULL)
+    {
+        mFeed = new vlePlanFeed(&mPlan, this);
+        connect(mFeed, SIGNAL(planUpdated()), this, SLOT(feedUpdated()));
+    }
+    ui->csvFilename->setText(tr("Live feed : %1").arg(name));
+
+    return mFeed->listen(name);
+}
+
+void MainWindow::buttonCompareCSV(bool c)
+{
+    QString fileName;
+    bool ok;
+    (void)c;
+
+    if ( ! mPlan.isValid())
+    {
+        QMessageBox msg;
+        msg.setText("Plan not loaded, please specify a CSV");
+        msg.exec();
+        return;
+    }
+
+    // Show an "Open File" dialog for the run to compare
+    fileName = QFileDialog::getOpenFileName(this, tr("Open VLE Plan file to compare"), "", tr("CSV Files (*.csv *.csv.gz *.csv.zst)"));
+    if ( ! QFile(fileName).exists())
+        return;
+
+    QStringList modes;
+    modes << tr("Interleaved rows") << tr("Overlaid rows");
+    QString mode = QInputDialog::getItem(this, tr("Compare plans"), tr("Show groups as"),
+                                         modes, 0, false, &ok);
+    if ( ! ok)
+        return;
+
+    QString error;
+    if ( ! mPlanCompare.loadFile(fileName, &error))
+    {
+        QMessageBox msg;
+        msg.setText(tr("Failed to read %1 : %2").arg(fileName).arg(error));
+        msg.exec();
+    }
+    if ( ! mPlanCompare.isValid())
+        return;
+
+    QList<vlePlanSnapshot> plans;
+    plans << mPlan.snapshot() << mPlanCompare.snapshot();
+    ui->svgUi->loadPlans(plans, (mode == modes.at(0)) ? SvgView::Interleaved : SvgView::Overlaid);
+
+    // Show a summary of the differences
+    const vlePlanDiff &diff = ui->svgUi->diff();
+    QMessageBox msg;
+    msg.setText(tr("%1 activities added, %2 removed, %3 shifted, %4 unchanged")
+                .arg(diff.count(vlePlanDiff::Added))
+                .arg(diff.count(vlePlanDiff::Removed))
+                .arg(diff.count(vlePlanDiff::Shifted))
+                .arg(diff.count(vlePlanDiff::Same)));
+    msg.exec();
+}
+
 void MainWindow::buttonConvert(bool c)
 {
     (void)c;
 
     if (mPlan.isValid())
-        ui->svgUi->loadPlan(&mPlan);
+        ui->svgUi->loadPlan(mPlan.snapshot());
     else
     {
         QMessageBox msg;
@@ -54,28 +149,213 @@ void MainWindow::buttonConvert(bool c)
     }
 }
 
+void MainWindow::buttonExportPDF(bool c)
+{
+    QString fileName;
+    bool ok;
+    (void)c;
+
+    // Show a "Save File" dialog
+    fileName = QFileDialog::getSaveFileName(this, tr("Export PDF File"), "", tr("PDF Files (*.pdf)"));
+    if (fileName.isEmpty())
+        return;
+
+    // Ask the page layout : lines of groups, and time window of a page
+    int rows = QInputDialog::getInt(this, tr("Export PDF"), tr("Lines per page"),
+                                    40, 1, 500, 1, &ok);
+    if ( ! ok)
+        return;
+    int days = QInputDialog::getInt(this, tr("Export PDF"), tr("Days per page"),
+                                    31, 1, 36500, 1, &ok);
+    if ( ! ok)
+        return;
+
+    SvgExportPdf pdf;
+    ui->svgUi->exportPdf(&pdf, rows, days);
+    if (( ! runExport(&pdf, fileName, tr("Exporting PDF ..."))) && ( ! pdf.isCanceled()))
+    {
+        QMessageBox msg;
+        msg.setText(tr("PDF export failed : %1").arg(pdf.errorString()));
+        msg.exec();
+    }
+}
+
+void MainWindow::buttonExportPNG(bool c)
+{
+    QString fileName;
+    bool ok;
+    (void)c;
+
+    // Show a "Save File" dialog
+    fileName = QFileDialog::getSaveFileName(this, tr("Export PNG File"), "", tr("PNG Files (*.png)"));
+    if (fileName.isEmpty())
+        return;
+
+    // Ask the scale of the picture, relative to the current view
+    qreal scale = QInputDialog::getDouble(this, tr("Export PNG"), tr("Scale factor"),
+                                          1.0, 0.1, 1000.0, 2, &ok);
+    if ( ! ok)
+        return;
+
+    SvgExportPng png;
+    ui->svgUi->exportPng(&png, scale);
+    if (( ! runExport(&png, fileName, tr("Exporting PNG ..."))) && ( ! png.isCanceled()))
+    {
+        QMessageBox msg;
+        msg.setText(tr("PNG export failed : %1").arg(png.errorString()));
+        msg.exec();
+    }
+}
+
+bool MainWindow::runExport(SvgExport *exporter, const QString &fileName, const QString &label)
+{
+    QProgressDialog progress(label, tr("Cancel"), 0, 100, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+
+    // The export runs on a worker thread, the GUI keeps processing events
+    // and shows its progress until it has finished
+    QFutureWatcher<bool> watcher;
+    QEventLoop loop;
+    QTimer     timer;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    connect(&timer,   SIGNAL(timeout()),  &loop, SLOT(quit()));
+    timer.start(100);
+    watcher.setFuture(QtConcurrent::run(exporter, &SvgExport::save, fileName));
+    while ( ! watcher.isFinished())
+    {
+        loop.exec();
+        if (progress.wasCanceled())
+            exporter->cancel();
+        progress.setValue(exporter->progress());
+    }
+    return watcher.result();
+}
+
+void MainWindow::buttonExportSelection(bool c)
+{
+    (void)c;
+
+    if (ui->svgUi->selectionCount() == 0)
+    {
+        QMessageBox msg;
+        msg.setText(tr("No activity selected (click, or shift + drag on the timeline)"));
+        msg.exec();
+        return;
+    }
+
+    // Show a "Save File" dialog
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export selection"), "", tr("CSV Files (*.csv)"));
+    if (fileName.isEmpty())
+        return;
+
+    QString error;
+    if ( ! ui->svgUi->exportSelection(fileName, &error))
+    {
+        QMessageBox msg;
+        msg.setText(tr("Selection export failed : %1").arg(error));
+        msg.exec();
+    }
+}
+
+void MainWindow::setDecodeNames(bool enable)
+{
+    mPlan.setDecodeNames(enable);
+}
+
+void MainWindow::setResolution(vlePlanTime::Resolution resolution)
+{
+    // Compared plans must use the same ticks
+    mPlan.setResolution(resolution);
+    mPlanCompare.setResolution(resolution);
+}
+
+void MainWindow::setGapCompression(int minDays)
+{
+    ui->svgUi->setGapCompression(minDays);
+}
+
+void MainWindow::setGroupSeparator(const QString &separator)
+{
+    ui->svgUi->setGroupSeparator(separator);
+}
+
+void MainWindow::addTransform(SvgTransform *stage)
+{
+    // Stages are applied to the parts of the plan when they are generated
+    ui->svgUi->transforms()->append(stage);
+}
+
+bool MainWindow::loadGroupOrder(const QString &fileName)
+{
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    // One group name per line, used by the "Custom" order
+    QStringList names;
+    while ( ! file.atEnd())
+    {
+        QString name = QString::fromUtf8(file.readLine()).trimmed();
+        if ( ! name.isEmpty())
+            names.append(name);
+    }
+    ui->svgUi->order()->setCustomOrder(names);
+    return true;
+}
+
+void MainWindow::feedUpdated(void)
+{
+    // Last published version of the plan
+    vlePlanSnapshot snapshot = mFeed->snapshot();
+
+    // Update ui to show Plan statistics
+    ui->labelGroupCount->setText   (QString::number(snapshot->countGroups()));
+    ui->labelActivityCount->setText(QString::number(snapshot->countActivities()));
+
+    // When groups are added (or after a reset) refresh the config widget
+    if (snapshot->countGroups() != mFeedGroups)
+    {
+        mFeedGroups = snapshot->countGroups();
+        ui->planConfig->setPlan(snapshot);
+    }
+
+    // Refresh the view (if a template has been loaded) with the last version
+    ui->planStats->setPlan(snapshot);
+    if (snapshot->isValid())
+        ui->svgUi->loadPlan(snapshot);
+}
+
 void MainWindow::buttonLoadCSV(bool c)
 {
     QString fileName;
     (void)c;
 
     // Show an "Open File" dialog
-    fileName = QFileDialog::getOpenFileName(this, tr("Open VLE Plan file"), "", tr("CSV Files (*.csv)"));
+    fileName = QFileDialog::getOpenFileName(this, tr("Open VLE Plan file"), "", tr("CSV Files (*.csv *.csv.gz *.csv.zst)"));
     // Update filename text-box
     ui->csvFilename->setText(fileName);
 
     // If the selected file exists ...
     if (QFile(fileName).exists())
     {
-        // ... load it
-        mPlan.loadFile(fileName);
+        // ... load it (a truncated file is shown up to the error)
+        QString error;
+        if ( ! mPlan.loadFile(fileName, &error))
+        {
+            QMessageBox msg;
+            msg.setText(tr("Failed to read %1 : %2").arg(fileName).arg(error));
+            msg.exec();
+        }
 
         // Update ui to show Plan statistics
         ui->labelGroupCount->setText   (QString::number(mPlan.countGroups()));
         ui->labelActivityCount->setText(QString::number(mPlan.countActivities()));
     }
     // Inform config widget that a new plan is available
-    ui->planConfig->setPlan(&mPlan);
+    vlePlanSnapshot snapshot = mPlan.snapshot();
+    ui->planConfig->setPlan(snapshot);
+    ui->planStats->setPlan(snapshot);
 }
 
 void MainWindow::buttonLoadSVG(bool c)
@@ -93,18 +373,90 @@ void MainWindow::buttonLoadSVG(bool c)
     {
         // ... load it
         ui->svgUi->loadTemplate(fileName);
+        showTemplates();
+
+        // Follow modifications made by an external editor
+        if ( ! mTplWatcher.files().isEmpty())
+            mTplWatcher.removePaths(mTplWatcher.files());
+        mTplWatcher.addPath(fileName);
+        mTplDirty.clear();
+        mTplReload = false;
+    }
+}
+
+void MainWindow::showTemplates(void)
+{
+    // Text-boxes are updated from the view, this is not an edition
+    ui->svgEditHeader->blockSignals(true);
+    ui->svgEditTask  ->blockSignals(true);
+    ui->svgEditTime  ->blockSignals(true);
+
+    // Dump template header to ui text-box
+    ui->svgEditHeader->clear();
+    ui->svgEditHeader->appendPlainText( ui->svgUi->getTplHeader() );
+    ui->svgEditHeader->moveCursor(QTextCursor::Start);
+    // Dump template task to ui text-box
+    ui->svgEditTask->clear();
+    ui->svgEditTask->appendPlainText( ui->svgUi->getTplTask() );
+    ui->svgEditTask->moveCursor(QTextCursor::Start);
+    // Dump template time to ui text-box
+    ui->svgEditTime->clear();
+    ui->svgEditTime->appendPlainText( ui->svgUi->getTplTime() );
+    ui->svgEditTime->moveCursor(QTextCursor::Start);
 
-        // Dump template header to ui text-box
-        ui->svgEditHeader->clear();
-        ui->svgEditHeader->appendPlainText( ui->svgUi->getTplHeader() );
-        ui->svgEditHeader->moveCursor(QTextCursor::Start);
-        // Dump template task to ui text-box
-        ui->svgEditTask->clear();
-        ui->svgEditTask->appendPlainText( ui->svgUi->getTplTask() );
-        ui->svgEditTask->moveCursor(QTextCursor::Start);
-        // Dump template time to ui text-box
-        ui->svgEditTime->clear();
-        ui->svgEditTime->appendPlainText( ui->svgUi->getTplTime() );
-        ui->svgEditTime->moveCursor(QTextCursor::Start);
+    ui->svgEditHeader->blockSignals(false);
+    ui->svgEditTask  ->blockSignals(false);
+    ui->svgEditTime  ->blockSignals(false);
+}
+
+void MainWindow::templateEdited(void)
+{
+    if (sender() == ui->svgEditHeader)
+        mTplDirty.insert("header");
+    else if (sender() == ui->svgEditTask)
+        mTplDirty.insert("task");
+    else if (sender() == ui->svgEditTime)
+        mTplDirty.insert("time");
+
+    // Restart the delay, the template is compiled when typing stops
+    mTplTimer.start();
+}
+
+void MainWindow::templateFileChanged(const QString &path)
+{
+    // Many editors replace the file : the watcher must follow the new one
+    if (( ! mTplWatcher.files().contains(path)) && QFile::exists(path))
+        mTplWatcher.addPath(path);
+
+    mTplReload = true;
+    mTplTimer.start();
+}
+
+void MainWindow::templateUpdate(void)
+{
+    // A modified file replaces the templates edited into text-boxes
+    if (mTplReload)
+    {
+        mTplReload = false;
+        mTplDirty.clear();
+        if (ui->svgUi->reloadTemplate(ui->tplFilename->text()))
+            showTemplates();
+        return;
+    }
+
+    QSetIterator<QString> it(mTplDirty);
+    while (it.hasNext())
+    {
+        QString name = it.next();
+        QString xml;
+        if (name == "header")
+            xml = ui->svgEditHeader->toPlainText();
+        else if (name == "task")
+            xml = ui->svgEditTask->toPlainText();
+        else
+            xml = ui->svgEditTime->toPlainText();
+        // An invalid template (while typing) is ignored, the old one is kept
+        ui->svgUi->setTemplate(name, xml);
     }
+    mTplDirty.clear();
 }
@@ -8,12 +8,18 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QFileSystemWatcher>
 #include <QMainWindow>
+#include <QSet>
+#include <QTimer>
+#include "svgtransform.h"
 #include "vlePlan.h"
+#include "vlePlanFeed.h"
 
 namespace Ui {
 class MainWindow;
 }
+class SvgExport;
 
 class MainWindow : public QMainWindow
 {
@@ -22,15 +28,41 @@ class MainWindow : public QMainWindow
 public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
+    bool listenFeed(const QString &name);
+    void setDecodeNames(bool enable);
+    void setResolution(vlePlanTime::Resolution resolution);
+    void setGapCompression(int minDays);
+    void setGroupSeparator(const QString &separator);
+    void addTransform(SvgTransform *stage);
+    bool loadGroupOrder(const QString &fileName);
 
 private slots:
     void buttonLoadCSV(bool c);
+    void buttonCompareCSV(bool c);
     void buttonLoadSVG(bool c);
     void buttonConvert(bool c);
+    void buttonExportPDF(bool c);
+    void buttonExportPNG(bool c);
+    void buttonExportSelection(bool c);
+    void feedUpdated(void);
+    void templateEdited(void);
+    void templateFileChanged(const QString &path);
+    void templateUpdate(void);
 
 private:
     Ui::MainWindow *ui;
     vlePlan mPlan;
+    vlePlan mPlanCompare;  // Second run, compared with mPlan
+    vlePlanFeed *mFeed;
+    int          mFeedGroups; // Groups count at last feed update
+    // Live edition of the templates
+    QFileSystemWatcher mTplWatcher;
+    QTimer             mTplTimer;   // Wait the end of a burst of changes
+    QSet<QString>      mTplDirty;   // Templates edited into the text-boxes
+    bool               mTplReload;  // Template file modified on disk
+private:
+    bool runExport(SvgExport *exporter, const QString &fileName, const QString &label);
+    void showTemplates(void);
 };
 
 #endif // MAINWINDOW_H
@@ -4,7 +4,7 @@
 #
 #-------------------------------
 
-QT       += core gui svg xml xmlpatterns
+QT       += core gui svg xml concurrent network printsupport
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -14,14 +14,65 @@ TEMPLATE = app
 SOURCES += main.cpp\
         mainwindow.cpp \
     svgview.cpp \
+    svgexport.cpp \
+    svgminimap.cpp \
+    svgplayback.cpp \
+    svgtiles.cpp \
+    svgtransform.cpp \
     vlePlan.cpp \
-    svgconfig.cpp
+    vlePlanAxis.cpp \
+    vlePlanDensity.cpp \
+    vlePlanDiff.cpp \
+    vlePlanFeed.cpp \
+    vlePlanFilter.cpp \
+    vlePlanLayout.cpp \
+    vlePlanNames.cpp \
+    vlePlanOrder.cpp \
+    vlePlanSchema.cpp \
+    vlePlanStats.cpp \
+    vlePlanStream.cpp \
+    vlePlanSweep.cpp \
+    vlePlanTime.cpp \
+    vlePlanTree.cpp \
+    svgconfig.cpp \
+    svgstats.cpp
 
 HEADERS  += mainwindow.h \
     svgview.h \
+    svgexport.h \
+    svgminimap.h \
+    svgplayback.h \
+    svgtiles.h \
+    svgtransform.h \
     vlePlan.h \
-    svgconfig.h
+    vlePlanAxis.h \
+    vlePlanDensity.h \
+    vlePlanDiff.h \
+    vlePlanFeed.h \
+    vlePlanFilter.h \
+    vlePlanLayout.h \
+    vlePlanNames.h \
+    vlePlanOrder.h \
+    vlePlanPool.h \
+    vlePlanSchema.h \
+    vlePlanStats.h \
+    vlePlanStream.h \
+    vlePlanSweep.h \
+    vlePlanTime.h \
+    vlePlanTree.h \
+    svgconfig.h \
+    svgstats.h
 
 FORMS    += mainwindow.ui
 
+# zlib is used to stream large PNG exports and to read gzip plans
+LIBS     += -lz
+
+# Optional zstd support for compressed plans
+packagesExist(libzstd) {
+    DEFINES   += VLE_HAVE_ZSTD
+    CONFIG    += link_pkgconfig
+    PKGCONFIG += libzstd
+}
+
 CONFIG   += console
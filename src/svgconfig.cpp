@@ -8,6 +8,7 @@
 #include <QColorDialog>
 #include <QtWidgets/QHBoxLayout>
 #include <QtWidgets/QHeaderView>
+#include <QtWidgets/QLabel>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QVBoxLayout>
 #include "svgconfig.h"
@@ -15,8 +16,10 @@
 
 svgConfig::svgConfig(QWidget *parent) : QWidget(parent)
 {
-    mPlan         = 0;
     mUiColorTable = 0;
+    mUiFilterGroup  = 0;
+    mUiFilterSearch = 0;
+    mUiOrder        = 0;
     mViewWidget   = 0;
 
     mDefaultColor = "#000000";
@@ -25,11 +28,16 @@ svgConfig::svgConfig(QWidget *parent) : QWidget(parent)
 
     connect(mUiColorTable, SIGNAL(itemSelectionChanged()), this, SLOT(colorSelectionChange()));
     connect(mUiColorTable, SIGNAL(cellDoubleClicked(int,int)), this, SLOT(colorSelectionEdit(int,int)));
+    connect(mUiColorTable, SIGNAL(itemChanged(QTableWidgetItem*)), this, SLOT(filterClassChange(QTableWidgetItem*)));
+    connect(mUiFilterGroup,  SIGNAL(textChanged(QString)), this, SLOT(filterGroupChange(QString)));
+    connect(mUiFilterSearch, SIGNAL(textChanged(QString)), this, SLOT(filterSearchChange(QString)));
+    connect(mUiOrder,        SIGNAL(currentIndexChanged(int)), this, SLOT(orderChange(int)));
 }
 
 void svgConfig::clear(void)
 {
     mUiColorTable->clear();
+    mUiColorTable->setRowCount(0);
 
     // Insert default headers
     QTableWidgetItem *h0 = new QTableWidgetItem();
@@ -83,15 +91,73 @@ void svgConfig::colorSelectionEdit(int row, int col)
     }
 }
 
+void svgConfig::filterClassChange(QTableWidgetItem *item)
+{
+    // Only the check box of the name column is a filter
+    if (item->column() != 0)
+        return;
+
+    QSet<QString> classes;
+    bool allChecked = true;
+
+    for (int i = 0; i < mUiColorTable->rowCount(); i++)
+    {
+        QTableWidgetItem *nameItem = mUiColorTable->item(i, 0);
+        if (nameItem == NULL)
+            continue;
+        if (nameItem->checkState() == Qt::Checked)
+            classes.insert(nameItem->text());
+        else
+            allChecked = false;
+    }
+    if (mViewWidget)
+    {
+        // If all classes are checked, there is no class filter (and if
+        // none is checked, no activity is shown)
+        if (allChecked)
+            mViewWidget->filter()->clearClasses();
+        else
+            mViewWidget->filter()->setClasses(classes);
+        mViewWidget->reload();
+    }
+}
+
+void svgConfig::filterGroupChange(const QString &pattern)
+{
+    if (mViewWidget)
+    {
+        mViewWidget->filter()->setGroupPattern(pattern);
+        mViewWidget->reload();
+    }
+}
+
+void svgConfig::filterSearchChange(const QString &term)
+{
+    if (mViewWidget)
+    {
+        mViewWidget->filter()->setSearch(term);
+        mViewWidget->reload();
+    }
+}
+
+void svgConfig::orderChange(int index)
+{
+    // Items of the combo box follow the order keys
+    if (mViewWidget)
+        mViewWidget->setOrder((vlePlanOrder::Key)index);
+}
+
 void svgConfig::setDefaultColor(QString name)
 {
     mDefaultColor = name;
 }
 
-void svgConfig::setPlan(vlePlan *plan)
+void svgConfig::setPlan(const vlePlanSnapshot &plan)
 {
     mPlan = plan;
 
+    // Table is filled with signals blocked (no filter update during insert)
+    mUiColorTable->blockSignals(true);
     clear();
 
     QList<QString> knownClasses;
@@ -100,11 +166,10 @@ void svgConfig::setPlan(vlePlan *plan)
     for (int i=0; i < mPlan->countGroups(); i++)
     {
         vlePlanGroup *planGroup = mPlan->getGroup(i);
-        for (int j = 0; j < planGroup->count(); j++)
+        for (vlePlanActivity *planActivity : *planGroup)
         {
-            vlePlanActivity *planActivity = planGroup->getActivity(j);
             // Get the activity class
-            QString className = planActivity->getClass();
+            const QString &className = planActivity->getClass();
             // If this class has already been seen, nothing to do
             if (knownClasses.contains(className))
                 continue;
@@ -116,7 +181,8 @@ void svgConfig::setPlan(vlePlan *plan)
             mUiColorTable->insertRow(count);
             // Set name for this new class
             QTableWidgetItem *nameItem  = new QTableWidgetItem(className);
-            nameItem->setFlags(nameItem->flags() ^ Qt::ItemIsEditable);
+            nameItem->setFlags((nameItem->flags() ^ Qt::ItemIsEditable) | Qt::ItemIsUserCheckable);
+            nameItem->setCheckState(Qt::Checked);
             mUiColorTable->setItem(count, 0, nameItem);
             // Set color name for this new class
             QTableWidgetItem *colorItem = new QTableWidgetItem(mDefaultColor);
@@ -135,6 +201,11 @@ void svgConfig::setPlan(vlePlan *plan)
                 mViewWidget->setConfig("color", className, mDefaultColor);
         }
     }
+    mUiColorTable->blockSignals(false);
+
+    // No classes criteria for the new plan (the view gives its plans to the filter)
+    if (mViewWidget)
+        mViewWidget->filter()->clearClasses();
 }
 
 void svgConfig::setView(SvgView *view)
@@ -165,6 +236,31 @@ void svgConfig::setupUi(void)
     clear();
     vLayoutMain->addWidget(mUiColorTable);
 
+    // Create an horizontal layout for filter controls
+    QHBoxLayout *hLayoutFilter = new QHBoxLayout();
+    hLayoutFilter->setSpacing(6);
+    hLayoutFilter->setObjectName(QStringLiteral("hLayoutFilter"));
+    hLayoutFilter->addWidget(new QLabel(tr("Groups"), this));
+    mUiFilterGroup = new QLineEdit(this);
+    mUiFilterGroup->setObjectName(QStringLiteral("filterGroup"));
+    mUiFilterGroup->setPlaceholderText(tr("Name pattern, ex: p4*"));
+    hLayoutFilter->addWidget(mUiFilterGroup);
+    hLayoutFilter->addWidget(new QLabel(tr("Search"), this));
+    mUiFilterSearch = new QLineEdit(this);
+    mUiFilterSearch->setObjectName(QStringLiteral("filterSearch"));
+    mUiFilterSearch->setPlaceholderText(tr("Text into activity attributes"));
+    hLayoutFilter->addWidget(mUiFilterSearch);
+    hLayoutFilter->addWidget(new QLabel(tr("Order"), this));
+    mUiOrder = new QComboBox(this);
+    mUiOrder->setObjectName(QStringLiteral("groupOrder"));
+    mUiOrder->addItem(tr("Plan"));
+    mUiOrder->addItem(tr("Name"));
+    mUiOrder->addItem(tr("First activity"));
+    mUiOrder->addItem(tr("Activity time"));
+    mUiOrder->addItem(tr("Custom"));
+    hLayoutFilter->addWidget(mUiOrder);
+    vLayoutMain->addLayout(hLayoutFilter);
+
 #ifdef UI_EXTEND
     QHBoxLayout *hLayoutButtons;
     // Create an horizontal layout for additional controls
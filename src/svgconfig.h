@@ -8,6 +8,8 @@
 #ifndef SVGCONFIG_H
 #define SVGCONFIG_H
 
+#include <QComboBox>
+#include <QLineEdit>
 #include <QTableWidget>
 #include <QWidget>
 #include "svgview.h"
@@ -20,17 +22,24 @@ public:
     explicit svgConfig(QWidget *parent = 0);
     void clear(void);
     void setDefaultColor(QString name);
-    void setPlan(vlePlan *plan);
+    void setPlan(const vlePlanSnapshot &plan);
     void setView(SvgView *view);
 private:
     void setupUi(void);
 private slots:
     void colorSelectionChange();
     void colorSelectionEdit(int row, int col);
+    void filterClassChange (QTableWidgetItem *item);
+    void filterGroupChange (const QString &pattern);
+    void filterSearchChange(const QString &term);
+    void orderChange(int index);
 private:
-    vlePlan      *mPlan;
+    vlePlanSnapshot mPlan;
     QString       mDefaultColor;
     QTableWidget *mUiColorTable;
+    QLineEdit    *mUiFilterGroup;
+    QLineEdit    *mUiFilterSearch;
+    QComboBox    *mUiOrder;
     SvgView      *mViewWidget;
 };
 
@@ -0,0 +1,552 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QFile>
+#include <QFuture>
+#include <QImage>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QQueue>
+#include <QSvgRenderer>
+#include <QThreadPool>
+#include <QXmlStreamReader>
+#include <QtConcurrent>
+#include <QtMath>
+#include <zlib.h>
+#include <algorithm>
+#include "svgexport.h"
+
+// Parameters of one strip to render
+struct SvgExportJob
+{
+    const void *owner;
+    QByteArray  document;   // Part of the document drawn into the strip
+    bool        shared;     // Same document for all strips (plain file)
+    QSize       documentSize;
+    qreal       scale;
+    int         width;
+    int         y;
+    int         height;
+    bool        last;
+};
+
+// Compressed result of one strip
+struct SvgExportStrip
+{
+    QByteArray data;    // Raw deflate data
+    uLong      adler;   // Adler32 of the uncompressed rows
+    qint64     length;  // Size of the uncompressed rows
+};
+
+static void appendUInt32(QByteArray &data, quint32 value)
+{
+    data.append((char)((value >> 24) & 0xFF));
+    data.append((char)((value >> 16) & 0xFF));
+    data.append((char)((value >>  8) & 0xFF));
+    data.append((char)( value        & 0xFF));
+}
+
+static SvgExportStrip exportStrip(const SvgExportJob &job)
+{
+    SvgExportStrip strip;
+
+    // A shared document is parsed once by each thread, a part by its strip
+    QSvgRenderer  stripRenderer;
+    QSvgRenderer *renderer = &stripRenderer;
+    if (job.shared)
+        renderer = SvgTiles::threadRenderer(job.owner, 0, job.document);
+    else
+    {
+        QXmlStreamReader xData(job.document);
+        stripRenderer.load(&xData);
+    }
+
+    QImage image(job.width, job.height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    renderer->setViewBox(QRectF(0, (job.y / job.scale),
+                                job.documentSize.width(), (job.height / job.scale)));
+    renderer->render(&painter, QRectF(0, 0, job.width, job.height));
+    painter.end();
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+
+    // Convert to PNG rows : one filter byte (none) followed by pixels
+    int rowBytes = (job.width * 4);
+    QByteArray raw;
+    raw.resize(job.height * (rowBytes + 1));
+    for (int i = 0; i < job.height; i++)
+    {
+        char *row = raw.data() + (i * (rowBytes + 1));
+        row[0] = 0;
+        memcpy(row + 1, image.constScanLine(i), rowBytes);
+    }
+    strip.length = raw.size();
+    strip.adler  = adler32(adler32(0, Z_NULL, 0), (const Bytef *)raw.constData(), raw.size());
+
+    // Compress as raw deflate blocks. Strips are flushed on a byte
+    // boundary, so they can be concatenated into one deflate stream.
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    strip.data.resize(deflateBound(&z, raw.size()) + 16);
+    z.next_in   = (Bytef *)raw.data();
+    z.avail_in  = raw.size();
+    z.next_out  = (Bytef *)strip.data.data();
+    z.avail_out = strip.data.size();
+    deflate(&z, job.last ? Z_FINISH : Z_SYNC_FLUSH);
+    strip.data.resize(z.total_out);
+    deflateEnd(&z);
+
+    return strip;
+}
+
+// ******************** Export (base) ******************** //
+
+SvgExport::SvgExport()
+    : mCanceled(0),
+    mProgress(0)
+{
+    // Nothing to do
+}
+
+SvgExport::~SvgExport()
+{
+    // Nothing to do
+}
+
+void SvgExport::cancel(void)
+{
+    mCanceled.storeRelease(1);
+}
+
+QString SvgExport::errorString(void) const
+{
+    return mError;
+}
+
+bool SvgExport::isCanceled(void) const
+{
+    return (mCanceled.loadAcquire() != 0);
+}
+
+int SvgExport::progress(void) const
+{
+    return mProgress.loadAcquire();
+}
+
+void SvgExport::setProgress(int done, int total)
+{
+    mProgress.storeRelease((total > 0) ? (int)(((qint64)done * 100) / total) : 0);
+}
+
+// ******************** PNG ******************** //
+
+SvgExportPng::SvgExportPng()
+{
+    mScale      = 1.0;
+    mStripBytes = (16 * 1024 * 1024);
+}
+
+bool SvgExportPng::save(const QString &fileName)
+{
+    QSize docSize = mDocument.size();
+    int width  = qCeil(docSize.width()  * mScale);
+    int height = qCeil(docSize.height() * mScale);
+
+    if ((width <= 0) || (height <= 0))
+    {
+        mError = QString("Invalid picture size");
+        return false;
+    }
+
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::WriteOnly))
+    {
+        mError = file.errorString();
+        return false;
+    }
+
+    // PNG signature
+    file.write("\x89PNG\r\n\x1a\n", 8);
+
+    // Image header : 8 bits per channel, RGBA, no interlace
+    QByteArray header;
+    appendUInt32(header, width);
+    appendUInt32(header, height);
+    header.append((char)8);
+    header.append((char)6);
+    header.append((char)0);
+    header.append((char)0);
+    header.append((char)0);
+    writeChunk(&file, "IHDR", header);
+
+    // Zlib stream header (deflate, 32k window)
+    writeChunk(&file, "IDAT", QByteArray("\x78\x9c", 2));
+
+    // Compute strip height to keep a bounded amount of memory per strip
+    int stripHeight = qMax(1, (mStripBytes / (width * 4)));
+    int stripCount  = ((height + stripHeight - 1) / stripHeight);
+
+    QThreadPool pool;
+    int window = (pool.maxThreadCount() * 2);
+    QQueue< QFuture<SvgExportStrip> > running;
+    uLong adler = adler32(0, Z_NULL, 0);
+    int next = 0;
+
+    for (int i = 0; i < stripCount; i++)
+    {
+        // Keep all the workers busy, with a bounded number of strips
+        while ((next < stripCount) && (running.count() < window))
+        {
+            SvgExportJob job;
+            job.owner        = this;
+            job.documentSize = docSize;
+            job.scale        = mScale;
+            job.width        = width;
+            job.y            = (next * stripHeight);
+            job.height       = qMin(stripHeight, (height - job.y));
+            job.last         = (next == (stripCount - 1));
+            job.shared       = mDocument.isPlain();
+            job.document     = mDocument.part(QRectF(0, (job.y / mScale), docSize.width(),
+                                                     (job.height / mScale)).toAlignedRect());
+            running.enqueue(QtConcurrent::run(&pool, exportStrip, job));
+            next++;
+        }
+
+        // Write the next strip, in picture order
+        SvgExportStrip strip = running.dequeue().result();
+        writeChunk(&file, "IDAT", strip.data);
+        adler = adler32_combine(adler, strip.adler, strip.length);
+        setProgress(i + 1, stripCount);
+
+        // Strips in progress are finished (and dropped) by the pool
+        if (isCanceled())
+        {
+            file.remove();
+            mError = QString("Export canceled");
+            return false;
+        }
+    }
+
+    // Zlib stream trailer
+    QByteArray trailer;
+    appendUInt32(trailer, adler);
+    writeChunk(&file, "IDAT", trailer);
+    writeChunk(&file, "IEND", QByteArray());
+
+    file.close();
+
+    if (file.error() != QFile::NoError)
+    {
+        mError = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SvgExportPng::setDocument(const SvgTileDocument &document)
+{
+    mDocument = document;
+}
+
+void SvgExportPng::setScale(qreal scale)
+{
+    mScale = scale;
+}
+
+void SvgExportPng::setStripBytes(int bytes)
+{
+    mStripBytes = bytes;
+}
+
+void SvgExportPng::writeChunk(QIODevice *dev, const char *type, const QByteArray &data)
+{
+    QByteArray head;
+    appendUInt32(head, data.size());
+    head.append(type, 4);
+
+    // CRC is computed over chunk type and data
+    uLong crc = crc32(0, Z_NULL, 0);
+    crc = crc32(crc, (const Bytef *)type, 4);
+    crc = crc32(crc, (const Bytef *)data.constData(), data.size());
+
+    QByteArray tail;
+    appendUInt32(tail, crc);
+
+    dev->write(head);
+    dev->write(data);
+    dev->write(tail);
+}
+
+// Colors of activities without configured class, and of node summaries
+static const QColor pdfDefaultColor("#00edda");
+static const QColor pdfSummaryColor("#888888");
+
+SvgExportPdf::SvgExportPdf()
+{
+    mRowsPerPage = 40;
+    mDaysPerPage = 31;
+    mUnit        = 1.0;
+    mLabelWidth  = 0;
+    mHeadHeight  = 0;
+    mPlotWidth   = 0;
+    mColumns     = 0;
+    mPageCount   = 0;
+}
+
+bool SvgExportPdf::save(const QString &fileName)
+{
+    if (mLines.isEmpty() || mAxis.isEmpty())
+    {
+        mError = QString("Nothing to export");
+        return false;
+    }
+
+    QPdfWriter writer(fileName);
+    writer.setCreator("svg-timeline");
+    writer.setPageSize(QPageSize(QPageSize::A4));
+    writer.setPageOrientation(QPageLayout::Landscape);
+
+    QPainter painter;
+    if ( ! painter.begin(&writer))
+    {
+        mError = QString("Could not write %1").arg(fileName);
+        return false;
+    }
+
+    // Page geometry, a time window of the axis fills the page width
+    mUnit       = (writer.resolution() / 72.0);
+    mPageSize   = QSizeF(writer.width(), writer.height());
+    mLabelWidth = (150 * mUnit);
+    mHeadHeight = (16 * mUnit);
+    mPlotWidth  = qMax(1, qFloor(mPageSize.width() - mLabelWidth));
+    mPageAxis   = mAxis;
+    mPageAxis.setScale(mPlotWidth / ((qreal)mDaysPerPage * mTime.ticksPerDay()),
+                       qRound(10 * mUnit));
+
+    int bands  = ((mLines.count() + mRowsPerPage - 1) / mRowsPerPage);
+    mColumns   = qMax(1, ((mPageAxis.width() + mPlotWidth - 1) / mPlotWidth));
+    mPageCount = (bands * mColumns);
+
+    QThreadPool pool;
+    int window = (pool.maxThreadCount() * 2);
+    QQueue< QFuture<QPicture> > running;
+    int next = 0;
+
+    for (int i = 0; i < mPageCount; i++)
+    {
+        // Keep all the workers busy, with a bounded number of pages
+        while ((next < mPageCount) && (running.count() < window))
+        {
+            running.enqueue(QtConcurrent::run(&pool, this, &SvgExportPdf::renderPage, next));
+            next++;
+        }
+
+        // Write the next page, in document order
+        QPicture page = running.dequeue().result();
+        if (i > 0)
+            writer.newPage();
+        painter.drawPicture(0, 0, page);
+        setProgress(i + 1, mPageCount);
+
+        // Pages in progress are finished (and dropped) by the pool
+        if (isCanceled())
+        {
+            painter.end();
+            QFile::remove(fileName);
+            mError = QString("Export canceled");
+            return false;
+        }
+    }
+    painter.end();
+    return true;
+}
+
+void SvgExportPdf::setAxis(const vlePlanAxis &axis, const vlePlanTime &time)
+{
+    mAxis = axis;
+    mTime = time;
+}
+
+void SvgExportPdf::setColors(const QHash<QString, QColor> &colors)
+{
+    mColors = colors;
+}
+
+void SvgExportPdf::setLines(const QVector<Line> &lines)
+{
+    mLines = lines;
+}
+
+void SvgExportPdf::setPageLayout(int rowsPerPage, int daysPerPage)
+{
+    mRowsPerPage = qMax(1, rowsPerPage);
+    mDaysPerPage = qMax(1, daysPerPage);
+}
+
+void SvgExportPdf::setPlans(const QList<vlePlanSnapshot> &plans)
+{
+    mPlans = plans;
+}
+
+QPicture SvgExportPdf::renderPage(int page) const
+{
+    QPicture picture;
+    QPainter painter(&picture);
+
+    // Pages of a band of lines follow each other along the time axis
+    int first = ((page / mColumns) * mRowsPerPage);
+    int last  = qMin((first + mRowsPerPage), mLines.count());
+    qint32 x0 = ((page % mColumns) * mPlotWidth);
+    qint32 x1 = qMin((x0 + mPlotWidth), mPageAxis.width());
+    qreal  top        = (mHeadHeight * 2);
+    qreal  lineHeight = ((mPageSize.height() - top) / mRowsPerPage);
+
+    // Font size does not depend on the resolution of the recording device
+    QFont font = painter.font();
+    font.setPixelSize(qMax(1, qRound(qMin((8 * mUnit), (lineHeight * 0.5)))));
+    painter.setFont(font);
+
+    // Title : lines and period shown by this page
+    QString format("dd/MM/yyyy");
+    if (mTime.resolution() != vlePlanTime::Day)
+        format += " hh:mm";
+    QString title = QString("Lines %1-%2 / %3    %4 - %5    Page %6 / %7")
+                    .arg(first + 1).arg(last).arg(mLines.count())
+                    .arg(mTime.toDateTime(mPageAxis.toTick(x0)).toString(format))
+                    .arg(mTime.toDateTime(mPageAxis.toTick(x1 - 1)).toString(format))
+                    .arg(page + 1).arg(mPageCount);
+    painter.drawText(QRectF(0, 0, mPageSize.width(), mHeadHeight),
+                     (Qt::AlignLeft | Qt::AlignVCenter), title);
+    drawRuler(&painter, x0, mHeadHeight, mHeadHeight);
+
+    // Background of lines, then breaks of the axis over them
+    for (int i = first; i < last; i++)
+    {
+        if ((i % 2) == 1)
+            painter.fillRect(QRectF(0, (top + ((i - first) * lineHeight)),
+                                    mPageSize.width(), lineHeight), QColor("#f4f4f4"));
+    }
+    for (int i = 0; i < mPageAxis.count(); i++)
+    {
+        const vlePlanAxis::Segment &s = mPageAxis.segment(i);
+        if (( ! s.isBreak) || (s.pixelEnd <= x0) || (s.pixelStart >= x1))
+            continue;
+        qint32 bx = qMax(s.pixelStart, x0);
+        painter.fillRect(QRectF((mLabelWidth + bx - x0), mHeadHeight,
+                                (qMin(s.pixelEnd, x1) - bx), (mPageSize.height() - mHeadHeight)),
+                         QColor("#dddddd"));
+    }
+
+    for (int i = first; i < last; i++)
+    {
+        const Line &line = mLines.at(i);
+        qreal y = (top + ((i - first) * lineHeight));
+        painter.setPen(Qt::black);
+        painter.drawText(QRectF((2 * mUnit), y, (mLabelWidth - (4 * mUnit)), lineHeight),
+                         (Qt::AlignLeft | Qt::AlignVCenter), line.label);
+        for (int j = 0; j < line.rows.count(); j++)
+            drawRow(&painter, line.rows.at(j), x0, y, lineHeight);
+    }
+    painter.setPen(QPen(Qt::gray, 0));
+    painter.drawLine(QLineF(mLabelWidth, mHeadHeight, mLabelWidth, mPageSize.height()));
+    painter.end();
+
+    return picture;
+}
+
+void SvgExportPdf::drawRuler(QPainter *painter, qint32 x0, qreal y, qreal height) const
+{
+    qint32 x1 = qMin((x0 + mPlotWidth), mPageAxis.width());
+
+    // Dates are shown every few days, so that labels do not overlap
+    qreal dayWidth = (mPlotWidth / (qreal)mDaysPerPage);
+    int   step     = qMax(1, qCeil((40 * mUnit) / dayWidth));
+
+    painter->setPen(QPen(Qt::black, 0));
+    painter->drawLine(QLineF(mLabelWidth, (y + height), (mLabelWidth + x1 - x0), (y + height)));
+    QDate end = mTime.toDate(mPageAxis.toTick(x1 - 1));
+    for (QDate d = mTime.toDate(mPageAxis.toTick(x0)); d <= end; d = d.addDays(1))
+    {
+        if ((d.toJulianDay() % step) != 0)
+            continue;
+        // Dates inside a break are not shown
+        vlePlanTick tick = mTime.fromDate(d);
+        if (mPageAxis.isBreak(tick))
+            continue;
+        qint32 x = (mPageAxis.toPixel(tick) - x0);
+        if ((x < 0) || (x >= (x1 - x0)))
+            continue;
+        painter->drawLine(QLineF((mLabelWidth + x), (y + (height / 2)), (mLabelWidth + x), (y + height)));
+        painter->drawText(QPointF((mLabelWidth + x + mUnit), (y + (height / 2) - mUnit)),
+                          d.toString("dd/MM/yy"));
+    }
+}
+
+void SvgExportPdf::drawRow(QPainter *painter, const Row &row, qint32 x0, qreal y, qreal height) const
+{
+    qint32 x1 = qMin((x0 + mPlotWidth), mPageAxis.width());
+    vlePlanTick t0 = mPageAxis.toTick(x0);
+    vlePlanTick t1 = mPageAxis.toTick(x1);
+
+    // Only the activities (or periods) inside the time window of the page
+    QVector<int>         hits;
+    QVector<vlePlanTick> starts;
+    QVector<vlePlanTick> ends;
+    if (row.group)
+    {
+        row.group->overlaps(t0, t1, &hits);
+        starts.resize(hits.count());
+        ends.resize(hits.count());
+        for (int j = 0; j < hits.count(); j++)
+        {
+            starts[j] = row.group->tickStarts()[hits.at(j)];
+            ends[j]   = row.group->tickEnds()[hits.at(j)];
+        }
+    }
+    else
+    {
+        // Periods of a summary are sorted and disjoint
+        const vlePlanTick *s = row.periods.starts.constData();
+        const vlePlanTick *e = row.periods.ends.constData();
+        int n     = row.periods.starts.count();
+        int first = (std::lower_bound(e, e + n, t0) - e);
+        int last  = (std::upper_bound(s, s + n, t1) - s);
+        for (int j = first; j < last; j++)
+            hits.append(j);
+        starts = row.periods.starts.mid(first, (last - first));
+        ends   = row.periods.ends.mid(first, (last - first));
+    }
+    int count = hits.count();
+    if (count == 0)
+        return;
+
+    QVector<qint32> x    (count);
+    QVector<qint32> width(count);
+    mPageAxis.map(starts.constData(), ends.constData(), count, x0, x1, x.data(), width.data());
+
+    qreal blockTop    = (y + (height * (0.2 + row.offset)));
+    qreal blockHeight = (height * 0.6);
+    for (int j = 0; j < count; j++)
+    {
+        int pos = hits.at(j);
+        if ((width.at(j) == 0) || (( ! row.visible.isEmpty()) && ( ! row.visible.testBit(pos))))
+            continue;
+        QRectF rect((mLabelWidth + x.at(j) - x0), blockTop, width.at(j), blockHeight);
+        if (row.group == NULL)
+        {
+            painter->fillRect(rect, pdfSummaryColor);
+            continue;
+        }
+        const vlePlanActivity *a = row.group->activities()[pos];
+        painter->fillRect(rect, mColors.value(a->getClass(), pdfDefaultColor));
+        // Names are only written into blocks large enough
+        if (rect.width() > (30 * mUnit))
+            painter->drawText(rect.adjusted(mUnit, 0, -mUnit, 0),
+                              (Qt::AlignLeft | Qt::AlignVCenter), a->getName());
+    }
+}
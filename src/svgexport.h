@@ -0,0 +1,134 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef SVGEXPORT_H
+#define SVGEXPORT_H
+
+#include <QAtomicInt>
+#include <QBitArray>
+#include <QByteArray>
+#include <QColor>
+#include <QHash>
+#include <QIODevice>
+#include <QList>
+#include <QPicture>
+#include <QString>
+#include <QVector>
+#include "vlePlan.h"
+#include "vlePlanAxis.h"
+#include "vlePlanTree.h"
+#include "svgtiles.h"
+
+/**
+ * Common part of the exporters.
+ *
+ * save() runs on a worker thread, while the GUI thread reads its progress
+ * and may cancel it. A canceled export stops after the parts in progress,
+ * and removes its incomplete file.
+ */
+class SvgExport
+{
+public:
+    SvgExport();
+    virtual ~SvgExport();
+    void    cancel(void);
+    QString errorString(void) const;
+    bool    isCanceled(void) const;
+    int     progress(void) const;
+    virtual bool save(const QString &fileName) = 0;
+protected:
+    void    setProgress(int done, int total);
+protected:
+    QString    mError;
+private:
+    QAtomicInt mCanceled;
+    QAtomicInt mProgress;   // Percent done
+};
+
+/**
+ * Export of an SVG document as a (very) large PNG picture.
+ *
+ * The picture is rendered by horizontal strips on a pool of threads. Each
+ * worker also compresses its strip into a raw deflate block, and strips
+ * are written in order into the PNG stream as soon as they are ready. Only
+ * a few strips per thread are kept in memory, whatever the picture size.
+ * Each strip is rendered from the part of the document drawn into it, so
+ * workers never parse the whole document (except a plain SVG file, parsed
+ * once per thread).
+ */
+class SvgExportPng : public SvgExport
+{
+public:
+    SvgExportPng();
+    bool save(const QString &fileName);
+    void setDocument(const SvgTileDocument &document);
+    void setScale(qreal scale);
+    void setStripBytes(int bytes);
+private:
+    static void writeChunk(QIODevice *dev, const char *type, const QByteArray &data);
+private:
+    SvgTileDocument mDocument;
+    qreal      mScale;
+    int        mStripBytes; // Max size of one uncompressed strip
+};
+
+/**
+ * Export of a plan as a multi-page vector PDF document.
+ *
+ * Pages are drawn from the plan data (not from the SVG document) : each
+ * page shows a band of lines over a time window. Pages are recorded on a
+ * pool of threads, then written in order into the PDF stream as soon as
+ * they are ready. Only a few pages per thread are kept in memory.
+ */
+class SvgExportPdf : public SvgExport
+{
+public:
+    // Activities of one plan drawn on a line : a group, or a node summary
+    struct Row
+    {
+        const vlePlanGroup *group;   // NULL for the summary of a node
+        vlePlanIntervals    periods; // Running periods of a summary
+        QBitArray           visible; // Filtered activities (empty for all)
+        qreal               offset;  // Vertical offset, relative to line height
+    };
+    struct Line
+    {
+        QString      label;
+        QVector<Row> rows;
+    };
+public:
+    SvgExportPdf();
+    bool save(const QString &fileName);
+    void setAxis(const vlePlanAxis &axis, const vlePlanTime &time);
+    void setColors(const QHash<QString, QColor> &colors);
+    void setLines(const QVector<Line> &lines);
+    void setPageLayout(int rowsPerPage, int daysPerPage);
+    void setPlans(const QList<vlePlanSnapshot> &plans);
+private:
+    QPicture renderPage(int page) const;
+    void drawRuler(QPainter *painter, qint32 x0, qreal y, qreal height) const;
+    void drawRow  (QPainter *painter, const Row &row, qint32 x0, qreal y, qreal height) const;
+private:
+    QList<vlePlanSnapshot> mPlans; // Groups of the lines are kept alive
+    QVector<Line> mLines;
+    QHash<QString, QColor> mColors;
+    vlePlanAxis   mAxis;
+    vlePlanAxis   mPageAxis;   // Axis scaled to the page width
+    vlePlanTime   mTime;
+    int           mRowsPerPage;
+    int           mDaysPerPage;
+    // Page geometry, in device units of the PDF writer
+    QSizeF        mPageSize;
+    qreal         mUnit;       // Device units per point
+    qreal         mLabelWidth;
+    qreal         mHeadHeight;
+    qint32        mPlotWidth;
+    int           mColumns;    // Pages over the time axis
+    int           mPageCount;
+};
+
+#endif // SVGEXPORT_H
@@ -0,0 +1,244 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QPainter>
+#include <QtMath>
+#include "svgminimap.h"
+
+svgMinimap::svgMinimap(QWidget *parent) : QWidget(parent)
+{
+    mView  = NULL;
+    mDirty = true;
+    mDensityWidth = 0;
+    setFixedHeight(100);
+    setCursor(Qt::PointingHandCursor);
+}
+
+void svgMinimap::setView(SvgView *view)
+{
+    if (mView)
+        mView->disconnect(this);
+
+    mView = view;
+    if (mView)
+    {
+        connect(mView, SIGNAL(planChanged()), this, SLOT(rebuild()));
+        connect(mView, SIGNAL(viewChanged()), this, SLOT(update()));
+    }
+    rebuild();
+}
+
+QPointF svgMinimap::scale(void) const
+{
+    if (mView == NULL)
+        return QPointF(0, 0);
+
+    // The whole plan is fitted into the widget
+    QRectF plan = mView->sceneRect();
+    if ((plan.width() <= 0) || (plan.height() <= 0))
+        return QPointF(0, 0);
+    return QPointF(width() / plan.width(), height() / plan.height());
+}
+
+void svgMinimap::rebuild(void)
+{
+    // Drawn on next paint (not at all while hidden)
+    mDirty = true;
+    update();
+}
+
+void svgMinimap::draw(void)
+{
+    mDirty = false;
+    mImage = QImage(qMax(1, width()), qMax(1, height()), QImage::Format_RGB32);
+    mImage.fill(Qt::white);
+
+    QPointF sc = scale();
+    if ((mView == NULL) || mView->plans().isEmpty() || (sc.x() <= 0))
+    {
+        mDensityPlans.clear();
+        mDensity.clear();
+        return;
+    }
+
+    const QList<vlePlanSnapshot> &plans = mView->plans();
+    const QVector<SvgViewRow>    &rows  = mView->rows();
+    const vlePlanAxis &axis = mView->axis();
+    int origin = mView->axisOrigin();
+    int w = mImage.width();
+    int h = mImage.height();
+    qreal lineHeight = (mView->groupHeight() * sc.y());
+
+    // Density of the new versions of the plans (modified groups only), and
+    // of all the plans when the width has changed
+    while (mDensity.count() > plans.count())
+    {
+        mDensity.removeLast();
+        mDensityPlans.removeLast();
+    }
+    for (int k = 0; k < plans.count(); k++)
+    {
+        if ((k < mDensityPlans.count()) && (mDensityPlans.at(k) == plans.at(k)) && (mDensityWidth == w))
+            continue;
+        std::shared_ptr<vlePlanDensity> density = std::make_shared<vlePlanDensity>();
+        density->build(plans.at(k).get(), w, (k < mDensity.count()) ? mDensity.at(k).get() : NULL);
+        if (k < mDensity.count())
+        {
+            mDensity[k]      = density;
+            mDensityPlans[k] = plans.at(k);
+        }
+        else
+        {
+            mDensity.append(density);
+            mDensityPlans.append(plans.at(k));
+        }
+    }
+    mDensityWidth = w;
+
+    // Limits of the buckets in pixels. Each plan uses the level with about
+    // one bucket per pixel, shared by all its lines.
+    QVector<int> levels(plans.count(), -1);
+    QVector< QVector<int> > edges(plans.count());
+    for (int k = 0; k < plans.count(); k++)
+    {
+        const vlePlanDensity *density = mDensity.at(k).get();
+        if (density->levelCount() == 0)
+            continue;
+        int level = density->levelFor(w);
+        int count = density->bucketCount(level);
+        levels[k] = level;
+        edges[k].resize(count + 1);
+        for (int b = 0; b <= count; b++)
+        {
+            vlePlanTick tick = density->origin() + (b * density->bucketTicks(level));
+            edges[k][b] = qBound(0, (int)((origin + axis.toPixel(tick)) * sc.x()), w);
+        }
+    }
+
+    // Density of each pixel : highest value of the lines drawn on it
+    QVector<float> grid(w * h, 0);
+    QVector<float> summary;
+    for (int row = 0; row < rows.count(); row++)
+    {
+        const SvgViewRow &r = rows.at(row);
+        const vlePlanDensity *density = mDensity.at(r.plan).get();
+        if (levels.at(r.plan) < 0)
+            continue;
+        int    level  = levels.at(r.plan);
+        const float *values = density->values(level, r.group);
+        float  max    = density->maxValue(level);
+        // A summary row shows the highest density of the groups under its node
+        if (r.group < 0)
+        {
+            QVector<int> groups = mView->summaryGroups(r);
+            summary.fill(0, density->bucketCount(level));
+            for (int i = 0; i < groups.count(); i++)
+            {
+                const float *v = density->values(level, groups.at(i));
+                if (v == NULL)
+                    continue;
+                for (int b = 0; b < summary.count(); b++)
+                    summary[b] = qMax(summary.at(b), v[b]);
+            }
+            values = groups.isEmpty() ? NULL : summary.constData();
+        }
+        if ((values == NULL) || (max <= 0))
+            continue;
+
+        // The first line of the view is the time rule
+        int y0 = qMin((int)((r.line + 1) * lineHeight), (h - 1));
+        int y1 = qBound((y0 + 1), (int)((r.line + 2) * lineHeight), h);
+        const QVector<int> &e = edges.at(r.plan);
+        for (int b = 0; b < density->bucketCount(level); b++)
+        {
+            float v = (values[b] / max);
+            if (v <= 0)
+                continue;
+            int x0 = qMin(e.at(b), (w - 1));
+            int x1 = qBound((x0 + 1), e.at(b + 1), w);
+            for (int y = y0; y < y1; y++)
+            {
+                float *line = grid.data() + (y * w);
+                for (int x = x0; x < x1; x++)
+                    line[x] = qMax(line[x], v);
+            }
+        }
+    }
+
+    // Convert densities to colors (square root makes sparse areas visible)
+    for (int y = 0; y < h; y++)
+    {
+        QRgb *dst = (QRgb *)mImage.scanLine(y);
+        const float *src = grid.constData() + (y * w);
+        for (int x = 0; x < w; x++)
+        {
+            if (src[x] <= 0)
+                continue;
+            qreal v = qSqrt(src[x]);
+            dst[x] = qRgb(255 - (int)(v * 225), 255 - (int)(v * 155), 255 - (int)(v * 35));
+        }
+    }
+
+    // Time rule, and breaks of the axis
+    QPainter p(&mImage);
+    p.fillRect(QRectF(0, 0, w, lineHeight), QColor("#dcdcdc"));
+    for (int i = 0; i < axis.count(); i++)
+    {
+        const vlePlanAxis::Segment &seg = axis.segment(i);
+        if (seg.isBreak)
+            p.fillRect(QRectF(((origin + seg.pixelStart) * sc.x()), 0,
+                              qMax((qreal)1, (seg.pixelEnd - seg.pixelStart) * sc.x()), h),
+                       QColor("#bbbbbb"));
+    }
+    p.end();
+}
+
+void svgMinimap::paintEvent(QPaintEvent *event)
+{
+    (void)event;
+    if (mDirty)
+        draw();
+
+    QPainter p(this);
+    p.drawImage(0, 0, mImage);
+
+    // Show the area visible into the view
+    QPointF sc = scale();
+    if ((mView == NULL) || (sc.x() <= 0))
+        return;
+    QRectF visible = mView->mapToScene(mView->viewport()->rect()).boundingRect();
+    QRectF r(visible.x() * sc.x(), visible.y() * sc.y(),
+             visible.width() * sc.x(), visible.height() * sc.y());
+    p.setPen(QPen(QColor("#cc2222"), 2));
+    p.drawRect(r.intersected(QRectF(rect())).adjusted(1, 1, -1, -1));
+}
+
+void svgMinimap::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    rebuild();
+}
+
+void svgMinimap::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton)
+        moveView(event->pos());
+}
+
+void svgMinimap::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton)
+        moveView(event->pos());
+}
+
+void svgMinimap::moveView(const QPoint &pos)
+{
+    QPointF sc = scale();
+    if ((mView == NULL) || (sc.x() <= 0))
+        return;
+    mView->centerOn(pos.x() / sc.x(), pos.y() / sc.y());
+}
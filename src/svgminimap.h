@@ -0,0 +1,55 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef SVGMINIMAP_H
+#define SVGMINIMAP_H
+
+#include <QImage>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QWidget>
+#include "svgview.h"
+#include "vlePlanDensity.h"
+
+/**
+ * Overview of the whole plan shown by a SvgView.
+ *
+ * The overview is drawn from the density pyramid of the plans (one line
+ * per line of the view), not from the activities. The visible area of the
+ * view is shown as a rectangle, a click moves the view to this point.
+ *
+ * The overview is only drawn when painted, the density of a plan is
+ * updated for the groups modified since the last drawn version.
+ */
+class svgMinimap : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit svgMinimap(QWidget *parent = 0);
+    void setView(SvgView *view);
+protected:
+    void mouseMoveEvent (QMouseEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void paintEvent (QPaintEvent  *event);
+    void resizeEvent(QResizeEvent *event);
+private slots:
+    void rebuild(void);
+private:
+    void draw(void);
+    void moveView(const QPoint &pos);
+    QPointF scale(void) const;
+private:
+    SvgView *mView;
+    QImage   mImage;  // Overview, drawn again only when the plan change
+    bool     mDirty;  // Overview must be drawn again on next paint
+    QList<vlePlanSnapshot> mDensityPlans; // Versions of the plans used by mDensity
+    QList< std::shared_ptr<const vlePlanDensity> > mDensity;
+    int      mDensityWidth; // Width of the image used to build mDensity
+};
+
+#endif // SVGMINIMAP_H
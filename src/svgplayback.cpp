@@ -0,0 +1,277 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QStandardItemModel>
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QVBoxLayout>
+#include "svgplayback.h"
+
+// Number of positions of the slider (over the whole plan period)
+static const int sliderSteps = 1000;
+
+svgPlayback::svgPlayback(QWidget *parent) : QWidget(parent)
+{
+    mView       = NULL;
+    mUiBackward = 0;
+    mUiPlay     = 0;
+    mUiForward  = 0;
+    mUiStep     = 0;
+    mUiSlider   = 0;
+    mUiDate     = 0;
+    mUiTree     = 0;
+
+    setupUi();
+
+    mTimer.setInterval(100);
+    connect(&mTimer,     SIGNAL(timeout()),         this, SLOT(timerStep()));
+    connect(mUiPlay,     SIGNAL(toggled(bool)),     this, SLOT(play(bool)));
+    connect(mUiBackward, SIGNAL(clicked()),         this, SLOT(stepBackward()));
+    connect(mUiForward,  SIGNAL(clicked()),         this, SLOT(stepForward()));
+    connect(mUiSlider,   SIGNAL(valueChanged(int)), this, SLOT(sliderMoved(int)));
+}
+
+void svgPlayback::setView(SvgView *view)
+{
+    if (mView)
+        mView->disconnect(this);
+
+    mView = view;
+    if (mView)
+        connect(mView, SIGNAL(planChanged()), this, SLOT(planUpdated()));
+    planUpdated();
+}
+
+void svgPlayback::planUpdated(void)
+{
+    vlePlanSnapshot plan;
+    if (mView && ( ! mView->plans().isEmpty()))
+        plan = mView->plans().first();
+    if (plan.get() == mSweep.plan())
+        return;
+
+    mPlan = plan;
+    if (( ! mPlan) || (mPlan->tickStart() == vlePlanTime::invalid))
+    {
+        // Forget the running activities of the previous plan
+        QHash<int, QTreeWidgetItem *>::const_iterator it;
+        for (it = mItems.constBegin(); (it != mItems.constEnd()) && mView; ++it)
+            mView->setGroupHighlight(it.key(), false);
+        mItems.clear();
+        mUiTree->clear();
+
+        mPlan.reset();
+        mSweep.build(NULL);
+        mUiPlay->setChecked(false);
+        if (mView)
+            mView->setTimeCursor(vlePlanTime::invalid);
+        mUiDate->clear();
+        return;
+    }
+
+    updateSteps();
+
+    // The cursor stays at the same date into the new version of the plan,
+    // only the groups modified since the previous one are updated
+    QSet<int> changed;
+    mSweep.update(mPlan.get(), &changed);
+    QSet<int>::const_iterator it;
+    for (it = changed.constBegin(); (it != changed.constEnd()) && mView; ++it)
+        updateGroup(*it);
+
+    vlePlanTick cursor = mSweep.cursor();
+    if (cursor == vlePlanTime::invalid)
+        cursor = mPlan->tickStart();
+    moveCursor(cursor);
+}
+
+void svgPlayback::moveCursor(vlePlanTick tick)
+{
+    if (( ! mPlan) || (mView == NULL))
+        return;
+    tick = qBound(mPlan->tickStart(), tick, (mPlan->tickEnd() + 1));
+
+    // Only the groups crossed by an event are updated
+    QSet<int> changed;
+    mSweep.moveTo(tick, &changed);
+    QSet<int>::const_iterator it;
+    for (it = changed.constBegin(); it != changed.constEnd(); ++it)
+        updateGroup(*it);
+
+    mView->setTimeCursor(tick);
+
+    const vlePlanTime &time = mPlan->time();
+    if (time.resolution() == vlePlanTime::Day)
+        mUiDate->setText(time.toDate(tick).toString("dd/MM/yyyy"));
+    else
+        mUiDate->setText(time.toDateTime(tick).toString("dd/MM/yyyy hh:mm"));
+    mUiDate->setText(mUiDate->text() + tr(" : %1 running").arg(mSweep.activeCount()));
+
+    // Move the slider, without moving the cursor again
+    vlePlanTick span = qMax((vlePlanTick)1, (mPlan->tickEnd() + 1 - mPlan->tickStart()));
+    mUiSlider->blockSignals(true);
+    mUiSlider->setValue((int)(((tick - mPlan->tickStart()) * sliderSteps) / span));
+    mUiSlider->blockSignals(false);
+}
+
+void svgPlayback::updateGroup(int group)
+{
+    const QSet<int> &active = mSweep.active(group);
+    QTreeWidgetItem *item = mItems.value(group, NULL);
+
+    // Groups without running activity are removed from the list
+    if (active.isEmpty())
+    {
+        delete item;
+        mItems.remove(group);
+        mView->setGroupHighlight(group, false);
+        return;
+    }
+    const vlePlanGroup *g = mPlan->getGroup(group);
+    if (item == NULL)
+    {
+        item = new QTreeWidgetItem(mUiTree);
+        mItems.insert(group, item);
+        mView->setGroupHighlight(group, true);
+    }
+
+    // Children are the running activities of this group
+    qDeleteAll(item->takeChildren());
+    QSet<int>::const_iterator it;
+    for (it = active.constBegin(); it != active.constEnd(); ++it)
+    {
+        const vlePlanActivity *a = g->getActivity(*it);
+        QStringList columns;
+        columns << a->getName() << a->getClass();
+        item->addChild(new QTreeWidgetItem(columns));
+    }
+    item->setText(0, QString("%1 (%2)").arg(g->getName()).arg(active.count()));
+}
+
+vlePlanTick svgPlayback::stepTicks(void) const
+{
+    if ( ! mPlan)
+        return 1;
+    // Only steps made of whole ticks can be selected (see updateSteps)
+    return mPlan->time().fromMinutes(mUiStep->currentData().toInt());
+}
+
+void svgPlayback::updateSteps(void)
+{
+    QStandardItemModel *model = qobject_cast<QStandardItemModel *>(mUiStep->model());
+    if (( ! mPlan) || (model == NULL))
+        return;
+
+    // Steps shorter than a tick of the plan (one hour with a day resolution)
+    // are disabled
+    int tickMinutes = (vlePlanTime::Minute / mPlan->time().ticksPerDay());
+    for (int i = 0; i < mUiStep->count(); i++)
+    {
+        bool enable = ((mUiStep->itemData(i).toInt() % tickMinutes) == 0);
+        model->item(i)->setEnabled(enable);
+    }
+    // The selected step is replaced by the next available one
+    int current = mUiStep->currentIndex();
+    while ((current < (mUiStep->count() - 1)) && ( ! model->item(current)->isEnabled()))
+        current++;
+    mUiStep->setCurrentIndex(current);
+}
+
+void svgPlayback::play(bool enable)
+{
+    if (enable && mPlan)
+        mTimer.start();
+    else
+        mTimer.stop();
+}
+
+void svgPlayback::sliderMoved(int value)
+{
+    if ( ! mPlan)
+        return;
+    // Jump to any date : cost depends on the number of events crossed
+    vlePlanTick span = (mPlan->tickEnd() + 1 - mPlan->tickStart());
+    moveCursor(mPlan->tickStart() + ((span * value) / sliderSteps));
+}
+
+void svgPlayback::stepBackward(void)
+{
+    if (mPlan)
+        moveCursor(mSweep.cursor() - stepTicks());
+}
+
+void svgPlayback::stepForward(void)
+{
+    if (mPlan)
+        moveCursor(mSweep.cursor() + stepTicks());
+}
+
+void svgPlayback::timerStep(void)
+{
+    stepForward();
+    // Stop at the end of the plan
+    if (( ! mPlan) || (mSweep.cursor() > mPlan->tickEnd()))
+        mUiPlay->setChecked(false);
+}
+
+void svgPlayback::setupUi(void)
+{
+    QVBoxLayout *vLayoutMain;
+
+    setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Expanding);
+    setMinimumWidth(250);
+
+    // Create a Vertical layout for all controls
+    vLayoutMain = new QVBoxLayout(this);
+    vLayoutMain->setSpacing(6);
+    vLayoutMain->setContentsMargins(0, 0, 0, 0);
+    vLayoutMain->setObjectName(QStringLiteral("vLayout_playback"));
+
+    // Create an horizontal layout for the playback buttons
+    QHBoxLayout *hLayoutButtons = new QHBoxLayout();
+    hLayoutButtons->setSpacing(6);
+    hLayoutButtons->setObjectName(QStringLiteral("hLayoutPlayback"));
+    mUiBackward = new QPushButton(tr("<"), this);
+    mUiBackward->setObjectName(QStringLiteral("playbackBackward"));
+    hLayoutButtons->addWidget(mUiBackward);
+    mUiPlay = new QPushButton(tr("Play"), this);
+    mUiPlay->setObjectName(QStringLiteral("playbackPlay"));
+    mUiPlay->setCheckable(true);
+    hLayoutButtons->addWidget(mUiPlay);
+    mUiForward = new QPushButton(tr(">"), this);
+    mUiForward->setObjectName(QStringLiteral("playbackForward"));
+    hLayoutButtons->addWidget(mUiForward);
+    mUiStep = new QComboBox(this);
+    mUiStep->setObjectName(QStringLiteral("playbackStep"));
+    // Length of each step, in minutes
+    mUiStep->addItem(tr("1 hour"),  60);
+    mUiStep->addItem(tr("1 day"),   1440);
+    mUiStep->addItem(tr("1 week"),  (7 * 1440));
+    mUiStep->addItem(tr("30 days"), (30 * 1440));
+    mUiStep->setCurrentIndex(1);
+    hLayoutButtons->addWidget(mUiStep);
+    vLayoutMain->addLayout(hLayoutButtons);
+
+    // Position of the cursor into the plan period
+    mUiSlider = new QSlider(Qt::Horizontal, this);
+    mUiSlider->setObjectName(QStringLiteral("playbackSlider"));
+    mUiSlider->setRange(0, sliderSteps);
+    vLayoutMain->addWidget(mUiSlider);
+    mUiDate = new QLabel(this);
+    mUiDate->setObjectName(QStringLiteral("playbackDate"));
+    vLayoutMain->addWidget(mUiDate);
+
+    // Create the list of running activities (groups x activities)
+    mUiTree = new QTreeWidget(this);
+    mUiTree->setObjectName(QStringLiteral("playbackTree"));
+    mUiTree->setColumnCount(2);
+    mUiTree->setHeaderLabels(QStringList() << tr("Group / Activity") << tr("Class"));
+    mUiTree->setSortingEnabled(true);
+    mUiTree->sortByColumn(0, Qt::AscendingOrder);
+    mUiTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    vLayoutMain->addWidget(mUiTree);
+}
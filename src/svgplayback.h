@@ -0,0 +1,63 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef SVGPLAYBACK_H
+#define SVGPLAYBACK_H
+
+#include <QComboBox>
+#include <QHash>
+#include <QLabel>
+#include <QPushButton>
+#include <QSlider>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QWidget>
+#include "svgview.h"
+#include "vlePlanSweep.h"
+
+/**
+ * Playback of a plan : a time cursor moves along the timeline, and the
+ * activities running at the cursor date are listed for each group.
+ *
+ * Running activities come from a sweep index of the plan, so each step
+ * only updates the groups where an activity has started or ended.
+ */
+class svgPlayback : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit svgPlayback(QWidget *parent = 0);
+    void setView(SvgView *view);
+private:
+    void setupUi(void);
+    void moveCursor(vlePlanTick tick);
+    void updateGroup(int group);
+    vlePlanTick stepTicks(void) const;
+    void updateSteps(void);
+private slots:
+    void planUpdated(void);
+    void play(bool enable);
+    void sliderMoved(int value);
+    void stepBackward(void);
+    void stepForward(void);
+    void timerStep(void);
+private:
+    SvgView        *mView;
+    vlePlanSnapshot mPlan;   // Plan of the sweep index (kept alive)
+    vlePlanSweep    mSweep;
+    QTimer          mTimer;
+    QHash<int, QTreeWidgetItem *> mItems;  // Item of each group with running activities
+    QPushButton    *mUiBackward;
+    QPushButton    *mUiPlay;
+    QPushButton    *mUiForward;
+    QComboBox      *mUiStep;
+    QSlider        *mUiSlider;
+    QLabel         *mUiDate;
+    QTreeWidget    *mUiTree;
+};
+
+#endif // SVGPLAYBACK_H
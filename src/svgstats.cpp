@@ -0,0 +1,129 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QVBoxLayout>
+#include "svgstats.h"
+
+svgStats::svgStats(QWidget *parent) : QWidget(parent)
+{
+    mUiDateStart = 0;
+    mUiDateEnd   = 0;
+    mUiValue     = 0;
+    mUiTable     = 0;
+
+    setupUi();
+
+    connect(mUiDateStart, SIGNAL(dateChanged(QDate)),       this, SLOT(refresh()));
+    connect(mUiDateEnd,   SIGNAL(dateChanged(QDate)),       this, SLOT(refresh()));
+    connect(mUiValue,     SIGNAL(currentIndexChanged(int)), this, SLOT(refresh()));
+}
+
+void svgStats::refresh(void)
+{
+    mUiTable->clear();
+    mUiTable->setRowCount(0);
+    mUiTable->setColumnCount(0);
+
+    const vlePlanStats *stats = mPlan ? mPlan->stats() : NULL;
+    if (stats == NULL)
+        return;
+
+    QDate start = mUiDateStart->date();
+    QDate end   = mUiDateEnd->date();
+    bool  days  = (mUiValue->currentIndex() == 0);
+
+    // One row per group, one column per class
+    mUiTable->setRowCount   (stats->groupCount());
+    mUiTable->setColumnCount(stats->classCount());
+    for (int j = 0; j < stats->classCount(); j++)
+        mUiTable->setHorizontalHeaderItem(j, new QTableWidgetItem(stats->className(j)));
+
+    for (int i = 0; i < stats->groupCount(); i++)
+    {
+        mUiTable->setVerticalHeaderItem(i, new QTableWidgetItem(mPlan->getGroup(i)->getName()));
+        for (int j = 0; j < stats->classCount(); j++)
+        {
+            qint64 value = days ? stats->activeDays(i, j, start, end)
+                                : stats->activities(i, j, start, end);
+            QTableWidgetItem *item = new QTableWidgetItem(QString::number(value));
+            item->setFlags(item->flags() ^ Qt::ItemIsEditable);
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            mUiTable->setItem(i, j, item);
+        }
+    }
+}
+
+void svgStats::setPlan(const vlePlanSnapshot &plan)
+{
+    bool first = ( ! mPlan) || ( ! mPlan->dateStart().isValid());
+    mPlan = plan;
+
+    // Date controls are limited to the plan period
+    mUiDateStart->blockSignals(true);
+    mUiDateEnd->blockSignals(true);
+    if (mPlan && mPlan->dateStart().isValid())
+    {
+        mUiDateStart->setDateRange(mPlan->dateStart(), mPlan->dateEnd());
+        mUiDateEnd->setDateRange  (mPlan->dateStart(), mPlan->dateEnd());
+        // For a new plan, show totals over the whole period
+        if (first)
+        {
+            mUiDateStart->setDate(mPlan->dateStart());
+            mUiDateEnd->setDate  (mPlan->dateEnd());
+        }
+    }
+    mUiDateStart->blockSignals(false);
+    mUiDateEnd->blockSignals(false);
+
+    refresh();
+}
+
+void svgStats::setupUi(void)
+{
+    QVBoxLayout *vLayoutMain;
+
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+    // Create a Vertical layout for all controls
+    vLayoutMain = new QVBoxLayout(this);
+    vLayoutMain->setSpacing(6);
+    vLayoutMain->setContentsMargins(11, 11, 11, 11);
+    vLayoutMain->setObjectName(QStringLiteral("vLayout_stats"));
+
+    // Create an horizontal layout for the period and value controls
+    QHBoxLayout *hLayoutPeriod = new QHBoxLayout();
+    hLayoutPeriod->setSpacing(6);
+    hLayoutPeriod->setObjectName(QStringLiteral("hLayoutPeriod"));
+    hLayoutPeriod->addWidget(new QLabel(tr("From"), this));
+    mUiDateStart = new QDateEdit(this);
+    mUiDateStart->setObjectName(QStringLiteral("statsStart"));
+    mUiDateStart->setCalendarPopup(true);
+    mUiDateStart->setDisplayFormat("dd/MM/yyyy");
+    hLayoutPeriod->addWidget(mUiDateStart);
+    hLayoutPeriod->addWidget(new QLabel(tr("To"), this));
+    mUiDateEnd = new QDateEdit(this);
+    mUiDateEnd->setObjectName(QStringLiteral("statsEnd"));
+    mUiDateEnd->setCalendarPopup(true);
+    mUiDateEnd->setDisplayFormat("dd/MM/yyyy");
+    hLayoutPeriod->addWidget(mUiDateEnd);
+    mUiValue = new QComboBox(this);
+    mUiValue->setObjectName(QStringLiteral("statsValue"));
+    mUiValue->addItem(tr("Active days"));
+    mUiValue->addItem(tr("Activities"));
+    hLayoutPeriod->addWidget(mUiValue);
+    vLayoutMain->addLayout(hLayoutPeriod);
+
+    // Create the summary table (groups x classes)
+    mUiTable = new QTableWidget(this);
+    mUiTable->setObjectName(QStringLiteral("statsTable"));
+    mUiTable->setSelectionMode(QAbstractItemView::NoSelection);
+    mUiTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    vLayoutMain->addWidget(mUiTable);
+}
@@ -0,0 +1,35 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef SVGSTATS_H
+#define SVGSTATS_H
+
+#include <QComboBox>
+#include <QDateEdit>
+#include <QTableWidget>
+#include <QWidget>
+#include "vlePlan.h"
+
+class svgStats : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit svgStats(QWidget *parent = 0);
+    void setPlan(const vlePlanSnapshot &plan);
+private:
+    void setupUi(void);
+private slots:
+    void refresh(void);
+private:
+    vlePlanSnapshot mPlan;
+    QDateEdit    *mUiDateStart;
+    QDateEdit    *mUiDateEnd;
+    QComboBox    *mUiValue;
+    QTableWidget *mUiTable;
+};
+
+#endif // SVGSTATS_H
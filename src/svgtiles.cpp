@@ -0,0 +1,535 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QMutexLocker>
+#include <QPainter>
+#include <QStringList>
+#include <QThreadStorage>
+#include <QXmlStreamReader>
+#include <QtDebug>
+#include "svgtiles.h"
+
+// Renderers owned by one worker thread, most recently used first
+class SvgTileCache
+{
+public:
+    struct Entry
+    {
+        const void   *owner;
+        int           id;
+        QSvgRenderer *renderer;
+    };
+    ~SvgTileCache()
+    {
+        for (int i = 0; i < entries.count(); i++)
+            delete entries.at(i).renderer;
+    }
+    QList<Entry> entries;
+};
+
+// Number of renderers kept by each worker thread
+static const int tileCacheSize = 4;
+
+static QThreadStorage<SvgTileCache *> tileCache;
+
+// ******************** Tile document ******************** //
+
+SvgTileDocument::SvgTileDocument()
+{
+    mLineHeight = 0;
+}
+
+void SvgTileDocument::clear(void)
+{
+    mPlain.clear();
+    mSize       = QSize();
+    mLineHeight = 0;
+    mTime.clear();
+    mTimeColumns.clear();
+    mLines.clear();
+}
+
+void SvgTileDocument::columnsIn(const QRect &area, int *first, int *last) const
+{
+    *first = 0;
+    *last  = -1;
+    if (mTimeColumns.isEmpty() || area.isEmpty() || (area.top() >= (mLineHeight * 2)))
+        return;
+
+    // The label of a step overflows on its right, keep one more column on the left
+    *first = qMax(0, (area.left() / columnWidth) - 1);
+    *last  = qMin(mTimeColumns.count() - 1, (area.right() / columnWidth));
+}
+
+bool SvgTileDocument::isColumnReady(int column) const
+{
+    return ( ! mTimeColumns.at(column).isNull());
+}
+
+bool SvgTileDocument::isLineReady(int line) const
+{
+    return ( ! mLines.at(line).isNull());
+}
+
+bool SvgTileDocument::isPlain(void) const
+{
+    return ( ! mPlain.isNull());
+}
+
+const QByteArray &SvgTileDocument::line(int line) const
+{
+    return mLines.at(line);
+}
+
+int SvgTileDocument::lineCount(void) const
+{
+    return mLines.count();
+}
+
+void SvgTileDocument::linesIn(const QRect &area, int *first, int *last) const
+{
+    *first = 0;
+    *last  = -1;
+    if ((mLineHeight <= 0) || mLines.isEmpty() || area.isEmpty())
+        return;
+
+    // Line n is drawn at (n + 1) * height, keep one more line on each side
+    // for the elements that overflow their own line (labels, strokes)
+    *first = qMax(0, (area.top() / mLineHeight) - 2);
+    *last  = qMin(mLines.count() - 1, (area.bottom() / mLineHeight));
+}
+
+QByteArray SvgTileDocument::part(const QRect &area) const
+{
+    if ( ! mPlain.isNull())
+        return mPlain;
+
+    QByteArray data = root();
+    if (area.top() < (mLineHeight * 2))
+        data.append(mTime);
+
+    int first, last;
+    columnsIn(area, &first, &last);
+    for (int i = first; i <= last; i++)
+        data.append(mTimeColumns.at(i));
+
+    linesIn(area, &first, &last);
+    for (int i = first; i <= last; i++)
+    {
+        data.append("<g transform=\"translate(0,");
+        data.append(QByteArray::number((i + 1) * mLineHeight));
+        data.append(")\">");
+        data.append(mLines.at(i));
+        data.append("</g>");
+    }
+    data.append("</svg>\n");
+    return data;
+}
+
+QByteArray SvgTileDocument::root(void) const
+{
+    QByteArray width  = QByteArray::number(mSize.width());
+    QByteArray height = QByteArray::number(mSize.height());
+    return "<svg version=\"1.1\" width=\"" + width + "\" height=\"" + height +
+           "\" viewBox=\"0 0 " + width + " " + height + "\">";
+}
+
+QRect SvgTileDocument::spread(const QRect &changed) const
+{
+    // Parts that contain the lines of an area also cover one line around
+    if (changed.isEmpty())
+        return changed;
+    return changed.adjusted(0, -mLineHeight, 0, mLineHeight);
+}
+
+void SvgTileDocument::setLayout(const QSize &size, int lineHeight, int lineCount)
+{
+    mPlain.clear();
+    mSize       = size;
+    mLineHeight = lineHeight;
+    mLines.resize(lineCount);
+    mTimeColumns.resize((size.width() + columnWidth - 1) / columnWidth);
+}
+
+void SvgTileDocument::setLine(int line, const QByteArray &data)
+{
+    mLines[line] = data;
+}
+
+void SvgTileDocument::setPlain(const QByteArray &document)
+{
+    clear();
+    mPlain = document;
+    mSize  = SvgTiles::readSize(document);
+}
+
+void SvgTileDocument::setTime(const QByteArray &data)
+{
+    // Steps of the previous rule are generated again
+    mTime = data;
+    mTimeColumns.fill(QByteArray());
+}
+
+void SvgTileDocument::setTimeColumn(int column, const QByteArray &data)
+{
+    mTimeColumns[column] = data;
+}
+
+QSize SvgTileDocument::size(void) const
+{
+    return mSize;
+}
+
+QByteArray SvgTileDocument::whole(void) const
+{
+    return part(QRect(QPoint(0, 0), mSize));
+}
+
+// ******************** Tile job ******************** //
+
+SvgTileJob::SvgTileJob(SvgTiles *owner, const QByteArray &document, int id, int generation, const QRect &rect)
+{
+    mOwner      = owner;
+    mDocument   = document;
+    mId         = id;
+    mGeneration = generation;
+    mRect       = rect;
+}
+
+void SvgTileJob::run()
+{
+    QImage image;
+
+    // If the tile is still wanted when the job start, render it ...
+    if (mOwner->isWanted(mGeneration, mRect))
+    {
+        QSvgRenderer *renderer;
+        renderer = SvgTiles::threadRenderer(mOwner, mId, mDocument);
+
+        image = QImage(mRect.size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+
+        QPainter painter(&image);
+        renderer->setViewBox(QRectF(mRect));
+        renderer->render(&painter, QRectF(QPointF(0, 0), QSizeF(mRect.size())));
+        painter.end();
+    }
+    // ... else a null image is returned, to release the pending tile
+
+    QMetaObject::invokeMethod(mOwner, "tileDone", Qt::QueuedConnection,
+                              Q_ARG(int,    mGeneration),
+                              Q_ARG(QRect,  mRect),
+                              Q_ARG(QImage, image));
+}
+
+// ******************** Tiles ******************** //
+
+SvgTiles::SvgTiles(QObject *parent)
+    : QObject(parent),
+    mGeneration(0)
+{
+    mSource       = NULL;
+    mLastBandId   = 0;
+    mTileSize     = 256;
+    mDoneBytes    = 0;
+    mMemoryBudget = (256 * 1024 * 1024);
+}
+
+SvgTiles::~SvgTiles()
+{
+    // Cancel all pending jobs, and wait the running ones
+    mGeneration.fetchAndAddOrdered(1);
+    mPool.clear();
+    mPool.waitForDone();
+}
+
+QSize SvgTiles::documentSize(void) const
+{
+    return mDocumentSize;
+}
+
+int SvgTiles::generation(void) const
+{
+    return mGeneration.load();
+}
+
+void SvgTiles::invalidate(void)
+{
+    // Tiles already sent must be rendered again on next request
+    mDone.clear();
+    mDoneBytes = 0;
+}
+
+qint64 SvgTiles::key(const QRect &rect) const
+{
+    return tileKey(rect.x() / mTileSize, rect.y() / mTileSize);
+}
+
+void SvgTiles::request(const QRect &visible, const QRect &prefetch)
+{
+    QRect docRect(QPoint(0, 0), mDocumentSize);
+
+    mVisible = visible.intersected(docRect);
+
+    // Update the wanted area, tiles outside are dropped by workers
+    mWantedLock.lock();
+    mWanted = mVisible.united(prefetch.intersected(docRect));
+    mWantedLock.unlock();
+
+    // Visible tiles first, then prefetch with a lower priority
+    requestArea(mVisible, 1);
+    requestArea(prefetch.intersected(docRect), 0);
+}
+
+void SvgTiles::requestArea(const QRect &area, int priority)
+{
+    if (area.isEmpty())
+        return;
+
+    int gen = generation();
+    for (int y = (area.top() / mTileSize); y <= (area.bottom() / mTileSize); y++)
+    {
+        QByteArray band;
+        int id = bandId(y);
+        for (int x = (area.left() / mTileSize); x <= (area.right() / mTileSize); x++)
+        {
+            qint64 tile = tileKey(x, y);
+            if (mDone.contains(tile) || mPending.contains(tile))
+                continue;
+
+            QRect rect(x * mTileSize, y * mTileSize, mTileSize, mTileSize);
+            rect = rect.intersected(QRect(QPoint(0, 0), mDocumentSize));
+
+            // Document of the band, only built when a tile of it is missing
+            if (band.isNull() && mSource)
+                band = mSource->tileDocument(QRect(0, rect.y(), mDocumentSize.width(), rect.height()));
+
+            mPending.insert(tile);
+            mPool.start(new SvgTileJob(this, band, id, gen, rect), priority);
+        }
+    }
+}
+
+void SvgTiles::setDocument(const QSize &size)
+{
+    // Increment generation : all pending jobs become obsolete
+    mGeneration.fetchAndAddOrdered(1);
+    mPool.clear();
+
+    mDocumentSize = size;
+    mBandIds.clear();
+    mPending.clear();
+    mDone.clear();
+    mDoneBytes = 0;
+    mVisible   = QRect();
+
+    mWantedLock.lock();
+    mWanted = QRect();
+    mWantedLock.unlock();
+}
+
+void SvgTiles::updateDocument(const QSize &size, const QRect &changed)
+{
+    // Increment generation : all pending jobs become obsolete
+    mGeneration.fetchAndAddOrdered(1);
+    mPool.clear();
+    mPending.clear();
+    mDocumentSize = size;
+    QRect docRect(QPoint(0, 0), mDocumentSize);
+
+    // Documents of the changed bands must be loaded again by workers
+    QHash<int, int>::iterator band = mBandIds.begin();
+    while (band != mBandIds.end())
+    {
+        QRect rect(0, band.key() * mTileSize, mDocumentSize.width(), mTileSize);
+        if (rect.intersects(changed) || ( ! rect.intersects(docRect)))
+            band = mBandIds.erase(band);
+        else
+            ++band;
+    }
+
+    // Only tiles into the changed area must be rendered again. Visible
+    // ones are kept shown until replaced, other ones are removed now.
+    // When the size has changed, tiles on the old border (clipped) and
+    // tiles outside of the new document are removed too.
+    QHash<qint64, QRect>::iterator it = mDone.begin();
+    while (it != mDone.end())
+    {
+        QRect rect = it.value();
+        QRect full = QRect(rect.topLeft(), QSize(mTileSize, mTileSize)).intersected(docRect);
+        if (( ! rect.intersects(changed)) && (rect == full))
+        {
+            ++it;
+            continue;
+        }
+        mDoneBytes -= ((qint64)rect.width() * rect.height() * 4);
+        it = mDone.erase(it);
+        if (( ! rect.intersects(mVisible)) || full.isEmpty())
+            emit tileRemoved(rect);
+    }
+}
+
+void SvgTiles::setMemoryBudget(qint64 bytes)
+{
+    mMemoryBudget = bytes;
+    evict();
+}
+
+void SvgTiles::setSource(SvgTileSource *source)
+{
+    mSource = source;
+}
+
+void SvgTiles::setTileSize(int size)
+{
+    mTileSize = size;
+    mBandIds.clear();
+}
+
+int SvgTiles::tileSize(void) const
+{
+    return mTileSize;
+}
+
+QSvgRenderer *SvgTiles::threadRenderer(const void *owner, int id,
+                                       const QByteArray &document)
+{
+    if ( ! tileCache.hasLocalData())
+        tileCache.setLocalData(new SvgTileCache);
+
+    QList<SvgTileCache::Entry> &entries = tileCache.localData()->entries;
+
+    // Search a renderer already loaded with this document
+    for (int i = 0; i < entries.count(); i++)
+    {
+        if ((entries.at(i).owner != owner) || (entries.at(i).id != id))
+            continue;
+        if (i > 0)
+            entries.move(i, 0);
+        return entries.first().renderer;
+    }
+
+    // Else, reuse the least recently used renderer to load it
+    SvgTileCache::Entry entry;
+    if (entries.count() < tileCacheSize)
+        entry.renderer = new QSvgRenderer;
+    else
+        entry.renderer = entries.takeLast().renderer;
+    entry.owner = owner;
+    entry.id    = id;
+
+    QXmlStreamReader xData(document);
+    entry.renderer->load(&xData);
+    entries.prepend(entry);
+    return entry.renderer;
+}
+
+QSize SvgTiles::readSize(const QByteArray &document)
+{
+    QXmlStreamReader xml(document);
+
+    // Search the root element, and read its size
+    while ( ! xml.atEnd())
+    {
+        if (xml.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        QXmlStreamAttributes attr = xml.attributes();
+        int width  = attr.value("width").toDouble();
+        int height = attr.value("height").toDouble();
+        // If the size is not set, use the view box
+        if ((width <= 0) || (height <= 0))
+        {
+            QStringList box = attr.value("viewBox").toString().split(' ', QString::SkipEmptyParts);
+            if (box.count() == 4)
+            {
+                width  = box.at(2).toDouble();
+                height = box.at(3).toDouble();
+            }
+        }
+        return QSize(width, height);
+    }
+    return QSize();
+}
+
+void SvgTiles::evict(void)
+{
+    QPoint center = mVisible.center();
+
+    while (mDoneBytes > mMemoryBudget)
+    {
+        qint64 farKey  = 0;
+        qint64 farDist = -1;
+
+        // Search the tile furthest from the viewport (visible ones are kept)
+        QHash<qint64, QRect>::const_iterator it;
+        for (it = mDone.constBegin(); it != mDone.constEnd(); ++it)
+        {
+            if (it.value().intersects(mVisible))
+                continue;
+            qint64 dist = (it.value().center() - center).manhattanLength();
+            if (dist > farDist)
+            {
+                farDist = dist;
+                farKey  = it.key();
+            }
+        }
+        // Nothing can be evicted
+        if (farDist < 0)
+            break;
+
+        QRect rect = mDone.take(farKey);
+        mDoneBytes -= ((qint64)rect.width() * rect.height() * 4);
+        emit tileRemoved(rect);
+    }
+}
+
+int SvgTiles::bandId(int row)
+{
+    QHash<int, int>::const_iterator it = mBandIds.constFind(row);
+    if (it != mBandIds.constEnd())
+        return it.value();
+
+    int id = ++mLastBandId;
+    mBandIds.insert(row, id);
+    return id;
+}
+
+bool SvgTiles::isWanted(int generation, const QRect &rect)
+{
+    if (generation != mGeneration.load())
+        return false;
+
+    QMutexLocker lock(&mWantedLock);
+    return mWanted.intersects(rect);
+}
+
+qint64 SvgTiles::tileKey(int x, int y)
+{
+    return ((qint64)x << 32) | (quint32)y;
+}
+
+void SvgTiles::tileDone(int generation, const QRect &rect, const QImage &image)
+{
+    // Result of an obsolete document, drop it
+    if (generation != mGeneration.load())
+        return;
+
+    qint64 tile = key(rect);
+    mPending.remove(tile);
+
+    // Tile has been dropped by the worker (outside of wanted area)
+    if (image.isNull())
+        return;
+
+    mDone.insert(tile, rect);
+    mDoneBytes += ((qint64)rect.width() * rect.height() * 4);
+    emit tileReady(rect, image);
+
+    // Keep memory used by tiles into the budget
+    evict();
+}
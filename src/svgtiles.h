@@ -0,0 +1,157 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef SVGTILES_H
+#define SVGTILES_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QRect>
+#include <QRunnable>
+#include <QSet>
+#include <QSize>
+#include <QSvgRenderer>
+#include <QThreadPool>
+#include <QVector>
+
+class SvgTiles;
+
+/**
+ * Generated document, kept as parts : the frame of the time rule and its
+ * steps, cut into columns, then one fragment per line of groups (all lines
+ * have the same height).
+ *
+ * part() returns a small but complete document, with only the lines drawn
+ * into an area : a tile is rendered from the few lines it covers instead
+ * of the whole document. A document that is not split into parts (a loaded
+ * SVG file) is always returned as is.
+ */
+class SvgTileDocument
+{
+public:
+    SvgTileDocument();
+    void  clear(void);
+    void  columnsIn(const QRect &area, int *first, int *last) const;
+    bool  isColumnReady(int column) const;
+    bool  isLineReady(int line) const;
+    bool  isPlain(void) const;
+    const QByteArray &line(int line) const;
+    int   lineCount(void) const;
+    void  linesIn(const QRect &area, int *first, int *last) const;
+    QByteArray part(const QRect &area) const;
+    QRect spread(const QRect &changed) const;
+    void  setLayout(const QSize &size, int lineHeight, int lineCount);
+    void  setLine(int line, const QByteArray &data);
+    void  setPlain(const QByteArray &document);
+    void  setTime(const QByteArray &data);
+    void  setTimeColumn(int column, const QByteArray &data);
+    QSize size(void) const;
+    QByteArray whole(void) const;
+    static const int columnWidth = 2048;
+private:
+    QByteArray root(void) const;
+private:
+    QByteArray mPlain;
+    QSize      mSize;
+    int        mLineHeight;
+    QByteArray mTime;           // Drawn on the first line
+    QVector<QByteArray> mTimeColumns; // Steps of the time rule, null until generated
+    QVector<QByteArray> mLines; // Line n is drawn at ((n + 1) * mLineHeight), null until generated
+};
+
+// Provider of the documents rendered by the tiles (called by the GUI thread)
+class SvgTileSource
+{
+public:
+    virtual ~SvgTileSource() { }
+    virtual QByteArray tileDocument(const QRect &area) = 0;
+};
+
+class SvgTileJob : public QRunnable
+{
+public:
+    SvgTileJob(SvgTiles *owner, const QByteArray &document, int id, int generation, const QRect &rect);
+    void run();
+private:
+    SvgTiles  *mOwner;
+    QByteArray mDocument;
+    int        mId;
+    int        mGeneration;
+    QRect      mRect;
+};
+
+/**
+ * Render an SVG document by tiles, using worker threads.
+ *
+ * The document of each band of tiles (one row) is given by the source, and
+ * only contains what is drawn into this band. Each worker thread keeps the
+ * renderers of the last bands it has parsed, then draws requested tiles
+ * into QImage. Finished tiles are sent back to the GUI thread with the
+ * tileReady() signal. Loading a new document cancels all the pending tiles
+ * of the previous one.
+ *
+ * Tiles of a prefetch area (ahead of the viewport when scrolling) are
+ * rendered with a lower priority. When the memory used by rendered tiles
+ * exceeds the budget, tiles furthest from the viewport are evicted and
+ * tileRemoved() is emitted.
+ */
+class SvgTiles : public QObject
+{
+    Q_OBJECT
+public:
+    SvgTiles(QObject *parent = 0);
+    ~SvgTiles();
+    QSize documentSize(void) const;
+    int   generation(void) const;
+    void  invalidate(void);
+    qint64 key(const QRect &rect) const;
+    void  request(const QRect &visible, const QRect &prefetch = QRect());
+    void  setMemoryBudget(qint64 bytes);
+    void  setDocument(const QSize &size);
+    void  updateDocument(const QSize &size, const QRect &changed);
+    void  setSource(SvgTileSource *source);
+    void  setTileSize(int size);
+    int   tileSize(void) const;
+    static QSvgRenderer *threadRenderer(const void *owner, int id,
+                                        const QByteArray &document);
+    static QSize readSize(const QByteArray &document);
+signals:
+    void  tileReady  (const QRect &rect, const QImage &image);
+    void  tileRemoved(const QRect &rect);
+private:
+    friend class SvgTileJob;
+    void  evict(void);
+    int   bandId(int row);
+    bool  isWanted(int generation, const QRect &rect);
+    void  requestArea(const QRect &area, int priority);
+    static qint64 tileKey(int x, int y);
+private slots:
+    void  tileDone(int generation, const QRect &rect, const QImage &image);
+private:
+    SvgTileSource *mSource;
+    QSize        mDocumentSize;
+    // Identifier of the document of each band, a new one when it changes
+    QHash<int, int> mBandIds;
+    int          mLastBandId;
+    QAtomicInt   mGeneration;
+    int          mTileSize;
+    QThreadPool  mPool;
+    QSet<qint64> mPending;  // Tiles sent to workers
+    QHash<qint64, QRect> mDone; // Tiles already sent to the view
+    qint64       mDoneBytes;
+    qint64       mMemoryBudget;
+    QRect        mVisible;
+    // Area wanted by the view, read by workers before rendering
+    QMutex       mWantedLock;
+    QRect        mWanted;
+};
+
+#endif // SVGTILES_H
@@ -0,0 +1,339 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QBuffer>
+#include <QStringList>
+#include <QtDebug>
+#include "svgtransform.h"
+
+// Last stage of all chains : write events to the output document
+class SvgTransformWriter : public SvgTransform
+{
+public:
+    SvgTransformWriter(QXmlStreamWriter *writer) { mWriter = writer; }
+    void token(SvgToken &t)
+    {
+        switch (t.type)
+        {
+            case QXmlStreamReader::StartDocument:
+                mWriter->writeStartDocument();
+                break;
+            case QXmlStreamReader::EndDocument:
+                mWriter->writeEndDocument();
+                break;
+            case QXmlStreamReader::StartElement:
+                mWriter->writeStartElement(t.name);
+                mWriter->writeAttributes(t.attributes);
+                break;
+            case QXmlStreamReader::EndElement:
+                mWriter->writeEndElement();
+                break;
+            case QXmlStreamReader::Characters:
+                mWriter->writeCharacters(t.text);
+                break;
+            case QXmlStreamReader::Comment:
+                mWriter->writeComment(t.text);
+                break;
+            case QXmlStreamReader::ProcessingInstruction:
+                mWriter->writeProcessingInstruction(t.name, t.text);
+                break;
+            default:
+                break;
+        }
+    }
+private:
+    QXmlStreamWriter *mWriter;
+};
+
+// ******************** Transform (base) ******************** //
+
+SvgTransform::SvgTransform()
+{
+    mNext = NULL;
+}
+
+SvgTransform::~SvgTransform()
+{
+    // Nothing to do
+}
+
+void SvgTransform::setNext(SvgTransform *next)
+{
+    mNext = next;
+}
+
+void SvgTransform::token(SvgToken &t)
+{
+    // Default stage does nothing
+    forward(t);
+}
+
+/**
+ * Create a stage from its command line description :
+ *   style:<selector>:<property>=<value>
+ *   annotate:<selector>:<text>
+ *   filter:<attribute>=<pattern>
+ * Returns NULL if the description is not valid.
+ */
+SvgTransform *SvgTransform::fromString(const QString &spec)
+{
+    QString kind = spec.section(QChar(':'), 0, 0);
+
+    if (kind == "style")
+    {
+        QString selector = spec.section(QChar(':'), 1, 1);
+        QString setting  = spec.section(QChar(':'), 2);
+        int sep = setting.indexOf(QChar('='));
+        if (selector.isEmpty() || (sep <= 0))
+            return NULL;
+        return new SvgTransformStyle(selector, setting.left(sep), setting.mid(sep + 1));
+    }
+    if (kind == "annotate")
+    {
+        QString selector = spec.section(QChar(':'), 1, 1);
+        if (selector.isEmpty())
+            return NULL;
+        return new SvgTransformAnnotate(selector, spec.section(QChar(':'), 2));
+    }
+    if (kind == "filter")
+    {
+        QString setting = spec.section(QChar(':'), 1);
+        int sep = setting.indexOf(QChar('='));
+        if (sep <= 0)
+            return NULL;
+        QRegExp pattern(setting.mid(sep + 1));
+        if ( ! pattern.isValid())
+            return NULL;
+        return new SvgTransformFilter(setting.left(sep), pattern);
+    }
+    return NULL;
+}
+
+void SvgTransform::forward(SvgToken &t)
+{
+    if (mNext)
+        mNext->token(t);
+}
+
+bool SvgTransform::match(const SvgToken &t, const QString &selector)
+{
+    if (t.type != QXmlStreamReader::StartElement)
+        return false;
+
+    // Elements are selected by template selector, or by element name
+    if (t.attributes.value("vle:selector") == selector)
+        return true;
+    return (t.name == selector);
+}
+
+// ******************** Style ******************** //
+
+SvgTransformStyle::SvgTransformStyle(const QString &selector, const QString &property, const QString &value)
+{
+    mSelector = selector;
+    mProperty = property;
+    mValue    = value;
+}
+
+void SvgTransformStyle::token(SvgToken &t)
+{
+    if (match(t, mSelector))
+    {
+        // Rebuild the style, with the new value of the property
+        QStringList props = t.attributes.value("style").toString().split(QChar(';'), QString::SkipEmptyParts);
+        QStringList style;
+        for (int i = 0; i < props.count(); i++)
+        {
+            if (props.at(i).section(QChar(':'), 0, 0).trimmed() != mProperty)
+                style.append(props.at(i));
+        }
+        style.append(mProperty + ":" + mValue);
+
+        QXmlStreamAttributes attributes;
+        for (int i = 0; i < t.attributes.count(); i++)
+        {
+            if (t.attributes.at(i).qualifiedName() != QLatin1String("style"))
+                attributes.append(t.attributes.at(i));
+        }
+        attributes.append("style", style.join(QChar(';')));
+        t.attributes = attributes;
+    }
+    forward(t);
+}
+
+// ******************** Annotate ******************** //
+
+SvgTransformAnnotate::SvgTransformAnnotate(const QString &selector, const QString &text)
+{
+    mSelector = selector;
+    mText     = text;
+}
+
+void SvgTransformAnnotate::token(SvgToken &t)
+{
+    bool selected = match(t, mSelector);
+
+    forward(t);
+
+    if (selected)
+    {
+        // Insert the title as first child of the element
+        SvgToken title;
+        title.type = QXmlStreamReader::StartElement;
+        title.name = "title";
+        forward(title);
+        title.type = QXmlStreamReader::Characters;
+        title.text = mText;
+        forward(title);
+        title.type = QXmlStreamReader::EndElement;
+        forward(title);
+    }
+}
+
+// ******************** Filter ******************** //
+
+SvgTransformFilter::SvgTransformFilter(const QString &attribute, const QRegExp &pattern)
+{
+    mAttribute = attribute;
+    mPattern   = pattern;
+    mSkipDepth = 0;
+}
+
+void SvgTransformFilter::token(SvgToken &t)
+{
+    // Into a removed element, only count depth to find its end
+    if (mSkipDepth)
+    {
+        if (t.type == QXmlStreamReader::StartElement)
+            mSkipDepth++;
+        else if (t.type == QXmlStreamReader::EndElement)
+            mSkipDepth--;
+        return;
+    }
+
+    if ((t.type == QXmlStreamReader::StartElement) && t.attributes.hasAttribute(mAttribute) &&
+        mPattern.exactMatch(t.attributes.value(mAttribute).toString()))
+    {
+        mSkipDepth = 1;
+        return;
+    }
+    forward(t);
+}
+
+// ******************** Chain ******************** //
+
+SvgTransformChain::SvgTransformChain()
+{
+    // Nothing to do
+}
+
+SvgTransformChain::~SvgTransformChain()
+{
+    clear();
+}
+
+void SvgTransformChain::append(SvgTransform *stage)
+{
+    if ( ! mStages.isEmpty())
+        mStages.last()->setNext(stage);
+    stage->setNext(NULL);
+    mStages.append(stage);
+}
+
+QByteArray SvgTransformChain::apply(const QByteArray &document, bool fragment)
+{
+    if (mStages.isEmpty())
+        return document;
+
+    QByteArray result;
+    QBuffer in;
+    QBuffer out(&result);
+    in.setData(document);
+    in.open(QIODevice::ReadOnly);
+    out.open(QIODevice::WriteOnly);
+
+    // On error, keep the original document
+    if ( ! run(&in, &out, fragment))
+    {
+        qWarning() << "SvgTransformChain:" << mError;
+        return document;
+    }
+    return result;
+}
+
+void SvgTransformChain::clear(void)
+{
+    qDeleteAll(mStages);
+    mStages.clear();
+}
+
+QString SvgTransformChain::errorString(void) const
+{
+    return mError;
+}
+
+bool SvgTransformChain::isEmpty(void) const
+{
+    return mStages.isEmpty();
+}
+
+bool SvgTransformChain::run(QIODevice *in, QIODevice *out, bool fragment)
+{
+    QXmlStreamReader reader(in);
+    QXmlStreamWriter writer(out);
+    SvgTransformWriter sink(&writer);
+
+    // Template prefixes (vle:) are kept as they are
+    reader.setNamespaceProcessing(false);
+    mError.clear();
+
+    // Plug the writer after the last stage
+    if ( ! mStages.isEmpty())
+        mStages.last()->setNext(&sink);
+    SvgTransform *first = mStages.isEmpty() ? &sink : mStages.first();
+
+    SvgToken t;
+    while ( ! reader.atEnd())
+    {
+        t.type = reader.readNext();
+        if (reader.hasError())
+            break;
+        // Whitespace between elements is not needed
+        if ((t.type == QXmlStreamReader::Characters) && reader.isWhitespace())
+            continue;
+        if ((t.type == QXmlStreamReader::DTD) || (t.type == QXmlStreamReader::EntityReference))
+            continue;
+        // A fragment is inserted into a document, without declaration
+        if (fragment && ((t.type == QXmlStreamReader::StartDocument) ||
+                         (t.type == QXmlStreamReader::EndDocument)))
+            continue;
+
+        t.name = reader.qualifiedName().toString();
+        t.text.clear();
+        t.attributes.clear();
+        if (t.type == QXmlStreamReader::StartElement)
+            t.attributes = reader.attributes();
+        else if ((t.type == QXmlStreamReader::Characters) || (t.type == QXmlStreamReader::Comment))
+            t.text = reader.text().toString();
+        else if (t.type == QXmlStreamReader::ProcessingInstruction)
+        {
+            t.name = reader.processingInstructionTarget().toString();
+            t.text = reader.processingInstructionData().toString();
+        }
+        first->token(t);
+    }
+
+    if ( ! mStages.isEmpty())
+        mStages.last()->setNext(NULL);
+
+    if (reader.hasError())
+    {
+        mError = reader.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef SVGTRANSFORM_H
+#define SVGTRANSFORM_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QRegExp>
+#include <QString>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+// One XML event, as read from the document
+struct SvgToken
+{
+    QXmlStreamReader::TokenType type;
+    QString name;      // Qualified name (elements)
+    QString text;      // Text, comment or processing instruction data
+    QXmlStreamAttributes attributes;
+};
+
+/**
+ * One stage of a transform chain.
+ *
+ * A stage receives the XML events of the document one by one, and forwards
+ * (modified, inserted or dropped) events to the next stage. Stages never
+ * keep the whole document, so a chain works with constant memory.
+ */
+class SvgTransform
+{
+public:
+    SvgTransform();
+    virtual ~SvgTransform();
+    void setNext(SvgTransform *next);
+    virtual void token(SvgToken &t);
+    static SvgTransform *fromString(const QString &spec);
+protected:
+    void forward(SvgToken &t);
+    static bool match(const SvgToken &t, const QString &selector);
+private:
+    SvgTransform *mNext;
+};
+
+// Change one property of the "style" attribute of selected elements
+class SvgTransformStyle : public SvgTransform
+{
+public:
+    SvgTransformStyle(const QString &selector, const QString &property, const QString &value);
+    void token(SvgToken &t);
+private:
+    QString mSelector;
+    QString mProperty;
+    QString mValue;
+};
+
+// Insert a <title> (shown as tooltip by viewers) into selected elements
+class SvgTransformAnnotate : public SvgTransform
+{
+public:
+    SvgTransformAnnotate(const QString &selector, const QString &text);
+    void token(SvgToken &t);
+private:
+    QString mSelector;
+    QString mText;
+};
+
+// Remove selected elements (and their content) when an attribute matches
+class SvgTransformFilter : public SvgTransform
+{
+public:
+    SvgTransformFilter(const QString &attribute, const QRegExp &pattern);
+    void token(SvgToken &t);
+private:
+    QString mAttribute;
+    QRegExp mPattern;
+    int     mSkipDepth;  // Depth into a removed element (0 if none)
+};
+
+/**
+ * Chain of transforms applied to a generated plan, in one pass.
+ *
+ * The document is read with QXmlStreamReader, events go through all the
+ * stages, then are written by QXmlStreamWriter. The chain owns its stages.
+ * A fragment (one element, inserted later into a document) is written
+ * without XML declaration, so each part can be transformed when generated.
+ */
+class SvgTransformChain
+{
+public:
+    SvgTransformChain();
+    ~SvgTransformChain();
+    void    append(SvgTransform *stage);
+    QByteArray apply(const QByteArray &document, bool fragment = false);
+    void    clear(void);
+    QString errorString(void) const;
+    bool    isEmpty(void) const;
+    bool    run(QIODevice *in, QIODevice *out, bool fragment = false);
+private:
+    Q_DISABLE_COPY(SvgTransformChain)
+    QList<SvgTransform *> mStages;
+    QString mError;
+};
+
+#endif // SVGTRANSFORM_H
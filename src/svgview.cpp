@@ -5,16 +5,25 @@
  *
  * Copyright (c) 2016 Agilack
  */
+#include <QApplication>
 #include <QFile>
+#include <QGraphicsPixmapItem>
 #include <QGraphicsSvgItem>
+#include <QtMath>
 #include <QScrollBar>
 #include <QToolTip>
 #include <QtXml>
-#include <QtXmlPatterns>
 #include <QXmlStreamReader>
 #include <QtDebug>
+#include <algorithm>
+#include "svgexport.h"
 #include "svgview.h"
 
+// Comment used to mark where the content of a fragment is inserted
+static const char contentMark[] = "vle-content";
+// Position of the time axis into the templates (after the group name)
+static const int timeOrigin = 120;
+
 SvgView::SvgView(QWidget *parent)
     : QGraphicsView(parent),
     mGraphicItem(0)
@@ -22,12 +31,24 @@ SvgView::SvgView(QWidget *parent)
     setScene(new QGraphicsScene(this));
     setTransformationAnchor(AnchorUnderMouse);
     setDragMode(ScrollHandDrag);
-    setViewportUpdateMode(FullViewportUpdate);
     setAlignment(Qt::AlignLeft | Qt::AlignTop);
 
-    mSvgRenderer = new QSvgRenderer();
-
-    mPlan = NULL;
+    mTiles = new SvgTiles(this);
+    mTiles->setSource(this);
+    connect(mTiles, SIGNAL(tileReady(QRect,QImage)), this, SLOT(tileReady(QRect,QImage)));
+    connect(mTiles, SIGNAL(tileRemoved(QRect)),      this, SLOT(tileRemoved(QRect)));
+    mScrollSpeedX = 0;
+    mScrollSpeedY = 0;
+    mRubberBand   = new QRubberBand(QRubberBand::Rectangle, viewport());
+    mCursorItem   = NULL;
+    mCursorTick   = vlePlanTime::invalid;
+
+    mCompareMode = Interleaved;
+    mLineCount   = 0;
+    mPlanWidth   = 0;
+    mGapDays     = 0;
+    mAxisGap     = -1;
+    mTreeFilter  = 0;
     mGroupHeight = 50;
     mPixelPerDay = 1;
     mZoomFactor  = 1.15;
@@ -36,19 +57,128 @@ SvgView::SvgView(QWidget *parent)
     mConfig.clear();
 }
 
-void SvgView::convert(const QString &xsltFile)
+void SvgView::exportPdf(SvgExportPdf *pdf, int rowsPerPage, int daysPerPage)
 {
-    (void)xsltFile;
-    QXmlQuery query(QXmlQuery::XSLT20);
-    QString   qOut;
+    // Lines of the view (groups and node summaries), drawn from plan data
+    QVector<SvgExportPdf::Line> lines(mLineCount);
+    for (int row = 0; row < mRows.count(); row++)
+    {
+        const SvgViewRow &r = mRows.at(row);
+        SvgExportPdf::Line &line = lines[r.line];
+        if (line.rows.isEmpty())
+            line.label = lineLabel(r.line);
+
+        SvgExportPdf::Row pdfRow;
+        pdfRow.group  = NULL;
+        pdfRow.offset = (mCompareMode == Overlaid) ? ((r.plan * 6.0) / mGroupHeight) : 0;
+        if (r.group < 0)
+            pdfRow.periods = mTree.aggregate(mPlans.at(r.plan).get(), r.node, &mFilter, r.plan);
+        else
+        {
+            pdfRow.group = mPlans.at(r.plan)->getGroup(r.group);
+            if (mFilter.isActive())
+                pdfRow.visible = mFilter.bitmap(r.plan, r.group);
+        }
+        line.rows.append(pdfRow);
+    }
 
-    // ToDo : This function is a skeleton that can be used for XSLT processing
+    // Colors of activity classes, as configured for the view
+    QHash<QString, QColor> colors;
+    for (int i = 0; i < mConfig.count(); i++)
+    {
+        SvgViewConfig *entry = mConfig.at(i);
+        if (entry->getName() != "color")
+            continue;
+        QStringList keys = entry->getKeys();
+        for (int j = 0; j < keys.count(); j++)
+            colors.insert(keys.at(j), QColor(entry->getKey(keys.at(j))));
+    }
+
+    // Pages are drawn by save(), from the snapshots shown now
+    pdf->setPlans(mPlans);
+    pdf->setLines(lines);
+    pdf->setColors(colors);
+    pdf->setAxis(mAxis, mTime);
+    pdf->setPageLayout(rowsPerPage, daysPerPage);
+}
+
+void SvgView::exportPng(SvgExportPng *png, qreal scale)
+{
+    // Export the current document (as shown by the view). Parts not
+    // rendered yet are generated now, strips are rendered by save().
+    int first, last;
+    mDocument.columnsIn(QRect(QPoint(0, 0), mDocument.size()), &first, &last);
+    ensureTime(first, last);
+    ensureLines(0, mLineCount - 1);
+    png->setDocument(mDocument);
+    png->setScale(scale);
+}
+
+bool SvgView::exportSelection(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+
+    // Dates are written with the resolution of the plans
+    auto format = [this](vlePlanTick tick)
+    {
+        if (mTime.resolution() == vlePlanTime::Day)
+            return mTime.toDate(tick).toString(Qt::ISODate);
+        return mTime.toDateTime(tick).toString("yyyy-MM-ddThh:mm");
+    };
+
+    // Same layout as plan files, so the selection can be loaded again
+    out << "Field;Group;Class;StartDate;EndDate;Path";
+    if ( ! mPlans.isEmpty())
+    {
+        const QStringList &attributes = mPlans.first()->schema().attributeNames();
+        for (int i = 0; i < attributes.count(); i++)
+            out << ';' << attributes.at(i);
+    }
+    out << '\n';
+
+    // Activities are written in the order of the view
+    for (int row = 0; row < mRows.count(); row++)
+    {
+        const SvgViewRow &r = mRows.at(row);
+        if (r.group < 0)
+            continue;
+        QHash<qint64, QSet<int> >::const_iterator sel = mSelection.constFind(groupKey(r.plan, r.group));
+        if (sel == mSelection.constEnd())
+            continue;
+        QList<int> positions = sel.value().toList();
+        std::sort(positions.begin(), positions.end());
 
-    query.setFocus(QUrl(mFilename));
-    query.setQuery(QUrl(xsltFile));
-    query.evaluateTo(&qOut);
+        const vlePlanGroup *group = mPlans.at(r.plan)->getGroup(r.group);
+        for (int j = 0; j < positions.count(); j++)
+        {
+            const vlePlanActivity *a = group->getActivity(positions.at(j));
+            out << csvField(a->getName()) << ';' << csvField(group->getName()) << ';'
+                << csvField(a->getClass()) << ';'
+                << format(group->tickStarts()[positions.at(j)]) << ';'
+                << format(group->tickEnds()  [positions.at(j)]) << ';'
+                << csvField(group->path());
+            for (int k = 0; k < a->attributeCount(); k++)
+                out << ';' << csvField(a->getAttribute(k));
+            out << '\n';
+        }
+    }
 
-    qWarning() << qOut;
+    out.flush();
+    if (file.error() != QFileDevice::NoError)
+    {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
 }
 
 QString SvgView::getTplHeader(void)
@@ -75,7 +205,15 @@ QString SvgView::getTplTime(void)
     return str;
 }
 
-void SvgView::loadPlan(vlePlan *plan)
+void SvgView::loadPlan(const vlePlanSnapshot &plan)
+{
+    QList<vlePlanSnapshot> plans;
+    if (plan)
+        plans.append(plan);
+    loadPlans(plans, mCompareMode);
+}
+
+void SvgView::loadPlans(const QList<vlePlanSnapshot> &plans, CompareMode mode)
 {
     qWarning() << "SvgView::loadPlan";
 
@@ -85,39 +223,110 @@ void SvgView::loadPlan(vlePlan *plan)
         qWarning() << "SvgView::loadPlan() Template error";
         return;
     }
+    if (plans.isEmpty())
+        return;
 
-    // Compute the height of a group
-    if (mTplHeader.hasAttribute("height"))
-        mGroupHeight = mTplHeader.attribute("height").toDouble();
-    else
-        mGroupHeight = 100;
-
-    // Compute size of the whole plan
-    int planHeight = mGroupHeight * (1 + plan->countGroups());
-    int planWidth  = (mMaxWidth * mZoomLevel);
-
-    // Create SVG document
-    QDomDocument planSVG("xml");
-    // Create root element
-    QDomElement e = planSVG.createElement("svg");
-    e.setAttribute("width",   QString(planWidth));
-    e.setAttribute("height",  QString(planHeight));
-    e.setAttribute("viewBox", QString("0 0 %1 %2").arg(planWidth).arg(planHeight));
-    e.setAttribute("version", "1.1");
-
-    QDate dateStart = plan->dateStart();
-    QDate dateEnd   = plan->dateEnd();
+    const vlePlanSnapshot &plan = plans.first();
+
+    // Layout of the previous version, to find what has changed
+    QList<vlePlanSnapshot> oldPlans = mPlans;
+    QVector<QString> oldKeys  = mLineKeys;
+    QList<qint64>    oldSelected = mSelection.keys();
+    vlePlanAxis      oldAxis  = mAxis;
+    int              oldWidth = mPlanWidth;
+    CompareMode      oldMode  = mCompareMode;
+
+    // Update the filter bitmaps of the modified groups (of all the plans)
+    mFilter.setPlans(plans);
+    mOrder.setPlan(plan.get());
+
+    // When two plans are shown, compare them
+    if (plans.count() != 2)
+        mDiff = vlePlanDiff();
+    else if (plans != mPlans)
+        mDiff.compare(plans.at(0).get(), plans.at(1).get());
+
+    // All plans use a common time axis (and the resolution of the first one)
+    QDate dateStart;
+    QDate dateEnd;
+    for (int k = 0; k < plans.count(); k++)
+    {
+        const vlePlanSnapshot &p = plans.at(k);
+        if (p->time().resolution() != plan->time().resolution())
+            qWarning() << "SvgView::loadPlan() Plans with different resolutions";
+        if (p->dateStart().isValid() && (( ! dateStart.isValid()) || (p->dateStart() < dateStart)))
+            dateStart = p->dateStart();
+        if (p->dateEnd().isValid()   && (( ! dateEnd.isValid())   || (p->dateEnd()   > dateEnd)))
+            dateEnd   = p->dateEnd();
+    }
     int nbDays = dateStart.daysTo(dateEnd);
 
+    // Build the time axis : linear, or with breaks on long idle periods. The
+    // segments only depend on the plans, a zoom only changes their scale
+    vlePlanTime time = plan->time();
+    vlePlanTick gap  = ((vlePlanTick)mGapDays * time.ticksPerDay());
+    if ((plans != mPlans) || (gap != mAxisGap) || mAxis.isEmpty())
+    {
+        QList<const vlePlan *> axisPlans;
+        for (int k = 0; k < plans.count(); k++)
+            axisPlans.append(plans.at(k).get());
+        mAxis.build(axisPlans, time.fromDate(dateStart), time.fromDate(dateEnd.addDays(1)), gap);
+        mAxisGap = gap;
+    }
+
+    mPixelPerDay = 1;
+    // With breaks, the active periods share the width left by the breaks
+    if (mAxis.breakCount() > 0)
+    {
+        qreal widgetSize = qMax(mMaxWidth - (mAxis.breakCount() * mAxis.breakWidth()), mMaxWidth / 2);
+        qreal activeDays = qMax((qreal)1, (qreal)mAxis.activeTicks() / time.ticksPerDay());
+        mPixelPerDay = (widgetSize / activeDays);
+    }
     // In the plan duration is more than 1500 days
-    if (nbDays > mMaxWidth)
+    else if (nbDays > mMaxWidth)
     {
         // Update "pixel-per-day" to avoid very large picture
         qreal widgetSize = mMaxWidth;
         mPixelPerDay = (widgetSize / nbDays);
     }
+    // Plans with hours or minutes are short : use the whole width
+    else if (plan->time().resolution() != vlePlanTime::Day)
+        mPixelPerDay = ((qreal)mMaxWidth / (nbDays + 1));
+
+    // Unions of groups, and selection, are only valid for the same plans
+    int oldSelection = selectionCount();
+    if (plans != mPlans)
+    {
+        mTree.clearAggregates();
+        mSelection.clear();
+    }
+    // Unions only contain the activities accepted by the filter
+    if (mFilter.revision() != mTreeFilter)
+    {
+        mTree.clearAggregates();
+        mTreeFilter = mFilter.revision();
+    }
+    // Activities hidden by the filter are removed from the selection
+    QHash<qint64, QSet<int> >::iterator sel = mSelection.begin();
+    while (sel != mSelection.end())
+    {
+        int plan  = (int)(sel.key() >> 32);
+        int group = (int)sel.key();
+        QSet<int>::iterator pos = sel.value().begin();
+        while (pos != sel.value().end())
+        {
+            if ( ! mFilter.accept(plan, group, *pos))
+                pos = sel.value().erase(pos);
+            else
+                ++pos;
+        }
+        if (sel.value().isEmpty())
+            sel = mSelection.erase(sel);
+        else
+            ++sel;
+    }
 
-    if (plan != mPlan)
+    if (plans != mPlans)
     {
     qWarning() << "Plan period is from" << dateStart.toString("dd/MM/yyyy")
             << "to" << dateEnd.toString("dd/MM/yyyy")
@@ -125,125 +334,337 @@ void SvgView::loadPlan(vlePlan *plan)
             << "[" << mPixelPerDay << "pixel per day]";
     }
 
-    // First insert the time rule
-    QDomElement timeGrp = mTplHeader.cloneNode().toElement();
-    updateField(timeGrp, "{{name}}", "");
-    updatePos  (timeGrp, 0, 0);
-    updateAttr (timeGrp, "header_background", "width", QString::number(planWidth));
-    float yLen = (mPixelPerDay * 365 * mZoomLevel);
-    // Show Weeks
-    if (yLen > 2000)
+    mPlans       = plans;
+    mCompareMode = mode;
+    mDateStart   = dateStart;
+    mDateEnd     = dateEnd;
+    mTime        = time;
+    mAxis.setScale((mPixelPerDay * mZoomLevel) / mTime.ticksPerDay(), 20);
+    mPlanWidth   = qMax((int)(mMaxWidth * mZoomLevel), mAxis.width());
+    buildRows(plans);
+
+    // A newer version of the plans (live feed) drawn with the same layout :
+    // only the lines of the groups modified since are generated again
+    bool incremental = ((oldPlans != plans) && (oldPlans.count() == plans.count()) && (oldMode == mode) &&
+                        (oldAxis == mAxis) && (oldWidth == mPlanWidth) && (oldKeys == mLineKeys) &&
+                        ( ! mDocument.isPlain()) && (mPartState.count() == mLineCount));
+    if (incremental)
     {
-        QDate r;
-        if (dateStart.daysInMonth() == 1)
-            r.setDate(dateStart.year(), dateStart.month(), dateStart.day());
-        else
-            r.setDate(dateStart.year(), dateStart.month() + 1, 1);
-        while (r < dateEnd)
+        QSet<int> lines;
+        for (int row = 0; row < mRows.count(); row++)
         {
-            QDomElement newTimeStep = mTplTime.cloneNode().toElement();
-            if (yLen < 5000)
-                updateField(newTimeStep, "{{name}}", r.toString("dd/MM") );
-            else
-                updateField(newTimeStep, "{{name}}", r.toString("dd/MM/yy") );
-            updateAttr (newTimeStep, "step_block", "width", QString::number(4));
-
-            int offset = dateStart.daysTo(r);
-            int aPos = (offset * mPixelPerDay * mZoomLevel);
-            updatePos(newTimeStep, aPos, 0);
-            timeGrp.appendChild(newTimeStep);
-            r = r.addDays(7);
+            const SvgViewRow &r = mRows.at(row);
+            // Summaries are the union of many groups, always generated
+            const vlePlan *old = oldPlans.at(r.plan).get();
+            if ((r.group < 0) || (r.group >= old->countGroups()) ||
+                (old->getGroup(r.group)->revision() != plans.at(r.plan)->getGroup(r.group)->revision()))
+                lines.insert(r.line);
         }
-    }
-    // Show month
-    else if (yLen > 500)
-    {
-        QDate r;
-        if (dateStart.daysInMonth() == 1)
-            r.setDate(dateStart.year(), dateStart.month(), dateStart.day());
-        else
-            r.setDate(dateStart.year(), dateStart.month() + 1, 1);
-        while (r < dateEnd)
+        // Lines where the (now cleared) selection was drawn
+        for (int i = 0; i < oldSelected.count(); i++)
+            lines.insert(mGroupLines.value(oldSelected.at(i), -1));
+
+        QRect changed;
+        QSet<int>::const_iterator line;
+        for (line = lines.constBegin(); line != lines.constEnd(); ++line)
         {
-            QDomElement newTimeStep = mTplTime.cloneNode().toElement();
-            if (yLen < 1000)
-                updateField(newTimeStep, "{{name}}", r.toString("MMM") );
-            else
-                updateField(newTimeStep, "{{name}}", r.toString("MMM yy") );
-            updateAttr (newTimeStep, "step_block", "width", QString::number(4));
-
-            int offset = dateStart.daysTo(r);
-            int aPos = (offset * mPixelPerDay * mZoomLevel);
-            updatePos(newTimeStep, aPos, 0);
-            timeGrp.appendChild(newTimeStep);
-            r = r.addMonths(1);
+            if ((*line < 0) || (*line >= mLineCount))
+                continue;
+            mPartState[*line] &= ~TasksPart;
+            changed |= QRect(0, ((*line + 1) * mGroupHeight), mPlanWidth, mGroupHeight);
         }
+        layoutDocument();
+        mTiles->updateDocument(mDocument.size(), mDocument.spread(changed));
+        updateOverlay();
+        requestTiles();
     }
-    // Show Year
     else
     {
-        QDate r;
-        if (dateStart.dayOfYear() == 1)
-            r.setDate(dateStart.year(), dateStart.month(), dateStart.day());
-        else
-            r.setDate(dateStart.year() + 1, 1, 1);
-        while (r < dateEnd)
-        {
-            QDomElement newTimeStep = mTplTime.cloneNode().toElement();
-            updateField(newTimeStep, "{{name}}", QString::number(r.year()) );
-            updateAttr (newTimeStep, "step_block", "width", QString::number(4));
-
-            int offset = dateStart.daysTo(r);
-            int aPos = (offset * mPixelPerDay * mZoomLevel);
-            updatePos(newTimeStep, aPos, 0);
-            timeGrp.appendChild(newTimeStep);
-            r = r.addYears(1);
-        }
+        // Prepare the parts of the document, lines are generated when rendered
+        generateTime();
+        generateHeaders();
+        generateTasks();
+        layoutDocument();
+
+        mTiles->setDocument(mDocument.size());
+        refresh();
+    }
+    emit planChanged();
+    if (selectionCount() != oldSelection)
+        emit selectionChanged();
+}
+
+bool SvgView::setTemplate(const QString &name, const QString &xml)
+{
+    // Parse the new template (vle: prefix is kept as is)
+    QDomDocument doc;
+    QString error;
+    if ( ! doc.setContent(xml, false, &error))
+    {
+        qWarning() << "SvgView::setTemplate()" << name << error;
+        return false;
+    }
+    QDomElement newTpl = mTplDocument.importNode(doc.documentElement(), true).toElement();
+    newTpl.setAttribute("vle:template", name);
+
+    QDomElement *tpl;
+    if (name == "header")
+        tpl = &mTplHeader;
+    else if (name == "task")
+        tpl = &mTplTask;
+    else if (name == "time")
+        tpl = &mTplTime;
+    else
+        return false;
+
+    if ( ! tpl->isNull())
+        tpl->parentNode().replaceChild(newTpl, *tpl);
+    else
+        mTplRoot.appendChild(newTpl);
+    *tpl = newTpl;
+
+    updateTemplates(name == "header", name == "task", name == "time");
+    return true;
+}
+
+bool SvgView::reloadTemplate(const QString &fileName)
+{
+    QString      oldHeader = serialize(mTplHeader);
+    QString      oldTask   = serialize(mTplTask);
+    QString      oldTime   = serialize(mTplTime);
+
+    if ( ! loadTemplate(fileName))
+        return false;
+
+    // Only the templates that have changed are compiled again
+    bool header = (serialize(mTplHeader) != oldHeader);
+    bool task   = (serialize(mTplTask)   != oldTask);
+    bool time   = (serialize(mTplTime)   != oldTime);
+    updateTemplates(header, task, time);
+
+    return (header || task || time);
+}
+
+void SvgView::updateTemplates(bool header, bool task, bool time)
+{
+    if (mPlans.isEmpty() || mTplHeader.isNull() || ! (header || task || time))
+        return;
+
+    // The header template is also used by the time rule
+    if (header || time)
+        generateTime();
+    if (header)
+        generateHeaders();
+    if (task)
+        generateTasks();
+
+    // Only tiles of the modified parts are rendered again
+    QRect changed;
+    if (header || time)
+        changed |= QRect(0, 0, mPlanWidth, mGroupHeight);
+    if (header || task)
+        changed |= QRect(0, mGroupHeight, mPlanWidth, (mGroupHeight * mLineCount));
+
+    layoutDocument();
+    mTiles->updateDocument(mDocument.size(), mDocument.spread(changed));
+    scene()->setSceneRect(QRectF(QPointF(0, 0), QSizeF(mTiles->documentSize())));
+    updateOverlay();
+    requestTiles();
+    emit planChanged();
+}
+
+QByteArray SvgView::tileDocument(const QRect &area)
+{
+    // Parts drawn into the area are generated now, if not done yet
+    int first, last;
+    mDocument.columnsIn(area, &first, &last);
+    ensureTime(first, last);
+    mDocument.linesIn(area, &first, &last);
+    ensureLines(first, last);
+
+    return mDocument.part(area);
+}
+
+void SvgView::layoutDocument(void)
+{
+    // Compute size of the whole plan
+    int planHeight = mGroupHeight * (1 + mLineCount);
+    mDocument.setLayout(QSize(mPlanWidth, planHeight), mGroupHeight, mLineCount);
+
+    // Lines with a part to generate again are removed from the document
+    for (int line = 0; line < mLineCount; line++)
+    {
+        if (mPartState.at(line) != (HeaderPart | TasksPart))
+            mDocument.setLine(line, QByteArray());
     }
-    e.appendChild(timeGrp);
 
-    // Insert all the known groups
-    for (int i=0; i < plan->countGroups(); i++)
+#ifdef PLAN_OUT
+    int first, last;
+    mDocument.columnsIn(QRect(QPoint(0, 0), mDocument.size()), &first, &last);
+    ensureTime(first, last);
+    ensureLines(0, mLineCount - 1);
+    QFile File("planOut.svg");
+    File.open( QIODevice::WriteOnly );
+    File.write(mDocument.whole());
+    File.close();
+    mFilename = "planOut.svg";
+#else
+    mFilename.clear();
+#endif
+}
+
+void SvgView::ensureLines(int first, int last)
+{
+    last = qMin(last, mDocument.lineCount() - 1);
+    for (int line = first; line <= last; line++)
+    {
+        if (mDocument.isLineReady(line))
+            continue;
+        if ( ! (mPartState.at(line) & HeaderPart))
+            mPartHeaders[line] = generateHeader(line);
+        if ( ! (mPartState.at(line) & TasksPart))
+            mPartTasks[line] = generateTasks(line);
+        mPartState[line] = (HeaderPart | TasksPart);
+
+        // Activities are inserted into the header of the group, then the
+        // line is post-processed (restyle, annotate ...) as it is produced
+        QByteArray grp = mPartHeaders.at(line);
+        grp.replace(QByteArray("<!--") + contentMark + "-->", mPartTasks.at(line));
+        mDocument.setLine(line, mTransforms.apply(grp, true));
+    }
+}
+
+void SvgView::generateHeaders(void)
+{
+    // Compute the height of a group
+    if (mTplHeader.hasAttribute("height"))
+        mGroupHeight = mTplHeader.attribute("height").toDouble();
+    else
+        mGroupHeight = 100;
+
+    // Headers are generated again when their line is rendered
+    mPartHeaders.resize(mLineCount);
+    mPartState.resize(mLineCount);
+    for (int line = 0; line < mLineCount; line++)
+        mPartState[line] &= ~HeaderPart;
+}
+
+QByteArray SvgView::generateHeader(int line)
+{
+    QDomElement newGrp = mTplHeader.cloneNode().toElement();
+    updateField(newGrp, "{{name}}", lineLabel(line));
+    updatePos  (newGrp, 0, 0);
+    updateAttr (newGrp, "header_background", "width", QString::number(mPlanWidth));
+    // Activities are inserted here
+    newGrp.appendChild(mTplDocument.createComment(contentMark));
+
+    return serialize(newGrp).toUtf8();
+}
+
+QString SvgView::lineLabel(int line) const
+{
+    // The header shows the node of the first row of the line
+    const SvgViewRow &r = mRows.at(mLineFirst.at(line));
+    const vlePlanTree::Node &node = mTree.node(r.node);
+
+    // Label is indented by depth, nodes with children show their state
+    QString grpName(node.depth * 3, QChar(0x00A0));
+    if ( ! node.children.isEmpty())
+        grpName += node.expanded ? "- " : "+ ";
+    grpName += node.name;
+    // Interleaved rows show the plan number
+    if ((mPlans.count() > 1) && (mCompareMode == Interleaved))
+        grpName += QString(" #%1").arg(r.plan + 1);
+    return grpName;
+}
+
+void SvgView::generateTasks(void)
+{
+    // Activities are generated again when their line is rendered
+    mPartTasks.resize(mLineCount);
+    mPartState.resize(mLineCount);
+    for (int line = 0; line < mLineCount; line++)
+        mPartState[line] &= ~TasksPart;
+}
+
+QByteArray SvgView::generateTasks(int line)
+{
+    QByteArray part;
+    QVector<qint32> actX;
+    QVector<qint32> actWidth;
+
+    for (int row = mLineFirst.at(line); (row < mRows.count()) && (mRows.at(row).line == line); row++)
     {
-        vlePlanGroup *planGroup = plan->getGroup(i);
+        const SvgViewRow &r = mRows.at(row);
+        // Collapsed nodes show the union of their children
+        if (r.group < 0)
+        {
+            part += generateSummary(r);
+            continue;
+        }
+        vlePlanGroup *planGroup = mPlans.at(r.plan)->getGroup(r.group);
+        QHash<qint64, QSet<int> >::const_iterator sel = mSelection.constFind(groupKey(r.plan, r.group));
         vlePlanActivity *prevActivity = 0;
         int prevLen = 0;
         int prevOffset = 0;
+        // Overlaid plans are drawn with a small vertical offset
+        int yOffset = (mCompareMode == Overlaid) ? (r.plan * 6) : 0;
 
-        // Create a new Group
-        QDomElement newGrp = mTplHeader.cloneNode().toElement();
-        updateField(newGrp, "{{name}}", planGroup->getName());
-        updatePos  (newGrp, 0, ((i + 1) * mGroupHeight));
-        updateAttr (newGrp, "header_background", "width", QString::number(planWidth));
+        // Compute position and size of all activities of the group
+        vlePlanActivity * const *activities = planGroup->activities();
+        actX.resize    (planGroup->count());
+        actWidth.resize(planGroup->count());
+        mAxis.map(planGroup->tickStarts(), planGroup->tickEnds(), planGroup->count(),
+                  0, mPlanWidth, actX.data(), actWidth.data());
 
         for (int j = 0; j < planGroup->count(); j++)
         {
-            vlePlanActivity *planActivity = planGroup->getActivity(j);
+            // Activities outside the plan area, or filtered, are not drawn
+            if ((actWidth.at(j) == 0) || ( ! mFilter.accept(r.plan, r.group, j)))
+                continue;
 
-            QDate actStart = planActivity->dateStart();
-            QDate actEnd   = planActivity->dateEnd();
+            // Differences between two plans are shown with specific colors
+            vlePlanDiff::Status status = vlePlanDiff::Same;
+            if ( ! mDiff.isEmpty())
+                status = (r.plan == 0) ? mDiff.statusA(r.group, j) : mDiff.statusB(r.group, j);
+            // When overlaid, unchanged activities are only drawn once
+            if ((mCompareMode == Overlaid) && (r.plan == 0) &&
+                ( ! mDiff.isEmpty()) && (status == vlePlanDiff::Same))
+                continue;
 
-            qreal actLength = (mPixelPerDay * actStart.daysTo(actEnd) * mZoomLevel);
-            if (actLength < 1)
-                actLength = 1;
+            vlePlanActivity *planActivity = activities[j];
 
             QDomElement newAct = mTplTask.cloneNode().toElement();
             updateField(newAct, "{{name}}", planActivity->getName());
-            updateAttr (newAct, "activity_block", "width", QString::number(actLength));
+            updateAttr (newAct, "activity_block", "width", QString::number(actWidth.at(j)));
 
             QString cfgColor("#00edda");
-            QString activityClass = planActivity->getClass();
+            const QString &activityClass = planActivity->getClass();
             if ( ! activityClass.isEmpty() )
             {
                 QString cfg = getConfig("color", activityClass);
                 if ( ! cfg.isEmpty() )
                     cfgColor = cfg;
             }
+            if (status == vlePlanDiff::Added)
+                cfgColor = "#22aa22";
+            else if (status == vlePlanDiff::Removed)
+                cfgColor = "#cc2222";
+            else if (status == vlePlanDiff::Shifted)
+                cfgColor = "#ee8800";
             QString fillStyle = QString(";fill:%1").arg(cfgColor);
             updateAttr (newAct, "activity_block", "style", fillStyle, false);
+            // Selected activities are highlighted by a thick border
+            if ((sel != mSelection.constEnd()) && sel.value().contains(j))
+            {
+                updateAttr (newAct, "activity_block", "style", ";stroke:#cc2222;stroke-width:3", false);
+                newAct.setAttribute("vle:selected", "1");
+            }
+            // Keep the class, it can be used by transforms
+            if ( ! activityClass.isEmpty())
+                newAct.setAttribute("vle:class", activityClass);
 
-            int date = dateStart.daysTo(planActivity->dateStart());
-            int aPos = (date * mPixelPerDay * mZoomLevel);
+            int aPos = actX.at(j);
 
             if (prevActivity)
             {
@@ -257,37 +678,292 @@ void SvgView::loadPlan(vlePlan *plan)
                     prevOffset = 15;
             }
 
-            updatePos(newAct, aPos, 0);
-            newGrp.appendChild(newAct);
+            updatePos(newAct, aPos, yOffset);
+            part += serialize(newAct).toUtf8();
 
             prevActivity = planActivity;
             prevLen = aPos + (planActivity->getName().size() * 8);
         }
+    }
+    return part;
+}
 
-        e.appendChild(newGrp);
+QByteArray SvgView::generateSummary(const SvgViewRow &r)
+{
+    QByteArray part;
+    int yOffset = (mCompareMode == Overlaid) ? (r.plan * 6) : 0;
+
+    // Periods where at least one activity of the children is running
+    vlePlanIntervals periods = mTree.aggregate(mPlans.at(r.plan).get(), r.node, &mFilter, r.plan);
+    QVector<qint32> actX    (periods.starts.count());
+    QVector<qint32> actWidth(periods.starts.count());
+    mAxis.map(periods.starts.constData(), periods.ends.constData(), periods.starts.count(),
+              0, mPlanWidth, actX.data(), actWidth.data());
+
+    for (int j = 0; j < periods.starts.count(); j++)
+    {
+        if (actWidth.at(j) == 0)
+            continue;
+        QDomElement newAct = mTplTask.cloneNode().toElement();
+        updateField(newAct, "{{name}}", "");
+        updateAttr (newAct, "activity_block", "width", QString::number(actWidth.at(j)));
+        updateAttr (newAct, "activity_block", "style", ";fill:#888888", false);
+        updatePos  (newAct, actX.at(j), yOffset);
+        part += serialize(newAct).toUtf8();
     }
-    planSVG.appendChild( e );
+    return part;
+}
 
-    QByteArray data;
-    QTextStream stream(&data);
-    planSVG.save(stream, QDomNode::EncodingFromTextStream);
+void SvgView::generateTime(void)
+{
+    // First insert the frame of the time rule, steps are generated by column
+    QDomElement timeGrp = mTplHeader.cloneNode().toElement();
+    updateField(timeGrp, "{{name}}", "");
+    updatePos  (timeGrp, 0, 0);
+    updateAttr (timeGrp, "header_background", "width", QString::number(mPlanWidth));
+    mDocument.setTime(mTransforms.apply(serialize(timeGrp).toUtf8(), true));
+}
 
-#ifdef PLAN_OUT
-    QFile File("planOut.svg");
-    File.open( QIODevice::WriteOnly );
-    QTextStream TextStream(&File);
-    planSVG.save(TextStream, 0);
-    File.close();
-    mFilename = "planOut.svg";
-#else
-    mFilename.clear();
-#endif
+QByteArray SvgView::generateTime(int column)
+{
+    // Only the steps drawn into this column of the rule
+    qint32 x0 = (column * SvgTileDocument::columnWidth);
+    qint32 x1 = (x0 + SvgTileDocument::columnWidth);
 
-    mPlan = plan;
+    QDomElement timeGrp = mTplTime.ownerDocument().createElement("g");
+    float yLen = (mPixelPerDay * 365 * mZoomLevel);
+    float dLen = (mPixelPerDay * mZoomLevel);
+    // Show minutes (by steps of 15 minutes) or hours, if the plan has them
+    if (((dLen > 5760) && (mTime.resolution() == vlePlanTime::Minute)) ||
+        ((dLen > 960)  && (mTime.resolution() != vlePlanTime::Day)))
+    {
+        vlePlanTime minutes(vlePlanTime::Minute);
+        int step = ((dLen > 5760) && (mTime.resolution() == vlePlanTime::Minute)) ? 15 : 60;
+        qint64 origin = minutes.fromDate(mDateStart);
+        qint64 end    = minutes.fromDate(mDateEnd.addDays(1));
+        // Start from the step before the column (pixels are rounded)
+        qint64 first  = mTime.toMinutes(mAxis.toTick(x0));
+        qint64 m = origin + (qMax((qint64)0, ((first - origin) / step) - 1) * step);
+        for ( ; m < end; m += step)
+        {
+            vlePlanTick tick = mTime.fromMinutes(m);
+            // Steps inside a break are not shown
+            if (mAxis.isBreak(tick))
+                continue;
+            int aPos = mAxis.toPixel(tick);
+            if (aPos >= x1)
+                break;
+            if (aPos < x0)
+                continue;
+            // The first step of each day shows the date
+            QDateTime r = minutes.toDateTime(m);
+            if (r.time() == QTime(0, 0))
+                appendTimeStep(timeGrp, r.toString("dd/MM hh:mm"), 2, aPos);
+            else
+                appendTimeStep(timeGrp, r.toString("hh:mm"), 2, aPos);
+        }
+    }
+    // Show Weeks
+    else if (yLen > 2000)
+    {
+        QDate r;
+        if (mDateStart.daysInMonth() == 1)
+            r.setDate(mDateStart.year(), mDateStart.month(), mDateStart.day());
+        else
+            r.setDate(mDateStart.year(), mDateStart.month() + 1, 1);
+        // Start from the week before the column
+        qint64 weeks = (r.daysTo(mTime.toDate(mAxis.toTick(x0))) / 7) - 1;
+        if (weeks > 0)
+            r = r.addDays(weeks * 7);
+        for ( ; r < mDateEnd; r = r.addDays(7))
+        {
+            // Steps inside a break are not shown
+            if (mAxis.isBreak(mTime.fromDate(r)))
+                continue;
+            int aPos = mAxis.toPixel(mTime.fromDate(r));
+            if (aPos >= x1)
+                break;
+            if (aPos < x0)
+                continue;
+            if (yLen < 5000)
+                appendTimeStep(timeGrp, r.toString("dd/MM"), 4, aPos);
+            else
+                appendTimeStep(timeGrp, r.toString("dd/MM/yy"), 4, aPos);
+        }
+    }
+    // Show month
+    else if (yLen > 500)
+    {
+        QDate r;
+        if (mDateStart.daysInMonth() == 1)
+            r.setDate(mDateStart.year(), mDateStart.month(), mDateStart.day());
+        else
+            r.setDate(mDateStart.year(), mDateStart.month() + 1, 1);
+        for ( ; r < mDateEnd; r = r.addMonths(1))
+        {
+            // Steps inside a break are not shown
+            if (mAxis.isBreak(mTime.fromDate(r)))
+                continue;
+            int aPos = mAxis.toPixel(mTime.fromDate(r));
+            if (aPos >= x1)
+                break;
+            if (aPos < x0)
+                continue;
+            if (yLen < 1000)
+                appendTimeStep(timeGrp, r.toString("MMM"), 4, aPos);
+            else
+                appendTimeStep(timeGrp, r.toString("MMM yy"), 4, aPos);
+        }
+    }
+    // Show Year
+    else
+    {
+        QDate r;
+        if (mDateStart.dayOfYear() == 1)
+            r.setDate(mDateStart.year(), mDateStart.month(), mDateStart.day());
+        else
+            r.setDate(mDateStart.year() + 1, 1, 1);
+        for ( ; r < mDateEnd; r = r.addYears(1))
+        {
+            // Steps inside a break are not shown
+            if (mAxis.isBreak(mTime.fromDate(r)))
+                continue;
+            int aPos = mAxis.toPixel(mTime.fromDate(r));
+            if (aPos >= x1)
+                break;
+            if (aPos < x0)
+                continue;
+            appendTimeStep(timeGrp, QString::number(r.year()), 4, aPos);
+        }
+    }
+    // Show the breaks of the axis (idle periods removed from the plan)
+    for (int i = 0; i < mAxis.count(); i++)
+    {
+        const vlePlanAxis::Segment &seg = mAxis.segment(i);
+        if (( ! seg.isBreak) || (seg.pixelStart < x0) || (seg.pixelStart >= x1))
+            continue;
+        QDomElement newTimeStep = mTplTime.cloneNode().toElement();
+        updateField(newTimeStep, "{{name}}", "//");
+        updateAttr (newTimeStep, "step_block", "width", QString::number(seg.pixelEnd - seg.pixelStart));
+        updateAttr (newTimeStep, "step_block", "style", ";fill:#bbbbbb", false);
+        updatePos(newTimeStep, seg.pixelStart, 0);
+        timeGrp.appendChild(newTimeStep);
+    }
+    return mTransforms.apply(serialize(timeGrp).toUtf8(), true);
+}
 
-    QXmlStreamReader xData(data);
-    mSvgRenderer->load(&xData);
-    refresh();
+void SvgView::appendTimeStep(QDomElement &grp, const QString &name, int width, int x)
+{
+    QDomElement newTimeStep = mTplTime.cloneNode().toElement();
+    updateField(newTimeStep, "{{name}}", name);
+    updateAttr (newTimeStep, "step_block", "width", QString::number(width));
+    updatePos(newTimeStep, x, 0);
+    grp.appendChild(newTimeStep);
+}
+
+void SvgView::ensureTime(int first, int last)
+{
+    for (int column = first; column <= last; column++)
+    {
+        if ( ! mDocument.isColumnReady(column))
+            mDocument.setTimeColumn(column, generateTime(column));
+    }
+}
+
+QString SvgView::serialize(const QDomNode &node)
+{
+    QString str;
+    QTextStream stream(&str);
+    node.save(stream, 1);
+    return str;
+}
+
+void SvgView::buildRows(const QList<vlePlanSnapshot> &plans)
+{
+    const vlePlan *first = plans.first().get();
+
+    // Groups of the first plan accepted by the filter into one of the plans
+    // (in the active order) ...
+    QStringList names;
+    QStringList paths;
+    QSet<QString> known;
+    const QVector<int> &order = mOrder.permutation();
+    for (int n = 0; n < order.count(); n++)
+    {
+        int i = order.at(n);
+        const QString &name = first->getGroup(i)->getName();
+        known.insert(name);
+        bool visible = mFilter.acceptGroup(0, i);
+        for (int k = 1; (k < plans.count()) && ( ! visible); k++)
+        {
+            int j = plans.at(k)->groupIndex(name);
+            visible = (j >= 0) && mFilter.acceptGroup(k, j);
+        }
+        if (visible)
+        {
+            names.append(name);
+            paths.append(first->getGroup(i)->path());
+        }
+    }
+    // ... then groups only found into other plans
+    for (int k = 1; k < plans.count(); k++)
+    {
+        const vlePlan *p = plans.at(k).get();
+        for (int i = 0; i < p->countGroups(); i++)
+        {
+            const QString &name = p->getGroup(i)->getName();
+            if (known.contains(name) || ( ! mFilter.acceptGroup(k, i)))
+                continue;
+            known.insert(name);
+            names.append(name);
+            paths.append(p->getGroup(i)->path());
+        }
+    }
+    // Tree of groups is built again only when they have changed
+    mTree.build(names, paths, mGroupSeparator);
+
+    // Visible nodes of the tree are interleaved (one line per plan) or overlaid
+    mRows.clear();
+    mLineFirst.clear();
+    mLineKeys.clear();
+    mGroupLines.clear();
+    QVector<int> nodes = mTree.visible();
+    int line = 0;
+    for (int n = 0; n < nodes.count(); n++)
+    {
+        bool summary = mTree.isSummary(nodes.at(n));
+        bool used = false;
+        for (int k = 0; k < plans.count(); k++)
+        {
+            int group = -1;
+            if ( ! summary)
+            {
+                group = plans.at(k)->groupIndex(mTree.groupName(nodes.at(n)));
+                if (group < 0)
+                    continue;
+            }
+            if (mLineFirst.count() == line)
+            {
+                mLineFirst.append(mRows.count());
+                mLineKeys.append(mTree.node(nodes.at(n)).key + QChar('#') +
+                                 ((mCompareMode == Interleaved) ? QString::number(k) : QString()));
+            }
+            SvgViewRow row;
+            row.line  = line;
+            row.plan  = k;
+            row.group = group;
+            row.node  = nodes.at(n);
+            mRows.append(row);
+            if (group >= 0)
+                mGroupLines.insert(groupKey(k, group), line);
+            used = true;
+            if (mCompareMode == Interleaved)
+                line++;
+        }
+        if (used && (mCompareMode == Overlaid))
+            line++;
+    }
+    mLineCount = line;
 }
 
 void SvgView::loadFile(QString fileName)
@@ -298,10 +974,9 @@ void SvgView::loadFile(QString fileName)
 
     QFile file(fileName);
     file.open(QIODevice::ReadOnly);
-    QXmlStreamReader xmlReader( file.readAll() );
+    mDocument.setPlain(file.readAll());
     file.close();
-
-    mSvgRenderer->load(&xmlReader);
+    mTiles->setDocument(mDocument.size());
 
     refresh();
 }
@@ -355,23 +1030,91 @@ bool SvgView::loadTemplate(QString fileName)
 void SvgView::refresh(void)
 {
     QGraphicsScene *s = scene();
-    QPixmap Image(mSvgRenderer->defaultSize());
-    QPainter Painter;
-
-    Image.fill(Qt::transparent);
 
     qWarning() << "SVG refresh() zoom factor" << mZoomLevel;
-    Painter.begin(&Image);
-    mSvgRenderer->render(&Painter);
-    Painter.end();
+
+    // Remove old tiles, and resize the scene for the new document
     s->clear();
-    s->addPixmap(Image);
+    mTileItems.clear();
+    mCursorItem = NULL;
+    mHighlightItems.clear();
+    mTiles->invalidate();
+    s->setSceneRect(QRectF(QPointF(0, 0), QSizeF(mTiles->documentSize())));
+    updateOverlay();
+
+    // Tiles are rendered by worker threads, and inserted when ready
+    requestTiles();
+}
+
+void SvgView::requestTiles(void)
+{
+    QRect visible = mapToScene(viewport()->rect()).boundingRect().toAlignedRect();
+
+    // Prefetch the area where the viewport will be in a short time
+    const qreal lookAhead = 400; // milliseconds
+    int dx = qBound(-2 * visible.width(),  qRound(mScrollSpeedX * lookAhead), 2 * visible.width());
+    int dy = qBound(-2 * visible.height(), qRound(mScrollSpeedY * lookAhead), 2 * visible.height());
+
+    QRect prefetch;
+    // Small moves don't need prefetch, tiles around are already there
+    if ((qAbs(dx) > (mTiles->tileSize() / 2)) || (qAbs(dy) > (mTiles->tileSize() / 2)))
+        prefetch = visible.translated(dx, dy);
+
+    mTiles->request(visible, prefetch);
+    emit viewChanged();
+}
+
+void SvgView::tileReady(const QRect &rect, const QImage &image)
+{
+    QGraphicsPixmapItem *item = scene()->addPixmap(QPixmap::fromImage(image));
+    item->setPos(rect.topLeft());
+
+    // If an old version of this tile exists, replace it
+    delete mTileItems.value(mTiles->key(rect), NULL);
+    mTileItems.insert(mTiles->key(rect), item);
+}
+
+void SvgView::tileRemoved(const QRect &rect)
+{
+    // Deleting the item remove it from the scene
+    delete mTileItems.take(mTiles->key(rect));
 }
 
 void SvgView::reload(void)
 {
-    if (mPlan)
-        loadPlan(mPlan);
+    if ( ! mPlans.isEmpty())
+        loadPlans(mPlans, mCompareMode);
+}
+
+SvgTransformChain *SvgView::transforms(void)
+{
+    return &mTransforms;
+}
+
+const vlePlanDiff &SvgView::diff(void) const
+{
+    return mDiff;
+}
+
+vlePlanFilter *SvgView::filter(void)
+{
+    return &mFilter;
+}
+
+vlePlanOrder *SvgView::order(void)
+{
+    return &mOrder;
+}
+
+void SvgView::setOrder(vlePlanOrder::Key key)
+{
+    if (key == mOrder.key())
+        return;
+    mOrder.setKey(key);
+
+    // Lines are only moved : their fragments are reused
+    if ( ! mPlans.isEmpty())
+        relayout(-1, 0);
 }
 
 QString SvgView::getConfig(QString c, QString key)
@@ -415,53 +1158,389 @@ void SvgView::setConfig(QString c, QString key, QString value)
         entry->removeKey(key);
 }
 
+const vlePlanAxis &SvgView::axis(void) const
+{
+    return mAxis;
+}
+
+// Scene position of the first pixel of the axis
+int SvgView::axisOrigin(void) const
+{
+    return timeOrigin;
+}
+
+int SvgView::groupHeight(void) const
+{
+    return mGroupHeight;
+}
+
+int SvgView::lineCount(void) const
+{
+    return mLineCount;
+}
+
+const QList<vlePlanSnapshot> &SvgView::plans(void) const
+{
+    return mPlans;
+}
+
+const QVector<SvgViewRow> &SvgView::rows(void) const
+{
+    return mRows;
+}
+
+// Groups of a plan shown by a summary row (all the groups under its node)
+QVector<int> SvgView::summaryGroups(const SvgViewRow &r) const
+{
+    QVector<int> groups;
+    if ((r.plan < 0) || (r.plan >= mPlans.count()) || (r.node < 0) || (r.node >= mTree.count()))
+        return groups;
+
+    const vlePlan *plan = mPlans.at(r.plan).get();
+    QStringList names = mTree.groupNames(r.node);
+    for (int i = 0; i < names.count(); i++)
+    {
+        int g = plan->groupIndex(names.at(i));
+        if (g >= 0)
+            groups.append(g);
+    }
+    return groups;
+}
+
+void SvgView::setGapCompression(int minDays)
+{
+    // Idle periods longer than minDays become breaks (0 = linear axis)
+    mGapDays = qMax(0, minDays);
+}
+
+void SvgView::setGroupSeparator(const QString &separator)
+{
+    // Used when the plan is loaded again
+    mGroupSeparator = separator;
+}
+
 void SvgView::setZommFactor(qreal factor)
 {
     mZoomFactor = factor;
 }
 
+void SvgView::setTimeCursor(vlePlanTick tick)
+{
+    mCursorTick = tick;
+
+    if (mCursorItem == NULL)
+    {
+        mCursorItem = scene()->addLine(QLineF(), QPen(QColor("#cc2222"), 2));
+        mCursorItem->setZValue(2);
+    }
+    if (mPlans.isEmpty() || (tick == vlePlanTime::invalid))
+    {
+        mCursorItem->hide();
+        return;
+    }
+    // Only the line is moved, tiles are not rendered again
+    qreal x = (timeOrigin + mAxis.toPixel(tick));
+    mCursorItem->setLine(x, 0, x, sceneRect().height());
+    mCursorItem->show();
+}
+
+void SvgView::setGroupHighlight(int group, bool enable)
+{
+    if (enable == mHighlight.contains(group))
+        return;
+
+    if (enable)
+    {
+        mHighlight.insert(group);
+        addHighlight(group);
+    }
+    else
+    {
+        mHighlight.remove(group);
+        delete mHighlightItems.take(group);
+    }
+}
+
+void SvgView::addHighlight(int group)
+{
+    // Groups hidden (filtered or into a collapsed node) have no line
+    int line = mGroupLines.value(groupKey(0, group), -1);
+    if (line < 0)
+        return;
+
+    // The name of the group is highlighted
+    QGraphicsRectItem *item = scene()->addRect(0, ((line + 1) * mGroupHeight), timeOrigin, mGroupHeight,
+                                               Qt::NoPen, QColor(255, 220, 0, 120));
+    item->setZValue(1);
+    mHighlightItems.insert(group, item);
+}
+
+void SvgView::updateOverlay(void)
+{
+    // Lines have moved : highlights are placed again
+    qDeleteAll(mHighlightItems);
+    mHighlightItems.clear();
+    QSet<int>::const_iterator it;
+    for (it = mHighlight.constBegin(); it != mHighlight.constEnd(); ++it)
+        addHighlight(*it);
+
+    if (mCursorItem || (mCursorTick != vlePlanTime::invalid))
+        setTimeCursor(mCursorTick);
+}
+
+int SvgView::selectionCount(void) const
+{
+    int count = 0;
+    QHash<qint64, QSet<int> >::const_iterator it;
+    for (it = mSelection.constBegin(); it != mSelection.constEnd(); ++it)
+        count += it.value().count();
+    return count;
+}
+
+QString SvgView::csvField(const QString &value)
+{
+    // Values with a separator (or a quote) are quoted, quotes are doubled
+    if ( ! (value.contains(QChar(';')) || value.contains(QChar('"'))))
+        return value;
+    QString quoted = value;
+    quoted.replace(QChar('"'), QString("\"\""));
+    return QChar('"') + quoted + QChar('"');
+}
+
+void SvgView::clearSelection(void)
+{
+    setSelection(QHash<qint64, QSet<int> >());
+}
+
+qint64 SvgView::groupKey(int plan, int group)
+{
+    return (((qint64)plan << 32) | (quint32)group);
+}
+
+void SvgView::select(const QRectF &area, bool add)
+{
+    QHash<qint64, QSet<int> > selection;
+    if (add)
+        selection = mSelection;
+
+    // Lines covered by the area (the first line of the view is the time rule)
+    int lineFirst = qMax(0, (int)(area.top() / mGroupHeight) - 1);
+    int lineLast  = qMin((mLineCount - 1), (int)(area.bottom() / mGroupHeight) - 1);
+    // Pixels covered by the area (a click is one pixel wide)
+    qint32 x0 = ((int)area.left()  - timeOrigin);
+    qint32 x1 = ((int)area.right() - timeOrigin + 1);
+
+    // Only the rows of these lines are searched, with the same test as the
+    // tooltip : what is selected is what is drawn under the mouse
+    QVector<int> hits;
+    for (int line = lineFirst; line <= lineLast; line++)
+    {
+        for (int row = mLineFirst.at(line); (row < mRows.count()) && (mRows.at(row).line == line); row++)
+        {
+            const SvgViewRow &r = mRows.at(row);
+            hitTest(r, x0, x1, &hits);
+            for (int j = 0; j < hits.count(); j++)
+                selection[groupKey(r.plan, r.group)].insert(hits.at(j));
+        }
+    }
+    setSelection(selection);
+}
+
+void SvgView::hitTest(const SvgViewRow &r, qint32 x0, qint32 x1, QVector<int> *out) const
+{
+    out->clear();
+    // Summary rows have no activity
+    if ((r.group < 0) || (x1 <= x0))
+        return;
+
+    // Candidates around the pixels (plus the one pixel minimum width of
+    // very short activities), from the interval index of the group
+    const vlePlanGroup *group = mPlans.at(r.plan)->getGroup(r.group);
+    QVector<int> hits;
+    group->overlaps(mAxis.toTick(x0 - 1) - 1, mAxis.toTick(x1) + 1, &hits);
+    if (hits.isEmpty())
+        return;
+
+    // Convert candidates dates to pixels, clipped to the tested pixels
+    QVector<vlePlanTick> starts(hits.count());
+    QVector<vlePlanTick> ends  (hits.count());
+    for (int j = 0; j < hits.count(); j++)
+    {
+        starts[j] = group->tickStarts()[hits.at(j)];
+        ends[j]   = group->tickEnds()  [hits.at(j)];
+    }
+    QVector<qint32> x    (hits.count());
+    QVector<qint32> width(hits.count());
+    mAxis.map(starts.constData(), ends.constData(), hits.count(), x0, x1, x.data(), width.data());
+
+    // Activities not drawn on these pixels (or hidden) are not hit
+    for (int j = 0; j < hits.count(); j++)
+    {
+        if ((width.at(j) == 0) || ( ! mFilter.accept(r.plan, r.group, hits.at(j))))
+            continue;
+        out->append(hits.at(j));
+    }
+}
+
+void SvgView::setSelection(const QHash<qint64, QSet<int> > &selection)
+{
+    // Lines of the groups where the selection has changed
+    QSet<int> lines;
+    QHash<qint64, QSet<int> >::const_iterator it;
+    for (it = mSelection.constBegin(); it != mSelection.constEnd(); ++it)
+    {
+        if (selection.value(it.key()) != it.value())
+            lines.insert(mGroupLines.value(it.key(), -1));
+    }
+    for (it = selection.constBegin(); it != selection.constEnd(); ++it)
+    {
+        if ( ! mSelection.contains(it.key()))
+            lines.insert(mGroupLines.value(it.key(), -1));
+    }
+    mSelection = selection;
+    if (lines.isEmpty())
+        return;
+
+    // Only activities of these lines are generated again
+    QRect changed;
+    QSet<int>::const_iterator line;
+    for (line = lines.constBegin(); line != lines.constEnd(); ++line)
+    {
+        if (*line < 0)
+            continue;
+        mPartState[*line] &= ~TasksPart;
+        changed |= QRect(0, ((*line + 1) * mGroupHeight), mPlanWidth, mGroupHeight);
+    }
+    if ( ! changed.isEmpty())
+    {
+        layoutDocument();
+        mTiles->updateDocument(mDocument.size(), mDocument.spread(changed));
+        requestTiles();
+    }
+    emit selectionChanged();
+}
+
+void SvgView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    // Double click on a line expands or collapses its node
+    int line = (int)(mapToScene(event->pos()).y() / mGroupHeight) - 1;
+    if (mPlans.isEmpty() || (line < 0) || (line >= mLineCount))
+    {
+        QGraphicsView::mouseDoubleClickEvent(event);
+        return;
+    }
+    toggleNode(line);
+}
+
+void SvgView::toggleNode(int line)
+{
+    int node = mRows.at(mLineFirst.at(line)).node;
+    if (mTree.node(node).children.isEmpty())
+        return;
+    mTree.setExpanded(node, ! mTree.node(node).expanded);
+    // Interleaved plans : the node may start at a line above
+    while ((line > 0) && (mRows.at(mLineFirst.at(line - 1)).node == node))
+        line--;
+
+    relayout(node, line);
+}
+
+void SvgView::relayout(int node, int line)
+{
+    // Fragments of the lines shown before, by node and plan
+    QHash<QString, int> oldLines;
+    for (int l = 0; l < mLineCount; l++)
+        oldLines.insert(mLineKeys.at(l), l);
+    QVector<QByteArray> oldHeaders  = mPartHeaders;
+    QVector<QByteArray> oldTasks    = mPartTasks;
+    QVector<int>        oldState    = mPartState;
+    SvgTileDocument     oldDocument = mDocument;
+    int oldCount = mLineCount;
+
+    buildRows(mPlans);
+
+    // Only the lines of the modified node, and the new ones, are generated
+    // (when rendered). Other lines keep their fragments, they have only moved.
+    QVector<int> moved(mLineCount, -1);
+    mPartHeaders.fill(QByteArray(), mLineCount);
+    mPartTasks.fill(QByteArray(), mLineCount);
+    mPartState.fill(0, mLineCount);
+    for (int l = 0; l < mLineCount; l++)
+    {
+        int old = oldLines.value(mLineKeys.at(l), -1);
+        if ((old < 0) || (mRows.at(mLineFirst.at(l)).node == node))
+            continue;
+        mPartHeaders[l] = oldHeaders.at(old);
+        mPartTasks[l]   = oldTasks.at(old);
+        mPartState[l]   = oldState.at(old);
+        moved[l] = old;
+    }
+    mDocument.setLayout(mDocument.size(), mGroupHeight, mLineCount);
+    for (int l = 0; l < mLineCount; l++)
+        mDocument.setLine(l, (moved.at(l) < 0) ? QByteArray() : oldDocument.line(moved.at(l)));
+    layoutDocument();
+
+    // Lines above the first modified line have not moved, their tiles are kept
+    int top = ((line + 1) * mGroupHeight);
+    QRect changed(0, top, mPlanWidth, (qMax(oldCount, mLineCount) + 1) * mGroupHeight - top);
+    mTiles->updateDocument(mDocument.size(), mDocument.spread(changed));
+    scene()->setSceneRect(QRectF(QPointF(0, 0), QSizeF(mTiles->documentSize())));
+    updateOverlay();
+    requestTiles();
+    emit planChanged();
+}
+
 void SvgView::mouseMoveEvent(QMouseEvent *event)
 {
-    if (mPlan == NULL)
+    // Rubber band selection in progress
+    if (mRubberBand->isVisible())
+    {
+        mRubberBand->setGeometry(QRect(mPressPos, event->pos()).normalized());
+        return;
+    }
+
+    // Let the view handle the "hand drag" scrolling
+    QGraphicsView::mouseMoveEvent(event);
+
+    if (mPlans.isEmpty())
         return;
 
-    // Search the group at the current mouse Y
+    // Search the line at the current mouse Y
     QPoint pos = event->pos();
-    int mouseGroup = pos.y() / mGroupHeight;
+    QPointF scenePos = mapToScene(pos);
+    int mouseGroup = (int)(scenePos.y() / mGroupHeight);
     // If mouse is outside the plan, nothing to do
     if ( (mouseGroup == 0) ||
-         (mouseGroup > mPlan->countGroups()) )
+         (mouseGroup > mLineCount) )
     {
         if (QToolTip::isVisible())
             QToolTip::hideText();
         return;
     }
 
-    vlePlanGroup *planGroup = mPlan->getGroup(mouseGroup - 1);
-    QDate dateStart = mPlan->dateStart();
-
     // Get mouse X position
-    int currentX = horizontalScrollBar()->value() + pos.x();
-    int mouseTimePos = (currentX - 120);
-
-    // Search if the mouse is over one acivity of the current group
-    for (int j = 0; j < planGroup->count(); j++)
-    {
-        vlePlanActivity *planActivity = planGroup->getActivity(j);
-        // Convert activity date to "days from the begining of the plan"
-        int dataOffsetStart = dateStart.daysTo(planActivity->dateStart());
-        int dateOffsetEnd   = dateStart.daysTo(planActivity->dateEnd());
-        // Convert this number of days to pixels/coordinates
-        int startPos = (dataOffsetStart * mPixelPerDay * mZoomLevel);
-        int endPos   = (dateOffsetEnd   * mPixelPerDay * mZoomLevel);
-        // Compare activity start/end to the current mouse position
-        if ( (mouseTimePos >= startPos) &&
-             (mouseTimePos <= endPos) )
+    int mouseTimePos = ((int)scenePos.x() - timeOrigin);
+
+    // Rows are sorted by line, all the rows of the line are tested
+    QVector<int> hits;
+    for (int row = mLineFirst.at(mouseGroup - 1); row < mRows.count(); row++)
+    {
+        const SvgViewRow &r = mRows.at(row);
+        if (r.line != (mouseGroup - 1))
+            break;
+
+        // Search if the mouse is over one acivity of the current group
+        hitTest(r, mouseTimePos, (mouseTimePos + 1), &hits);
+        const vlePlanGroup *planGroup = (r.group < 0) ? NULL : mPlans.at(r.plan)->getGroup(r.group);
+        for (int j = 0; j < hits.count(); j++)
         {
+            vlePlanActivity *planActivity = planGroup->getActivity(hits.at(j));
             if ( ( planActivity->attributeCount() ) &&
                  ( ! QToolTip::isVisible()) )
             {
                 QString newMsg(planActivity->getName());
+                if (mPlans.count() > 1)
+                    newMsg += QString(" (#%1)").arg(r.plan + 1);
 
                 for (int k = 0; k < planActivity->attributeCount(); k++)
                     newMsg += "\n" + planActivity->getAttribute(k);
@@ -472,6 +1551,71 @@ void SvgView::mouseMoveEvent(QMouseEvent *event)
     }
 }
 
+void SvgView::mousePressEvent(QMouseEvent *event)
+{
+    mPressPos = event->pos();
+
+    // Shift + drag selects the activities into a rectangle
+    if ((event->button() == Qt::LeftButton) && (event->modifiers() & Qt::ShiftModifier))
+    {
+        mRubberBand->setGeometry(QRect(mPressPos, QSize()));
+        mRubberBand->show();
+        return;
+    }
+    QGraphicsView::mousePressEvent(event);
+}
+
+void SvgView::mouseReleaseEvent(QMouseEvent *event)
+{
+    bool add = (event->modifiers() & Qt::ControlModifier);
+
+    if (mRubberBand->isVisible())
+    {
+        mRubberBand->hide();
+        QRect area = QRect(mPressPos, event->pos()).normalized();
+        select(mapToScene(area).boundingRect(), add);
+        return;
+    }
+    QGraphicsView::mouseReleaseEvent(event);
+
+    // A click (without drag) selects the activity under the mouse
+    if ((event->button() == Qt::LeftButton) &&
+        ((event->pos() - mPressPos).manhattanLength() < QApplication::startDragDistance()))
+    {
+        QPointF pos = mapToScene(event->pos());
+        select(QRectF(pos, QSizeF(0, 0)), add);
+    }
+}
+
+void SvgView::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+    requestTiles();
+}
+
+void SvgView::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+
+    // Update scroll speed (content moves opposite to the viewport)
+    qint64 elapsed = mScrollTimer.isValid() ? mScrollTimer.restart() : 0;
+    if ( ! mScrollTimer.isValid())
+        mScrollTimer.start();
+    if ((elapsed > 0) && (elapsed < 250))
+    {
+        mScrollSpeedX = (0.6 * mScrollSpeedX) + (0.4 * (-dx / (qreal)elapsed));
+        mScrollSpeedY = (0.6 * mScrollSpeedY) + (0.4 * (-dy / (qreal)elapsed));
+    }
+    else
+    {
+        // First move after a pause, direction is not known yet
+        mScrollSpeedX = 0;
+        mScrollSpeedY = 0;
+    }
+
+    requestTiles();
+}
+
 void SvgView::wheelEvent(QWheelEvent* event)
 {
     if(event->delta() > 0)
@@ -482,7 +1626,7 @@ void SvgView::wheelEvent(QWheelEvent* event)
             mZoomLevel = (mZoomLevel / mZoomFactor);
     }
 
-    loadPlan(mPlan);
+    reload();
 }
 
 void SvgView::updateAttr(QDomNode &node, QString selector, QString tag, QString value, bool replace)
@@ -8,12 +8,23 @@
 #ifndef SVGVIEW_H
 #define SVGVIEW_H
 
+#include <QElapsedTimer>
+#include <QGraphicsPixmapItem>
 #include <QGraphicsView>
-#include <QSvgRenderer>
 #include <QtXml>
 #include <QMouseEvent>
+#include <QResizeEvent>
+#include <QRubberBand>
 #include <QWheelEvent>
+#include "svgexport.h"
+#include "svgtiles.h"
+#include "svgtransform.h"
 #include "vlePlan.h"
+#include "vlePlanAxis.h"
+#include "vlePlanDiff.h"
+#include "vlePlanFilter.h"
+#include "vlePlanOrder.h"
+#include "vlePlanTree.h"
 
 class SvgViewConfig
 {
@@ -21,6 +32,7 @@ public:
     SvgViewConfig() { }
     QString getName(void)      { return mName; }
     QString getKey (QString k) { return mConfig.value(k); }
+    QStringList getKeys(void)  { return mConfig.keys(); }
     void    setName(QString v) { mName = v; }
     void    setKey (QString k, QString v) { mConfig.insert(k, v); }
     void removeKey (QString k) { mConfig.remove(k); }
@@ -29,48 +41,160 @@ private:
     QMap<QString, QString> mConfig;
 };
 
-class SvgView: public QGraphicsView
+// One row of groups : a group of one of the plans, drawn at a line of the view
+struct SvgViewRow
+{
+    int line;
+    int plan;
+    int group;  // -1 for the summary of a node (union of its children)
+    int node;   // Node of the groups tree
+};
+
+class SvgView: public QGraphicsView, public SvgTileSource
 {
     Q_OBJECT
 
+public:
+    enum CompareMode { Interleaved, Overlaid };
 public:
     SvgView(QWidget *parent = 0);
-    void convert (const QString &xsltFile);
+    void exportPdf(SvgExportPdf *pdf, int rowsPerPage, int daysPerPage);
+    void exportPng(SvgExportPng *png, qreal scale);
+    bool exportSelection(const QString &fileName, QString *error = 0);
     QString getTplHeader(void);
     QString getTplTask  (void);
     QString getTplTime  (void);
-    void loadPlan(vlePlan *plan);
+    void loadPlan(const vlePlanSnapshot &plan);
+    void loadPlans(const QList<vlePlanSnapshot> &plans, CompareMode mode = Interleaved);
     void loadFile(QString fileName);
     bool loadTemplate(QString fileName);
+    bool reloadTemplate(const QString &fileName);
+    bool setTemplate(const QString &name, const QString &xml);
     void refresh (void);
+    SvgTransformChain *transforms(void);
     void reload  (void);
+    const vlePlanDiff &diff(void) const;
+    vlePlanFilter *filter(void);
+    vlePlanOrder  *order (void);
+    void setOrder(vlePlanOrder::Key key);
     QString getConfig(QString c, QString key);
     void    setConfig(QString c, QString key, QString value);
+    void setGapCompression(int minDays);
+    void setGroupSeparator(const QString &separator);
+    const vlePlanAxis &axis(void) const;
+    int  axisOrigin(void) const;
+    int  groupHeight(void) const;
+    int  lineCount(void) const;
+    const QList<vlePlanSnapshot> &plans(void) const;
+    const QVector<SvgViewRow>    &rows (void) const;
+    QVector<int> summaryGroups(const SvgViewRow &r) const;
     void setZommFactor(qreal factor);
+    int  selectionCount(void) const;
+    void clearSelection(void);
+    void setTimeCursor(vlePlanTick tick);
+    void setGroupHighlight(int group, bool enable);
+    QByteArray tileDocument(const QRect &area);
+signals:
+    void planChanged(void);  // A new document has been generated
+    void viewChanged(void);  // The visible area has moved
+    void selectionChanged(void);
 private:
     void updateAttr (QDomNode    &e, QString selector, QString attr, QString value, bool replace = true);
     void updateField(QDomNode    &e, QString tag,  QString value);
     void updatePos  (QDomElement &e, int x, int y);
+    void buildRows(const QList<vlePlanSnapshot> &plans);
+    void layoutDocument(void);
+    void ensureLines(int first, int last);
+    void ensureTime (int first, int last);
+    void generateHeaders(void);
+    void generateTasks  (void);
+    void generateTime   (void);
+    QByteArray generateTime(int column);
+    void appendTimeStep(QDomElement &grp, const QString &name, int width, int x);
+    QByteArray generateHeader(int line);
+    QString    lineLabel(int line) const;
+    QByteArray generateTasks (int line);
+    QByteArray generateSummary(const SvgViewRow &r);
+    void toggleNode(int line);
+    void relayout(int node, int line);
+    void select(const QRectF &area, bool add);
+    void hitTest(const SvgViewRow &r, qint32 x0, qint32 x1, QVector<int> *out) const;
+    static QString csvField(const QString &value);
+    void setSelection(const QHash<qint64, QSet<int> > &selection);
+    static qint64 groupKey(int plan, int group);
+    void addHighlight(int group);
+    void updateOverlay(void);
+    void updateTemplates(bool header, bool task, bool time);
+    static QString serialize(const QDomNode &node);
+    void requestTiles(void);
+private slots:
+    void tileReady  (const QRect &rect, const QImage &image);
+    void tileRemoved(const QRect &rect);
 protected:
+    void mouseDoubleClickEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void scrollContentsBy(int dx, int dy);
     void wheelEvent(QWheelEvent* event);
 private:
     // Widget variables
     QGraphicsItem *mGraphicItem;
-    QSvgRenderer  *mSvgRenderer;
+    SvgTiles      *mTiles;
+    QHash<qint64, QGraphicsPixmapItem *> mTileItems;
+    // Scroll speed (pixels per millisecond) used to prefetch tiles
+    QElapsedTimer  mScrollTimer;
+    qreal          mScrollSpeedX;
+    qreal          mScrollSpeedY;
+    SvgTransformChain mTransforms;  // Applied to each generated part
     // SVG template variables
     QDomDocument   mTplDocument;
     QDomElement    mTplRoot;
     QDomElement    mTplHeader;
     QDomElement    mTplTask;
     QDomElement    mTplTime;
-    //
-    vlePlan       *mPlan;
+    // Snapshots of the plans shown (kept alive while used by the view)
+    QList<vlePlanSnapshot> mPlans;
+    CompareMode    mCompareMode;
+    vlePlanDiff    mDiff;       // Differences, when two plans are compared
+    QDate          mDateStart;  // Start of the time axis
+    QDate          mDateEnd;
+    vlePlanTime    mTime;       // Time model of the plans shown
+    vlePlanAxis    mAxis;       // Position of ticks into the plan
+    int            mGapDays;    // Minimum idle period compressed into a break
+    vlePlanTick    mAxisGap;    // Gap (in ticks) used to build the segments of mAxis
+    int            mPlanWidth;
+    // Parts of the document, each line is generated when it is first rendered
+    enum LinePart { HeaderPart = 0x01, TasksPart = 0x02 };
+    SvgTileDocument     mDocument;
+    QVector<QByteArray> mPartHeaders;  // One per line, with a content mark
+    QVector<QByteArray> mPartTasks;    // Activities of each line
+    QVector<int>        mPartState;    // Parts of each line already generated
     int            mMaxWidth;
     qreal          mPixelPerDay;
     qreal          mZoomFactor;
     qreal          mZoomLevel;
     int            mGroupHeight;
+    vlePlanFilter  mFilter;
+    vlePlanOrder   mOrder;      // Order of the groups of the first plan
+    QVector<SvgViewRow> mRows;  // Groups shown, sorted by line
+    QVector<int>   mLineFirst;  // First row of each line
+    QVector<QString> mLineKeys; // Node and plan shown by each line
+    QHash<qint64, int> mGroupLines; // Line of each group, by plan and group
+    int            mLineCount;
+    vlePlanTree    mTree;       // Hierarchy of the groups
+    quint64        mTreeFilter; // Revision of the filter used by the unions of mTree
+    QString        mGroupSeparator;
+    // Selected activities (positions into the group), by plan and group
+    QHash<qint64, QSet<int> > mSelection;
+    QRubberBand   *mRubberBand;
+    QPoint         mPressPos;
+    // Items drawn over the tiles (moved without rendering tiles again)
+    QGraphicsLineItem *mCursorItem;
+    vlePlanTick    mCursorTick;
+    QSet<int>      mHighlight;  // Highlighted groups of the first plan
+    QHash<int, QGraphicsRectItem *> mHighlightItems;
 
     QList<SvgViewConfig *> mConfig;
 
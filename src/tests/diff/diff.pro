@@ -0,0 +1,8 @@
+TARGET = tst_diff
+
+include(../tests.pri)
+
+SOURCES += tst_diff.cpp \
+    ../../vlePlanDiff.cpp
+
+HEADERS += ../../vlePlanDiff.h
@@ -0,0 +1,164 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtTest>
+#include "vlePlanDiff.h"
+
+class tst_diff : public QObject
+{
+    Q_OBJECT
+private slots:
+    void same(void);
+    void shifted(void);
+    void duplicateInserted(void);
+    void duplicateRemoved(void);
+    void groups(void);
+private:
+    static void add(vlePlan *plan, const QString &group, const QString &name, vlePlanTick start);
+    static int  position(const vlePlan *plan, const QString &group, vlePlanTick start);
+};
+
+void tst_diff::add(vlePlan *plan, const QString &group, const QString &name, vlePlanTick start)
+{
+    plan->addActivity(plan->getGroup(group, true), name, start, start + 1);
+}
+
+// Position of the activity starting at a date (groups are sorted by update)
+int tst_diff::position(const vlePlan *plan, const QString &group, vlePlanTick start)
+{
+    const vlePlanGroup *g = plan->getGroup(plan->groupIndex(group));
+    for (int i = 0; i < g->count(); i++)
+    {
+        if (g->tickStarts()[i] == start)
+            return i;
+    }
+    return -1;
+}
+
+void tst_diff::same(void)
+{
+    vlePlan a;
+    vlePlan b;
+    for (int i = 0; i < 10; i++)
+    {
+        add(&a, "g", QString("a%1").arg(i % 3), i * 10);
+        add(&b, "g", QString("a%1").arg(i % 3), i * 10);
+    }
+    a.update();
+    b.update();
+
+    vlePlanDiff diff;
+    diff.compare(&a, &b);
+    QCOMPARE(diff.count(vlePlanDiff::Same),    10);
+    QCOMPARE(diff.count(vlePlanDiff::Added),   0);
+    QCOMPARE(diff.count(vlePlanDiff::Removed), 0);
+    QCOMPARE(diff.count(vlePlanDiff::Shifted), 0);
+}
+
+void tst_diff::shifted(void)
+{
+    vlePlan a;
+    vlePlan b;
+    add(&a, "g", "task", 1);
+    add(&a, "g", "task", 5);
+    add(&a, "g", "task", 10);
+    add(&b, "g", "task", 1);
+    add(&b, "g", "task", 7);
+    add(&b, "g", "task", 10);
+    a.update();
+    b.update();
+
+    // Only the activity that moved is paired as shifted
+    vlePlanDiff diff;
+    diff.compare(&a, &b);
+    QCOMPARE(diff.count(vlePlanDiff::Same),    2);
+    QCOMPARE(diff.count(vlePlanDiff::Shifted), 1);
+    QCOMPARE(diff.count(vlePlanDiff::Added),   0);
+    QCOMPARE(diff.count(vlePlanDiff::Removed), 0);
+    QCOMPARE(diff.statusA(0, position(&a, "g", 1)),  vlePlanDiff::Same);
+    QCOMPARE(diff.statusA(0, position(&a, "g", 5)),  vlePlanDiff::Shifted);
+    QCOMPARE(diff.statusA(0, position(&a, "g", 10)), vlePlanDiff::Same);
+    QCOMPARE(diff.statusB(0, position(&b, "g", 7)),  vlePlanDiff::Shifted);
+}
+
+void tst_diff::duplicateInserted(void)
+{
+    vlePlan a;
+    vlePlan b;
+    add(&a, "g", "task", 1);
+    add(&a, "g", "task", 5);
+    add(&b, "g", "task", 1);
+    add(&b, "g", "task", 3);
+    add(&b, "g", "task", 5);
+    a.update();
+    b.update();
+
+    // A new occurrence of a repeated name does not shift the following ones
+    vlePlanDiff diff;
+    diff.compare(&a, &b);
+    QCOMPARE(diff.count(vlePlanDiff::Same),    2);
+    QCOMPARE(diff.count(vlePlanDiff::Added),   1);
+    QCOMPARE(diff.count(vlePlanDiff::Shifted), 0);
+    QCOMPARE(diff.count(vlePlanDiff::Removed), 0);
+    QCOMPARE(diff.statusB(0, position(&b, "g", 3)), vlePlanDiff::Added);
+    QCOMPARE(diff.statusB(0, position(&b, "g", 5)), vlePlanDiff::Same);
+}
+
+void tst_diff::duplicateRemoved(void)
+{
+    vlePlan a;
+    vlePlan b;
+    add(&a, "g", "task", 1);
+    add(&a, "g", "task", 3);
+    add(&a, "g", "task", 5);
+    add(&a, "g", "task", 9);
+    add(&b, "g", "task", 1);
+    add(&b, "g", "task", 5);
+    add(&b, "g", "task", 8);
+    a.update();
+    b.update();
+
+    // Exact dates are matched first, then the others are paired in order
+    vlePlanDiff diff;
+    diff.compare(&a, &b);
+    QCOMPARE(diff.count(vlePlanDiff::Same),    2);
+    QCOMPARE(diff.count(vlePlanDiff::Shifted), 1);
+    QCOMPARE(diff.count(vlePlanDiff::Removed), 1);
+    QCOMPARE(diff.count(vlePlanDiff::Added),   0);
+    QCOMPARE(diff.statusA(0, position(&a, "g", 3)), vlePlanDiff::Shifted);
+    QCOMPARE(diff.statusA(0, position(&a, "g", 9)), vlePlanDiff::Removed);
+    QCOMPARE(diff.statusB(0, position(&b, "g", 8)), vlePlanDiff::Shifted);
+}
+
+void tst_diff::groups(void)
+{
+    vlePlan a;
+    vlePlan b;
+    add(&a, "both",  "x", 1);
+    add(&a, "onlyA", "y", 2);
+    add(&a, "onlyA", "z", 3);
+    add(&b, "onlyB", "w", 4);
+    add(&b, "both",  "x", 1);
+    add(&b, "both",  "v", 6);
+    a.update();
+    b.update();
+
+    // Groups are matched by name, whatever their position
+    vlePlanDiff diff;
+    diff.compare(&a, &b);
+    QVERIFY( ! diff.isEmpty());
+    QCOMPARE(diff.count(vlePlanDiff::Same),    1);
+    QCOMPARE(diff.count(vlePlanDiff::Removed), 2);
+    QCOMPARE(diff.count(vlePlanDiff::Added),   2);
+    QCOMPARE(diff.count(vlePlanDiff::Shifted), 0);
+    QCOMPARE(diff.statusA(a.groupIndex("onlyA"), 0), vlePlanDiff::Removed);
+    QCOMPARE(diff.statusB(b.groupIndex("onlyB"), 0), vlePlanDiff::Added);
+    QCOMPARE(diff.statusB(b.groupIndex("both"), position(&b, "both", 6)), vlePlanDiff::Added);
+}
+
+QTEST_MAIN(tst_diff)
+#include "tst_diff.moc"
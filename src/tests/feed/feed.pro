@@ -0,0 +1,10 @@
+TARGET = tst_feed
+
+include(../tests.pri)
+
+QT      += network
+
+SOURCES += tst_feed.cpp \
+    ../../vlePlanFeed.cpp
+
+HEADERS += ../../vlePlanFeed.h
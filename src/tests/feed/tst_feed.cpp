@@ -0,0 +1,192 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtTest>
+#include <QLocalSocket>
+#include "vlePlanFeed.h"
+
+class tst_feed : public QObject
+{
+    Q_OBJECT
+private slots:
+    void encodeReset(void);
+    void encodeActivity(void);
+    void receive(void);
+    void partialFrames(void);
+    void oversizedFrame(void);
+private:
+    static QString serverName(void);
+    static quint32 frameLength(const QByteArray &data);
+    static int activityCount(const vlePlanFeed &feed);
+};
+
+QString tst_feed::serverName(void)
+{
+    return QString("vle-feed-test-%1").arg(QCoreApplication::applicationPid());
+}
+
+quint32 tst_feed::frameLength(const QByteArray &data)
+{
+    return ((quint32)(uchar)data.at(0) << 24) |
+           ((quint32)(uchar)data.at(1) << 16) |
+           ((quint32)(uchar)data.at(2) <<  8) |
+            (quint32)(uchar)data.at(3);
+}
+
+int tst_feed::activityCount(const vlePlanFeed &feed)
+{
+    vlePlanSnapshot snapshot = feed.snapshot();
+    return snapshot ? snapshot->countActivities() : -1;
+}
+
+void tst_feed::encodeReset(void)
+{
+    QByteArray data = vlePlanFeed::encodeReset();
+    QCOMPARE(data, QByteArray("\x00\x00\x00\x01\x02", 5));
+}
+
+void tst_feed::encodeActivity(void)
+{
+    vlePlan plan;
+    plan.setResolution(vlePlanTime::Hour);
+    vlePlanGroup *g = plan.getGroup("group", true);
+    vlePlanActivity *a = plan.addActivity(g, "task", 48, 50);
+    a->setClass("cls");
+    a->addAttribute("x");
+    a->addAttribute("y");
+    plan.update();
+
+    // Big endian length of the payload, then the payload
+    QByteArray data = vlePlanFeed::encodeActivity(g, 0, plan.time());
+    QVERIFY(data.size() > 4);
+    QCOMPARE((int)frameLength(data), data.size() - 4);
+
+    QDataStream in(data.mid(4));
+    in.setVersion(QDataStream::Qt_5_0);
+    quint8  type;
+    QString name, group, className;
+    qint64  start, end;
+    QStringList attributes;
+    in >> type >> name >> group >> className >> start >> end >> attributes;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QVERIFY(in.atEnd());
+    QCOMPARE((int)type, (int)vlePlanFeed::FrameActivity);
+    QCOMPARE(name, QString("task"));
+    QCOMPARE(group, QString("group"));
+    QCOMPARE(className, QString("cls"));
+    // Dates are sent as minutes, whatever the resolution of the plan
+    QCOMPARE(start, (qint64)(48 * 60));
+    QCOMPARE(end,   (qint64)(50 * 60));
+    QCOMPARE(attributes, QStringList() << "x" << "y");
+}
+
+void tst_feed::receive(void)
+{
+    vlePlan source;
+    vlePlanGroup *g1 = source.getGroup("g1", true);
+    vlePlanGroup *g2 = source.getGroup("g2", true);
+    for (int i = 0; i < 100; i++)
+        source.addActivity((i % 3) ? g1 : g2, QString("a%1").arg(i), i, i + 2);
+    source.update();
+
+    vlePlan plan;
+    vlePlanFeed feed(&plan);
+    feed.setMaxRate(50);
+    QVERIFY(feed.listen(serverName()));
+    QSignalSpy updated(&feed, SIGNAL(planUpdated()));
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    QVERIFY(socket.waitForConnected(5000));
+
+    // A reset, then all the activities of the source plan
+    socket.write(vlePlanFeed::encodeReset());
+    for (int i = 0; i < source.countGroups(); i++)
+    {
+        vlePlanGroup *g = source.getGroup(i);
+        for (int j = 0; j < g->count(); j++)
+            socket.write(vlePlanFeed::encodeActivity(g, j, source.time()));
+    }
+    socket.flush();
+
+    QTRY_COMPARE(activityCount(feed), 100);
+    QVERIFY(updated.count() > 0);
+    vlePlanSnapshot snapshot = feed.snapshot();
+    QCOMPARE(snapshot->countGroups(), 2);
+    QCOMPARE(snapshot->getGroup(snapshot->groupIndex("g1"))->count(), g1->count());
+    QCOMPARE(snapshot->getGroup(snapshot->groupIndex("g2"))->count(), g2->count());
+
+    // A new reset replaces the content of the plan
+    socket.write(vlePlanFeed::encodeReset());
+    socket.write(vlePlanFeed::encodeActivity(g2, 0, source.time()));
+    socket.flush();
+    QTRY_COMPARE(activityCount(feed), 1);
+
+    socket.disconnectFromServer();
+    feed.close();
+}
+
+void tst_feed::partialFrames(void)
+{
+    vlePlan source;
+    vlePlanGroup *g = source.getGroup("g", true);
+    source.addActivity(g, "first",  10, 20);
+    source.addActivity(g, "second", 30, 40);
+    source.update();
+
+    vlePlan plan;
+    vlePlanFeed feed(&plan);
+    feed.setMaxRate(50);
+    QVERIFY(feed.listen(serverName()));
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    QVERIFY(socket.waitForConnected(5000));
+
+    // Frames cut anywhere (even into the length) are read once complete
+    QByteArray data = vlePlanFeed::encodeActivity(g, 0, source.time()) +
+                      vlePlanFeed::encodeActivity(g, 1, source.time());
+    for (int i = 0; i < data.size(); i += 3)
+    {
+        socket.write(data.mid(i, 3));
+        socket.flush();
+        QTest::qWait(1);
+    }
+
+    QTRY_COMPARE(activityCount(feed), 2);
+    vlePlanGroup *received = feed.snapshot()->getGroup(0);
+    QCOMPARE(received->getActivity(0)->getName(), QString("first"));
+    QCOMPARE(received->getActivity(1)->getName(), QString("second"));
+
+    socket.disconnectFromServer();
+    feed.close();
+}
+
+void tst_feed::oversizedFrame(void)
+{
+    vlePlan plan;
+    vlePlanFeed feed(&plan);
+    feed.setMaxRate(50);
+    QVERIFY(feed.listen(serverName()));
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    QVERIFY(socket.waitForConnected(5000));
+
+    // A frame that could never fit into the read buffer : the producer
+    // is disconnected instead of waiting forever
+    QByteArray head("\x00\x04\x00\x00", 4);
+    socket.write(head);
+    socket.write(QByteArray(1024, 'x'));
+    socket.flush();
+
+    QTRY_COMPARE(socket.state(), QLocalSocket::UnconnectedState);
+    QVERIFY(activityCount(feed) <= 0);
+}
+
+QTEST_MAIN(tst_feed)
+#include "tst_feed.moc"
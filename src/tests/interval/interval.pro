@@ -0,0 +1,5 @@
+TARGET = tst_interval
+
+include(../tests.pri)
+
+SOURCES += tst_interval.cpp
@@ -0,0 +1,162 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtTest>
+#include "vlePlan.h"
+#include "vlePlanFixture.h"
+
+class tst_interval : public QObject
+{
+    Q_OBJECT
+private slots:
+    void empty(void);
+    void bounds(void);
+    void random_data(void);
+    void random(void);
+    void appended(void);
+    void query(void);
+private:
+    static void fill(vlePlan *plan, vlePlanGroup *group, int count, quint32 seed);
+};
+
+// Mostly short activities over 1000 ticks, and a few long ones
+void tst_interval::fill(vlePlan *plan, vlePlanGroup *group, int count, quint32 seed)
+{
+    vlePlanFixture(seed).fill(plan, group, count, 1000, 10, 500);
+}
+
+void tst_interval::empty(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g = plan.getGroup("empty", true);
+    plan.update();
+
+    QVector<int> hits;
+    g->overlaps(0, 1000, &hits);
+    QVERIFY(hits.isEmpty());
+}
+
+void tst_interval::bounds(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g = plan.getGroup("g", true);
+    plan.addActivity(g, "a", 10, 20);
+    plan.addActivity(g, "b", 30, 30);
+    plan.update();
+
+    // Both ends of the window and of the activities are included
+    QVector<int> hits;
+    g->overlaps(20, 30, &hits);
+    QCOMPARE(hits, QVector<int>() << 0 << 1);
+
+    hits.clear();
+    g->overlaps(21, 29, &hits);
+    QVERIFY(hits.isEmpty());
+
+    hits.clear();
+    g->overlaps(30, 30, &hits);
+    QCOMPARE(hits, QVector<int>() << 1);
+
+    hits.clear();
+    g->overlaps(0, 9, &hits);
+    QVERIFY(hits.isEmpty());
+}
+
+void tst_interval::random_data(void)
+{
+    QTest::addColumn<int>("count");
+    // Sizes around the leaves and levels of the tree
+    QTest::newRow("1")    << 1;
+    QTest::newRow("7")    << 7;
+    QTest::newRow("8")    << 8;
+    QTest::newRow("9")    << 9;
+    QTest::newRow("31")   << 31;
+    QTest::newRow("100")  << 100;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("4097") << 4097;
+}
+
+void tst_interval::random(void)
+{
+    QFETCH(int, count);
+
+    vlePlan plan;
+    vlePlanGroup *g = plan.getGroup("g", true);
+    fill(&plan, g, count, count);
+    plan.update();
+    QVERIFY(g->isSorted());
+
+    vlePlanFixture windows(42);
+    for (int k = 0; k < 200; k++)
+    {
+        vlePlanTick start = (vlePlanTick)windows.next(1200) - 100;
+        vlePlanTick end   = start + windows.next(100);
+        QVector<int> hits;
+        g->overlaps(start, end, &hits);
+        // Same positions, in increasing order
+        QCOMPARE(hits, vlePlanFixture::overlapping(g, start, end));
+    }
+}
+
+void tst_interval::appended(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g = plan.getGroup("g", true);
+    fill(&plan, g, 300, 1);
+    plan.update();
+    quint64 revision = g->revision();
+
+    // Activities added after an update : the index is built again
+    fill(&plan, g, 50, 2);
+    QVERIFY( ! g->isSorted());
+    plan.update();
+    QVERIFY(g->isSorted());
+    QVERIFY(g->revision() != revision);
+    QCOMPARE(g->count(), 350);
+
+    for (vlePlanTick t = -10; t < 1510; t += 15)
+    {
+        QVector<int> hits;
+        g->overlaps(t, t + 5, &hits);
+        QCOMPARE(hits, vlePlanFixture::overlapping(g, t, t + 5));
+    }
+}
+
+void tst_interval::query(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g1 = plan.getGroup("g1", true);
+    vlePlanGroup *g2 = plan.getGroup("g2", true);
+    fill(&plan, g1, 200, 3);
+    fill(&plan, g2, 500, 4);
+    plan.update();
+
+    // A range holds the hits of each group, in plan order
+    vlePlanRange range = plan.query(100, 200);
+    QVector<int> hits1 = vlePlanFixture::overlapping(g1, 100, 200);
+    QVector<int> hits2 = vlePlanFixture::overlapping(g2, 100, 200);
+    QCOMPARE(range.count(), hits1.count() + hits2.count());
+
+    int n = 0;
+    for (vlePlanRange::const_iterator it = range.begin(); it != range.end(); ++it, n++)
+    {
+        if (n < hits1.count())
+        {
+            QCOMPARE(it.groupIndex(), 0);
+            QCOMPARE(it.index(), hits1.at(n));
+        }
+        else
+        {
+            QCOMPARE(it.groupIndex(), 1);
+            QCOMPARE(it.index(), hits2.at(n - hits1.count()));
+        }
+    }
+    QCOMPARE(n, range.count());
+}
+
+QTEST_MAIN(tst_interval)
+#include "tst_interval.moc"
@@ -0,0 +1,5 @@
+TARGET = tst_stream
+
+include(../tests.pri)
+
+SOURCES += tst_stream.cpp
@@ -0,0 +1,262 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtTest>
+#include <QTemporaryDir>
+#include <zlib.h>
+#ifdef VLE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "vlePlan.h"
+#include "vlePlanStream.h"
+
+class tst_stream : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase(void);
+    void detect(void);
+    void gzip(void);
+    void gzipMembers(void);
+    void gzipExactBlocks(void);
+    void gzipTruncated(void);
+    void gzipCorrupted(void);
+    void zstd(void);
+    void zstdTruncated(void);
+    void loadFile(void);
+    void loadFileTruncated(void);
+private:
+    QString write(const QString &name, const QByteArray &data);
+    static QByteArray compressGzip(const QByteArray &data);
+    static QByteArray compressZstd(const QByteArray &data);
+    static QByteArray readStream(const QString &fileName, QString *error);
+private:
+    QTemporaryDir mDir;
+    QByteArray    mPlain;
+};
+
+void tst_stream::initTestCase(void)
+{
+    QVERIFY(mDir.isValid());
+
+    // A plan larger than the queue of decoded blocks, so the producer
+    // thread has to wait for the reader
+    mPlain = "name;group;class;start;end\n";
+    for (int i = 0; i < 120000; i++)
+    {
+        mPlain += QString("act%1;group%2;cls%3;2016-01-%4;2016-02-%4\n")
+                  .arg(i).arg(i % 37).arg(i % 5).arg(1 + (i % 28), 2, 10, QChar('0'))
+                  .toUtf8();
+    }
+    QVERIFY(mPlain.size() > (5 * 1024 * 1024));
+}
+
+QString tst_stream::write(const QString &name, const QByteArray &data)
+{
+    QString fileName = mDir.filePath(name);
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::WriteOnly))
+        return QString();
+    file.write(data);
+    file.close();
+    return fileName;
+}
+
+QByteArray tst_stream::compressGzip(const QByteArray &data)
+{
+    QByteArray out(compressBound(data.size()) + 64, 0);
+    z_stream z;
+
+    memset(&z, 0, sizeof(z));
+    // Window bits + 16 : gzip header
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return QByteArray();
+    z.next_in   = (Bytef *)data.constData();
+    z.avail_in  = data.size();
+    z.next_out  = (Bytef *)out.data();
+    z.avail_out = out.size();
+    int ret = deflate(&z, Z_FINISH);
+    out.resize(out.size() - z.avail_out);
+    deflateEnd(&z);
+    return (ret == Z_STREAM_END) ? out : QByteArray();
+}
+
+QByteArray tst_stream::compressZstd(const QByteArray &data)
+{
+#ifdef VLE_HAVE_ZSTD
+    QByteArray out(ZSTD_compressBound(data.size()), 0);
+    size_t len = ZSTD_compress(out.data(), out.size(), data.constData(), data.size(), 3);
+    if (ZSTD_isError(len))
+        return QByteArray();
+    out.resize(len);
+    return out;
+#else
+    (void)data;
+    return QByteArray();
+#endif
+}
+
+QByteArray tst_stream::readStream(const QString &fileName, QString *error)
+{
+    vlePlanStream stream(fileName);
+    if ( ! stream.open(QIODevice::ReadOnly))
+    {
+        *error = stream.errorString();
+        return QByteArray();
+    }
+
+    // Read by small blocks, as the CSV parser does
+    QByteArray data;
+    char buffer[4096];
+    qint64 len;
+    while ((len = stream.read(buffer, sizeof(buffer))) > 0)
+        data.append(buffer, len);
+    *error = stream.decodeError();
+    stream.close();
+    return data;
+}
+
+void tst_stream::detect(void)
+{
+    QString plain = write("detect.csv", mPlain.left(1000));
+    QString gz    = write("detect.csv.gz", compressGzip(mPlain.left(1000)));
+    QString zst   = write("detect.csv.zst", QByteArray("\x28\xb5\x2f\xfd\x00", 5));
+
+    // The format is found from the content, not from the file name
+    QCOMPARE(vlePlanStream::detect(plain), vlePlanStream::Plain);
+    QCOMPARE(vlePlanStream::detect(gz),    vlePlanStream::Gzip);
+    QCOMPARE(vlePlanStream::detect(zst),   vlePlanStream::Zstd);
+    QCOMPARE(vlePlanStream::detect(mDir.filePath("missing")), vlePlanStream::Plain);
+}
+
+void tst_stream::gzip(void)
+{
+    QByteArray gz = compressGzip(mPlain);
+    QVERIFY( ! gz.isEmpty());
+    QString fileName = write("plan.csv.gz", gz);
+
+    QString error;
+    QByteArray data = readStream(fileName, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(data.size(), mPlain.size());
+    QVERIFY(data == mPlain);
+}
+
+void tst_stream::gzipMembers(void)
+{
+    // Concatenated gzip files are decoded as one stream
+    int half = mPlain.size() / 2;
+    QByteArray gz = compressGzip(mPlain.left(half)) + compressGzip(mPlain.mid(half));
+    QString fileName = write("members.csv.gz", gz);
+
+    QString error;
+    QByteArray data = readStream(fileName, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QVERIFY(data == mPlain);
+}
+
+void tst_stream::gzipExactBlocks(void)
+{
+    // The last call of inflate fills the decoded block exactly (blocks are
+    // 256 KB) : the member is still complete
+    QByteArray plain = mPlain.left(2 * 256 * 1024);
+    QString fileName = write("exact.csv.gz", compressGzip(plain) + compressGzip(plain));
+
+    QString error;
+    QByteArray data = readStream(fileName, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QVERIFY(data == (plain + plain));
+}
+
+void tst_stream::gzipTruncated(void)
+{
+    QByteArray gz = compressGzip(mPlain);
+    QString fileName = write("truncated.csv.gz", gz.left(gz.size() / 2));
+
+    // Data decoded before the end of the file is kept, and the error is reported
+    QString error;
+    QByteArray data = readStream(fileName, &error);
+    QVERIFY( ! error.isEmpty());
+    QVERIFY(data.size() > 0);
+    QVERIFY(data.size() < mPlain.size());
+    QVERIFY(mPlain.startsWith(data));
+}
+
+void tst_stream::gzipCorrupted(void)
+{
+    QByteArray gz = compressGzip(mPlain);
+    // Damage the deflate data, after the gzip header
+    for (int i = 0; i < 64; i++)
+        gz[1000 + i] = (char)(gz.at(1000 + i) ^ 0x5A);
+    QString fileName = write("corrupted.csv.gz", gz);
+
+    QString error;
+    readStream(fileName, &error);
+    QVERIFY( ! error.isEmpty());
+}
+
+void tst_stream::zstd(void)
+{
+#ifndef VLE_HAVE_ZSTD
+    QSKIP("Built without zstd support");
+#endif
+    QByteArray zst = compressZstd(mPlain);
+    QVERIFY( ! zst.isEmpty());
+    QString fileName = write("plan.csv.zst", zst);
+
+    QString error;
+    QByteArray data = readStream(fileName, &error);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(data.size(), mPlain.size());
+    QVERIFY(data == mPlain);
+}
+
+void tst_stream::zstdTruncated(void)
+{
+#ifndef VLE_HAVE_ZSTD
+    QSKIP("Built without zstd support");
+#endif
+    QByteArray zst = compressZstd(mPlain);
+    QString fileName = write("truncated.csv.zst", zst.left(zst.size() / 2));
+
+    QString error;
+    QByteArray data = readStream(fileName, &error);
+    QVERIFY( ! error.isEmpty());
+    QVERIFY(data.size() < mPlain.size());
+    QVERIFY(mPlain.startsWith(data));
+}
+
+void tst_stream::loadFile(void)
+{
+    QString fileName = write("load.csv.gz", compressGzip(mPlain));
+
+    vlePlan plan;
+    QString error;
+    QVERIFY2(plan.loadFile(fileName, &error), qPrintable(error));
+    plan.update();
+    QCOMPARE(plan.countGroups(), 37);
+    QCOMPARE(plan.countActivities(), 120000);
+}
+
+void tst_stream::loadFileTruncated(void)
+{
+    QByteArray gz = compressGzip(mPlain);
+    QString fileName = write("load-truncated.csv.gz", gz.left(gz.size() / 2));
+
+    // The loader fails with the decode error, rows before it are kept
+    vlePlan plan;
+    QString error;
+    QVERIFY( ! plan.loadFile(fileName, &error));
+    QVERIFY( ! error.isEmpty());
+    plan.update();
+    QVERIFY(plan.countActivities() > 0);
+    QVERIFY(plan.countActivities() < 120000);
+}
+
+QTEST_MAIN(tst_stream)
+#include "tst_stream.moc"
@@ -0,0 +1,8 @@
+TARGET = tst_sweep
+
+include(../tests.pri)
+
+SOURCES += tst_sweep.cpp \
+    ../../vlePlanSweep.cpp
+
+HEADERS += ../../vlePlanSweep.h
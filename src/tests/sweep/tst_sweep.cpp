@@ -0,0 +1,210 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtTest>
+#include "vlePlanFixture.h"
+#include "vlePlanSweep.h"
+
+class tst_sweep : public QObject
+{
+    Q_OBJECT
+private slots:
+    void empty(void);
+    void bounds(void);
+    void moveTo(void);
+    void changedGroups(void);
+    void update(void);
+    void updateAddedGroup(void);
+private:
+    static void fill(vlePlan *plan, vlePlanGroup *group, int count, quint32 seed);
+    static void check(const vlePlanSweep &sweep, const vlePlan &plan, vlePlanTick tick);
+};
+
+// Activities of up to 40 ticks over 500 ticks : many of them overlap
+void tst_sweep::fill(vlePlan *plan, vlePlanGroup *group, int count, quint32 seed)
+{
+    vlePlanFixture(seed).fill(plan, group, count, 500, 40);
+}
+
+// Running activities of each group are the ones overlapping the cursor date
+void tst_sweep::check(const vlePlanSweep &sweep, const vlePlan &plan, vlePlanTick tick)
+{
+    int total = 0;
+    for (int i = 0; i < plan.countGroups(); i++)
+    {
+        QVector<int> running = vlePlanFixture::overlapping(plan.getGroup(i), tick, tick);
+        QSet<int> expected;
+        for (int j = 0; j < running.count(); j++)
+            expected.insert(running.at(j));
+        QCOMPARE(sweep.active(i), expected);
+        total += expected.count();
+    }
+    QCOMPARE(sweep.activeCount(), total);
+    QCOMPARE(sweep.cursor(), tick);
+}
+
+void tst_sweep::empty(void)
+{
+    vlePlanSweep sweep;
+    QCOMPARE(sweep.activeCount(), 0);
+    QVERIFY(sweep.active(0).isEmpty());
+
+    vlePlan plan;
+    plan.getGroup("g", true);
+    plan.update();
+    sweep.build(&plan);
+    QCOMPARE(sweep.moveTo(100), 0);
+    QCOMPARE(sweep.activeCount(), 0);
+}
+
+void tst_sweep::bounds(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g = plan.getGroup("g", true);
+    plan.addActivity(g, "a", 10, 20);
+    plan.addActivity(g, "b", 20, 20);
+    plan.update();
+
+    vlePlanSweep sweep;
+    sweep.build(&plan);
+    sweep.moveTo(9);
+    QCOMPARE(sweep.activeCount(), 0);
+    sweep.moveTo(10);
+    QCOMPARE(sweep.active(0), QSet<int>() << 0);
+    // An activity is still running at its end date
+    sweep.moveTo(20);
+    QCOMPARE(sweep.active(0), QSet<int>() << 0 << 1);
+    sweep.moveTo(21);
+    QCOMPARE(sweep.activeCount(), 0);
+    // Moving back applies the same events in reverse
+    sweep.moveTo(15);
+    QCOMPARE(sweep.active(0), QSet<int>() << 0);
+}
+
+void tst_sweep::moveTo(void)
+{
+    vlePlan plan;
+    fill(&plan, plan.getGroup("g1", true), 300, 1);
+    fill(&plan, plan.getGroup("g2", true), 50,  2);
+    fill(&plan, plan.getGroup("g3", true), 1000, 3);
+    plan.update();
+
+    vlePlanSweep sweep;
+    sweep.build(&plan);
+
+    // Forward steps, then random jumps in both directions
+    for (vlePlanTick t = -5; t < 560; t += 7)
+    {
+        sweep.moveTo(t);
+        check(sweep, plan, t);
+    }
+    vlePlanFixture jumps(7);
+    for (int k = 0; k < 100; k++)
+    {
+        vlePlanTick t = (vlePlanTick)jumps.next(600) - 50;
+        sweep.moveTo(t);
+        check(sweep, plan, t);
+    }
+}
+
+void tst_sweep::changedGroups(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g1 = plan.getGroup("g1", true);
+    vlePlanGroup *g2 = plan.getGroup("g2", true);
+    plan.addActivity(g1, "a", 10, 20);
+    plan.addActivity(g2, "b", 30, 40);
+    plan.update();
+
+    vlePlanSweep sweep;
+    sweep.build(&plan);
+
+    // Only the groups with an event between both dates are reported
+    QSet<int> changed;
+    QCOMPARE(sweep.moveTo(15, &changed), 1);
+    QCOMPARE(changed, QSet<int>() << 0);
+
+    changed.clear();
+    QCOMPARE(sweep.moveTo(18, &changed), 0);
+    QVERIFY(changed.isEmpty());
+
+    changed.clear();
+    QCOMPARE(sweep.moveTo(35, &changed), 2);
+    QCOMPARE(changed, QSet<int>() << 0 << 1);
+
+    changed.clear();
+    QCOMPARE(sweep.moveTo(5, &changed), 3);
+    QCOMPARE(changed, QSet<int>() << 0 << 1);
+}
+
+void tst_sweep::update(void)
+{
+    vlePlan plan;
+    vlePlanGroup *g1 = plan.getGroup("g1", true);
+    vlePlanGroup *g2 = plan.getGroup("g2", true);
+    vlePlanGroup *g3 = plan.getGroup("g3", true);
+    fill(&plan, g1, 200, 1);
+    fill(&plan, g2, 200, 2);
+    fill(&plan, g3, 200, 3);
+    plan.update();
+
+    vlePlanSweep sweep;
+    sweep.build(&plan);
+    sweep.moveTo(250);
+    check(sweep, plan, 250);
+
+    // New activities into one group : only this group is reported, and
+    // the cursor stays at the same date
+    fill(&plan, g2, 100, 4);
+    plan.update();
+    QSet<int> changed;
+    sweep.update(&plan, &changed);
+    QCOMPARE(changed, QSet<int>() << 1);
+    check(sweep, plan, 250);
+
+    // The merged events are still sorted
+    for (vlePlanTick t = 250; t >= -5; t -= 9)
+    {
+        sweep.moveTo(t);
+        check(sweep, plan, t);
+    }
+    for (vlePlanTick t = -5; t < 560; t += 11)
+    {
+        sweep.moveTo(t);
+        check(sweep, plan, t);
+    }
+
+    // Nothing modified : nothing reported
+    changed.clear();
+    sweep.update(&plan, &changed);
+    QVERIFY(changed.isEmpty());
+}
+
+void tst_sweep::updateAddedGroup(void)
+{
+    vlePlan plan;
+    fill(&plan, plan.getGroup("g1", true), 100, 1);
+    plan.update();
+
+    vlePlanSweep sweep;
+    sweep.build(&plan);
+    sweep.moveTo(100);
+
+    vlePlanGroup *g2 = plan.getGroup("g2", true);
+    fill(&plan, g2, 100, 2);
+    plan.update();
+    QSet<int> changed;
+    sweep.update(&plan, &changed);
+    QCOMPARE(changed, QSet<int>() << 1);
+    check(sweep, plan, 100);
+
+    sweep.moveTo(300);
+    check(sweep, plan, 300);
+}
+
+QTEST_MAIN(tst_sweep)
+#include "tst_sweep.moc"
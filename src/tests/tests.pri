@@ -0,0 +1,38 @@
+# Common settings of the unit tests : the plan model is built with each
+# test (it does not depend on the views)
+
+QT       += core testlib
+
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/.. \
+    $$PWD
+
+SOURCES += $$PWD/../vlePlan.cpp \
+    $$PWD/../vlePlanNames.cpp \
+    $$PWD/../vlePlanSchema.cpp \
+    $$PWD/../vlePlanStats.cpp \
+    $$PWD/../vlePlanStream.cpp \
+    $$PWD/../vlePlanTime.cpp
+
+HEADERS += $$PWD/vlePlanFixture.h \
+    $$PWD/../vlePlan.h \
+    $$PWD/../vlePlanNames.h \
+    $$PWD/../vlePlanPool.h \
+    $$PWD/../vlePlanSchema.h \
+    $$PWD/../vlePlanStats.h \
+    $$PWD/../vlePlanStream.h \
+    $$PWD/../vlePlanTime.h
+
+# zlib is used to read gzip plans
+LIBS     += -lz
+
+# Optional zstd support for compressed plans
+packagesExist(libzstd) {
+    DEFINES   += VLE_HAVE_ZSTD
+    CONFIG    += link_pkgconfig
+    PKGCONFIG += libzstd
+}
@@ -0,0 +1,14 @@
+#-------------------------------
+#
+# Unit tests of the plan model
+#
+#-------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += interval \
+    stream \
+    feed \
+    diff \
+    time \
+    sweep
@@ -0,0 +1,5 @@
+TARGET = tst_time
+
+include(../tests.pri)
+
+SOURCES += tst_time.cpp
@@ -0,0 +1,134 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtTest>
+#include "vlePlanTime.h"
+
+Q_DECLARE_METATYPE(vlePlanTime::Resolution)
+
+class tst_time : public QObject
+{
+    Q_OBJECT
+private slots:
+    void parse_data(void);
+    void parse(void);
+    void parseInvalid_data(void);
+    void parseInvalid(void);
+    void minutes(void);
+    void dates(void);
+    void resolution(void);
+};
+
+void tst_time::parse_data(void)
+{
+    QTest::addColumn<vlePlanTime::Resolution>("resolution");
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<qint64>("day");
+    QTest::addColumn<int>("minutes");  // Into the day
+
+    qint64 jd = QDate(2016, 3, 1).toJulianDay();
+    // Fast path : fixed ISO layouts
+    QTest::newRow("day")           << vlePlanTime::Day    << QByteArray("2016-03-01")          << jd << 0;
+    QTest::newRow("day, time")     << vlePlanTime::Day    << QByteArray("2016-03-01T23:59")    << jd << 0;
+    QTest::newRow("hour")          << vlePlanTime::Hour   << QByteArray("2016-03-01T05:30")    << jd << 330;
+    QTest::newRow("hour, space")   << vlePlanTime::Hour   << QByteArray("2016-03-01 23:00")    << jd << 1380;
+    QTest::newRow("minute")        << vlePlanTime::Minute << QByteArray("2016-03-01T05:30")    << jd << 330;
+    QTest::newRow("minute, secs")  << vlePlanTime::Minute << QByteArray("2016-03-01 05:30:59") << jd << 330;
+    QTest::newRow("minute, date")  << vlePlanTime::Minute << QByteArray("2016-03-01")          << jd << 0;
+    QTest::newRow("leap day")      << vlePlanTime::Day    << QByteArray("2016-02-29")          << (jd - 1) << 0;
+    // Other layouts are handled by Qt
+    QTest::newRow("spaces")        << vlePlanTime::Day    << QByteArray(" 2016-03-01 ")        << jd << 0;
+    QTest::newRow("milliseconds")  << vlePlanTime::Minute << QByteArray("2016-03-01T05:30:00.500") << jd << 330;
+}
+
+void tst_time::parse(void)
+{
+    QFETCH(vlePlanTime::Resolution, resolution);
+    QFETCH(QByteArray, text);
+    QFETCH(qint64, day);
+    QFETCH(int, minutes);
+
+    vlePlanTime time(resolution);
+    vlePlanTick tick = time.parse(text.constData(), text.size());
+    QCOMPARE(tick, (day * time.ticksPerDay()) + (minutes / (1440 / time.ticksPerDay())));
+    QCOMPARE(time.toJulianDay(tick), day);
+}
+
+void tst_time::parseInvalid_data(void)
+{
+    QTest::addColumn<QByteArray>("text");
+
+    QTest::newRow("empty")     << QByteArray("");
+    QTest::newRow("text")      << QByteArray("yesterday");
+    QTest::newRow("month")     << QByteArray("2016-13-01");
+    QTest::newRow("day")       << QByteArray("2015-02-29");
+    QTest::newRow("digits")    << QByteArray("2016-0a-01");
+    QTest::newRow("short")     << QByteArray("2016-3-1");
+}
+
+void tst_time::parseInvalid(void)
+{
+    QFETCH(QByteArray, text);
+
+    vlePlanTime time(vlePlanTime::Minute);
+    QCOMPARE(time.parse(text.constData(), text.size()), vlePlanTime::invalid);
+}
+
+void tst_time::minutes(void)
+{
+    // Minutes are rounded toward the start of the tick, also before day 0
+    vlePlanTime day(vlePlanTime::Day);
+    QCOMPARE(day.fromMinutes(0),     (vlePlanTick)0);
+    QCOMPARE(day.fromMinutes(1439),  (vlePlanTick)0);
+    QCOMPARE(day.fromMinutes(1440),  (vlePlanTick)1);
+    QCOMPARE(day.fromMinutes(-1),    (vlePlanTick)-1);
+    QCOMPARE(day.toMinutes(3),       (qint64)(3 * 1440));
+
+    vlePlanTime hour(vlePlanTime::Hour);
+    QCOMPARE(hour.fromMinutes(119),  (vlePlanTick)1);
+    QCOMPARE(hour.fromMinutes(-61),  (vlePlanTick)-2);
+    QCOMPARE(hour.toMinutes(-2),     (qint64)-120);
+    QCOMPARE(hour.toJulianDay(-1),   (qint64)-1);
+
+    vlePlanTime minute(vlePlanTime::Minute);
+    QCOMPARE(minute.fromMinutes(12345), (vlePlanTick)12345);
+    QCOMPARE(minute.toMinutes(12345),   (qint64)12345);
+}
+
+void tst_time::dates(void)
+{
+    vlePlanTime time(vlePlanTime::Minute);
+    QDateTime dt(QDate(2016, 3, 1), QTime(5, 30, 42));
+
+    // Seconds are truncated to the resolution
+    vlePlanTick tick = time.fromDateTime(dt);
+    QCOMPARE(time.toDateTime(tick), QDateTime(QDate(2016, 3, 1), QTime(5, 30)));
+    QCOMPARE(time.toDate(tick), QDate(2016, 3, 1));
+    QCOMPARE(time.fromDate(QDate(2016, 3, 1)), tick - 330);
+
+    QCOMPARE(time.fromDate(QDate()), vlePlanTime::invalid);
+    QCOMPARE(time.fromDateTime(QDateTime()), vlePlanTime::invalid);
+    QVERIFY( ! time.toDate(vlePlanTime::invalid).isValid());
+    QVERIFY( ! time.toDateTime(vlePlanTime::invalid).isValid());
+}
+
+void tst_time::resolution(void)
+{
+    vlePlanTime::Resolution r = vlePlanTime::Day;
+    QVERIFY(vlePlanTime::parseResolution(" Hour ", &r));
+    QCOMPARE(r, vlePlanTime::Hour);
+    QVERIFY(vlePlanTime::parseResolution("minute", &r));
+    QCOMPARE(r, vlePlanTime::Minute);
+    QVERIFY(vlePlanTime::parseResolution("DAY", &r));
+    QCOMPARE(r, vlePlanTime::Day);
+    // An unknown name does not change the resolution
+    QVERIFY( ! vlePlanTime::parseResolution("second", &r));
+    QCOMPARE(r, vlePlanTime::Day);
+}
+
+QTEST_MAIN(tst_time)
+#include "tst_time.moc"
@@ -0,0 +1,61 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANFIXTURE_H
+#define VLEPLANFIXTURE_H
+
+#include <QVector>
+#include "vlePlan.h"
+
+/**
+ * Random plans for the tests of the plan indexes.
+ *
+ * Values come from a small deterministic generator : a test gives its own
+ * seed, and gets the same plans on each run. Results of an index are
+ * compared with overlapping(), that tests every activity of a group.
+ */
+class vlePlanFixture
+{
+public:
+    explicit vlePlanFixture(quint32 seed)
+    {
+        mSeed = seed;
+    }
+    // Next value into [0, range)
+    quint32 next(quint32 range)
+    {
+        mSeed = (mSeed * 1103515245u) + 12345u;
+        return ((mSeed >> 8) % range);
+    }
+    // Add activities starting into [0, period) and lasting less than length
+    // ticks. If longLength is set, one activity of 17 lasts up to longLength.
+    void fill(vlePlan *plan, vlePlanGroup *group, int count,
+              quint32 period, quint32 length, quint32 longLength = 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            vlePlanTick start = next(period);
+            vlePlanTick len   = ((longLength > 0) && ((i % 17) == 0)) ? next(longLength) : next(length);
+            plan->addActivity(group, QString("a%1").arg(i), start, start + len);
+        }
+    }
+    // Positions of the activities overlapping [start, end] (both included)
+    static QVector<int> overlapping(const vlePlanGroup *group, vlePlanTick start, vlePlanTick end)
+    {
+        QVector<int> out;
+        for (int i = 0; i < group->count(); i++)
+        {
+            if ((group->tickStarts()[i] <= end) && (group->tickEnds()[i] >= start))
+                out.append(i);
+        }
+        return out;
+    }
+private:
+    quint32 mSeed;
+};
+
+#endif // VLEPLANFIXTURE_H
@@ -5,94 +5,132 @@
  *
  * Copyright (c) 2016 Agilack
  */
+#include <QAtomicInteger>
 #include <QFile>
 #include <QString>
 #include <QStringList>
 #include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 #include "vlePlan.h"
+#include "vlePlanStream.h"
+
+// Number of CSV rows decoded before being inserted into the plan
+static const int loadBatchSize = 16384;
 
 vlePlan::vlePlan()
+    : mActivityPool(std::make_shared< vlePlanPool<vlePlanActivity> >(4096)), mGroupPool(64)
 {
     mValid = false;
+    mTickEnd   = vlePlanTime::invalid;
+    mTickStart = vlePlanTime::invalid;
+    mDecodeNames = false;
+    mShareStrings = false;
+    mSharePeer = NULL;
+    mNames = std::make_shared<vlePlanNames>();
+    mStatsEnabled = false;
     mGroups.clear();
 }
 
+vlePlan::vlePlan(const vlePlan &other)
+    : mActivityPool(other.mActivityPool), mGroupPool(64)
+{
+    mValid      = other.mValid;
+    mTime       = other.mTime;
+    mTickEnd    = other.mTickEnd;
+    mTickStart  = other.mTickStart;
+    mGroupIndex = other.mGroupIndex;
+    mSchema     = other.mSchema;
+    mDecodeNames = other.mDecodeNames;
+    mShareStrings = other.mShareStrings;
+    mSharePeer  = NULL;
+    mNames      = other.mNames;
+    mStatsEnabled = other.mStatsEnabled;
+    mStats      = other.mStats;
+
+    // Groups are copied, but their arrays and activities are shared
+    mGroups.reserve(other.mGroups.count());
+    for (int i = 0; i < other.mGroups.count(); i++)
+    {
+        vlePlanGroup *g = mGroupPool.alloc(other.mGroups.at(i)->getName());
+        *g = *other.mGroups.at(i);
+        mGroups.push_back(g);
+    }
+}
+
+vlePlan::~vlePlan()
+{
+    if (mSharePeer)
+        mSharePeer->mSharePeer = NULL;
+}
+
 void vlePlan::clear(void)
 {
-    // Delete all known groups
-    while ( ! mGroups.isEmpty())
-        delete mGroups.takeFirst();
+    // Forget all known groups, objects are kept into pools for next load
+    mGroups.clear();
+    mGroupIndex.clear();
+    mGroupPool.reset();
+    // Activities still used by a snapshot can't be recycled : use a new pool
+    if (mActivityPool.use_count() == 1)
+        mActivityPool->reset();
+    else
+        mActivityPool = std::make_shared< vlePlanPool<vlePlanActivity> >(4096);
+    // The strings table only grows : reset it when not used anymore, else
+    // start a new one (the old one is released with its last snapshot). When
+    // strings are shared, use the table started by the other plan (if any)
+    if (mSharePeer && (mSharePeer->mNames != mNames))
+        mNames = mSharePeer->mNames;
+    else if (mNames.use_count() == 1)
+        mNames->reset();
+    else
+        mNames = std::make_shared<vlePlanNames>();
+    mStats.reset();
+    // Reset cache to NULL date
+    mTickEnd   = vlePlanTime::invalid;
+    mTickStart = vlePlanTime::invalid;
     // Mark current plan as invalid
     mValid = false;
 }
 
-QDate vlePlan::dateEnd(void)
+QDate vlePlan::dateEnd(void) const
 {
-    if ( mDateEnd.isValid() )
-        return mDateEnd;
-
-    QDate lastest;
-
-    for (int i = 0; i < mGroups.count(); i++)
-    {
-        vlePlanGroup *g = mGroups.at(i);
-
-        // If the reference is not already set
-        if ( ! lastest.isValid())
-        {
-            // Use the start date of this group as reference
-            lastest = g->dateEnd();
-            continue;
-        }
-
-        // If the end of this group is after the reference date
-        if (g->dateEnd() > lastest)
-            // Update to the lastest
-            lastest = g->dateEnd();
-    }
-
-    // Save the start date (cache)
-    mDateEnd = lastest;
-
-    return mDateEnd;
+    return mTime.toDate(mTickEnd);
 }
 
-QDate vlePlan::dateStart(void)
+QDate vlePlan::dateStart(void) const
 {
-    if ( mDateStart.isValid() )
-        return mDateStart;
-
-    QDate oldest;
-
-    for (int i = 0; i < mGroups.count(); i++)
-    {
-        vlePlanGroup *g = mGroups.at(i);
+    return mTime.toDate(mTickStart);
+}
 
-        // If the reference is not already set
-        if ( ! oldest.isValid())
-        {
-            // Use the start date of this group as reference
-            oldest = g->dateStart();
-            continue;
-        }
+vlePlanTick vlePlan::tickEnd(void) const
+{
+    return mTickEnd;
+}
 
-        // If the start of this group is before the reference date
-        if (g->dateStart() < oldest)
-            // Update to the oldest
-            oldest = g->dateStart();
-    }
+vlePlanTick vlePlan::tickStart(void) const
+{
+    return mTickStart;
+}
 
-    // Save the start date (cache)
-    mDateStart = oldest;
+const vlePlanTime &vlePlan::time(void) const
+{
+    return mTime;
+}
 
-    return mDateStart;
+void vlePlan::setResolution(vlePlanTime::Resolution resolution)
+{
+    // Ticks of loaded activities can't be converted, start a new plan
+    if (resolution != mTime.resolution())
+        clear();
+    mTime = vlePlanTime(resolution);
 }
 
-int vlePlan::countGroups(void)
+int vlePlan::countGroups(void) const
 {
     return mGroups.count();
 }
-int vlePlan::countActivities(void)
+int vlePlan::countActivities(void) const
 {
     int count = 0;
     for (int i = 0; i < mGroups.size(); ++i)
@@ -103,81 +141,246 @@ int vlePlan::countActivities(void)
     return count;
 }
 
-void vlePlan::loadFile(const QString &filename)
+bool vlePlan::loadFile(const QString &filename, QString *error)
 {
+    // Compressed files are decoded by a thread while the CSV is parsed
+    if (vlePlanStream::detect(filename) != vlePlanStream::Plain)
+    {
+        vlePlanStream stream(filename);
+        if ( ! stream.open(QIODevice::ReadOnly))
+        {
+            qWarning() << "vlePlan::loadFile()" << stream.errorString();
+            if (error)
+                *error = stream.errorString();
+            return false;
+        }
+        loadDevice(&stream);
+        // Rows decoded before a corrupted (or truncated) part are kept
+        QString decodeError = stream.decodeError();
+        stream.close();
+        if ( ! decodeError.isEmpty())
+        {
+            if (error)
+                *error = decodeError;
+            return false;
+        }
+        return true;
+    }
+
     QFile file(filename);
-    int lineCount;
-    bool hasClass = false;
-    int  attrCount = 0;
+    if ( ! file.open(QIODevice::ReadOnly))
+    {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    loadDevice(&file);
+    file.close();
+    return true;
+}
 
-    file.open(QIODevice::ReadOnly);
+void vlePlan::loadDevice(QIODevice *dev)
+{
+    // Decoded rows, inserted into the plan by batches
+    struct Row
+    {
+        QString name;
+        QString group;
+        QString type;
+        QString path;
+        vlePlanTick start;
+        vlePlanTick end;
+        QVector<QString> attributes;
+    };
+    QVector<Row> batch;
+    batch.reserve(loadBatchSize);
+
+    // Insert a batch : the size of each group is known before the insertion
+    auto insertBatch = [this, &batch]()
+    {
+        QHash<vlePlanGroup *, int> counts;
+        QVector<vlePlanGroup *> groups(batch.count());
+        for (int i = 0; i < batch.count(); i++)
+        {
+            groups[i] = getGroup(batch.at(i).group, true);
+            counts[groups.at(i)]++;
+        }
+        QHash<vlePlanGroup *, int>::const_iterator it;
+        for (it = counts.constBegin(); it != counts.constEnd(); ++it)
+            it.key()->reserve(it.key()->count() + it.value());
+
+        for (int i = 0; i < batch.count(); i++)
+        {
+            Row &row = batch[i];
+            vlePlanGroup *g = groups.at(i);
+            if (( ! row.path.isEmpty()) && g->path().isEmpty())
+                g->setPath(row.path);
+            vlePlanActivity *a = addActivity(g, row.name, row.start, row.end);
+            a->reserveAttributes(row.attributes.count());
+            if (mShareStrings)
+            {
+                // Use the strings already known by other plans
+                a->setClass(mNames->share(row.type));
+                for (int j = 0; j < row.attributes.count(); j++)
+                    a->addAttribute(mNames->share(row.attributes.at(j)));
+            }
+            else
+            {
+                a->setClass(std::move(row.type));
+                for (int j = 0; j < row.attributes.count(); j++)
+                    a->addAttribute(std::move(row.attributes[j]));
+            }
+        }
+        batch.clear();
+    };
 
-    lineCount = 0;
+    int lineCount = 0;
 
-    while ( ! file.atEnd() )
+    while ( ! dev->atEnd() )
     {
         // Get one line of text from CSV
-        QByteArray line = file.readLine();
-        // Split the string to get CSV columns into a list
-        QStringList fields = QString(line).split(QChar(';'));
+        QByteArray line = dev->readLine();
 
         if (lineCount == 0)
         {
-            // If the header line is malformed, abort file load
-            if (fields.count() < 4)
+            // Map the columns using header names. If the header line is
+            // malformed, abort file load
+            if ( ! mSchema.parseHeader(line))
                 break;
-            if (fields.count() > 4)
-            {
-                hasClass = true;
-                attrCount = (fields.count() - 5);
-            }
             // Clear current plan (if any previously loaded)
             clear();
             lineCount++;
             continue;
         }
-        // Sanity check
-        if (fields.count() < 4)
-            continue;
 
-        QString type;
-        QString startDate;
-        QString endDate;
-        if (hasClass)
+        // Remove end of line
+        int len = line.size();
+        while ((len > 0) && ((line.at(len - 1) == '\n') || (line.at(len - 1) == '\r')))
+            len--;
+
+        Row row;
+        row.start = vlePlanTime::invalid;
+        row.end   = vlePlanTime::invalid;
+        row.attributes.resize(mSchema.attributeCount());
+
+        // Split the line, only columns used by the schema are decoded
+        const char *data = line.constData();
+        int  last   = mSchema.lastColumn();
+        char sep    = mSchema.separator();
+        int  column = 0;
+        int  pos    = 0;
+        QByteArray quoted;
+        while ((column <= last) && (pos <= len))
         {
-            type      = fields.at(2);
-            startDate = fields.at(3);
-            endDate   = fields.at(4);
-        }
-        else
-        {
-            startDate = fields.at(2);
-            endDate   = fields.at(3);
-        }
-
-        // Save the activity into the vlePlan
-        vlePlanGroup    *g = getGroup(fields.at(1), true);
-        vlePlanActivity *a = g->addActivity(fields.at(0));
-        a->setClass(type);
-        a->setStart(QDate::fromString(startDate, Qt::ISODate));
-        a->setEnd  (QDate::fromString(endDate,   Qt::ISODate));
+            const char *field = (data + pos);
+            int  size   = 0;
+            bool isQuoted = false;
+            // A quoted field may contain separators, its quotes are doubled
+            if ((pos < len) && (data[pos] == '"'))
+            {
+                quoted.clear();
+                int i = (pos + 1);
+                while (i < len)
+                {
+                    if ((data[i] == '"') && ((i + 1) < len) && (data[i + 1] == '"'))
+                        i++;
+                    else if (data[i] == '"')
+                        break;
+                    quoted.append(data[i++]);
+                }
+                pos   = qMin((i + 1), len);
+                field = quoted.constData();
+                size  = quoted.size();
+                isQuoted = true;
+            }
+            const char *next = (const char *)memchr(data + pos, sep, len - pos);
+            int stop = next ? (int)(next - data) : len;
+            if ( ! isQuoted)
+                size = (stop - pos);
 
-        // Process additional attributes
-        for (int j = 0; j < attrCount; j++)
-        {
-            QString attr( fields.at(j + 5) );
-            a->addAttribute(attr);
+            switch (mSchema.role(column))
+            {
+                case vlePlanSchema::Name:
+                    row.name = QString::fromUtf8(field, size);
+                    break;
+                case vlePlanSchema::Group:
+                    row.group = QString::fromUtf8(field, size);
+                    break;
+                case vlePlanSchema::Class:
+                    row.type = QString::fromUtf8(field, size);
+                    break;
+                case vlePlanSchema::Start:
+                    row.start = mTime.parse(field, size);
+                    break;
+                case vlePlanSchema::End:
+                    row.end = mTime.parse(field, size);
+                    break;
+                case vlePlanSchema::Path:
+                    row.path = QString::fromUtf8(field, size);
+                    break;
+                case vlePlanSchema::Attribute:
+                    row.attributes[mSchema.attributeIndex(column)] = QString::fromUtf8(field, size);
+                    break;
+                default:
+                    break;
+            }
+            column++;
+            pos = (stop + 1);
+            if (next == NULL)
+                break;
         }
+        // Sanity check
+        if ((column < mSchema.requiredColumns()) || (row.start == vlePlanTime::invalid))
+            continue;
+        // An activity without end is a punctual event
+        if (row.end == vlePlanTime::invalid)
+            row.end = row.start;
+
+        batch.append(std::move(row));
+        if (batch.count() == loadBatchSize)
+            insertBatch();
 
         lineCount++;
     }
-    file.close();
+    insertBatch();
 
+    update();
+}
+
+void vlePlan::update(void)
+{
+    // Sort groups modified since last update (this rebuild their indexes)
     for (int i = 0; i < mGroups.size(); i++)
     {
         vlePlanGroup *grp = mGroups.at(i);
-        grp->sort();
+        if ( ! grp->isSorted())
+            grp->sort();
+    }
+
+    // Compute the plan bounds once, so readers never update a cache
+    mTickEnd   = vlePlanTime::invalid;
+    mTickStart = vlePlanTime::invalid;
+    for (int i = 0; i < mGroups.size(); i++)
+    {
+        vlePlanGroup *g = mGroups.at(i);
+        if (g->count() == 0)
+            continue;
+        if ((mTickStart == vlePlanTime::invalid) || (g->tickStart() < mTickStart))
+            mTickStart = g->tickStart();
+        if ((mTickEnd == vlePlanTime::invalid)   || (g->tickEnd()   > mTickEnd))
+            mTickEnd   = g->tickEnd();
+    }
+
+    // Update statistics (a new object, the old one may be used by snapshots),
+    // only the modified groups are computed again
+    if (mStatsEnabled)
+    {
+        std::shared_ptr<vlePlanStats> stats = std::make_shared<vlePlanStats>();
+        stats->build(this, mStats.get());
+        mStats = stats;
     }
+    else
+        mStats.reset();
 
     // If (at least) one group has been loaded ...
     if (countGroups() > 0)
@@ -185,234 +388,643 @@ void vlePlan::loadFile(const QString &filename)
         mValid = true;
 }
 
-vlePlanGroup *vlePlan::getGroup(QString name, bool create)
+vlePlanActivity *vlePlan::addActivity(vlePlanGroup *group, const QString &name,
+                                      vlePlanTick start, vlePlanTick end)
 {
-    vlePlanGroup *ret = NULL;
+    vlePlanActivityKey key;
 
-    for (int i = 0; i < mGroups.size(); ++i)
+    // If enabled, try to decode the name as "Operation@parcel:cycle#repeat"
+    if (mDecodeNames && mNames->decode(name, &key))
     {
-        vlePlanGroup *a = mGroups.at(i);
-        if (a->getName() == name)
-        {
-            ret = a;
-            break;
-        }
+        vlePlanActivity *a = group->addActivity(QString(), start, end);
+        a->setKey(mNames.get(), key);
+        return a;
     }
+    if (mShareStrings)
+        return group->addActivity(mNames->share(name), start, end);
+    return group->addActivity(name, start, end);
+}
+
+vlePlanGroup *vlePlan::getGroup(const QString &name, bool create)
+{
+    vlePlanGroup *ret = NULL;
+
+    // Search the group by name into the index
+    QHash<QString, int>::const_iterator it = mGroupIndex.constFind(name);
+    if (it != mGroupIndex.constEnd())
+        ret = mGroups.at(it.value());
+
     if ( (ret == NULL) && create)
     {
-        ret = new vlePlanGroup(name);
+        ret = mGroupPool.alloc(mShareStrings ? mNames->share(name) : name);
+        ret->setPool(mActivityPool.get());
+        mGroupIndex.insert(name, mGroups.count());
         mGroups.push_back(ret);
-
-        // Reset cache to NULL date
-        mDateEnd   = QDate();
-        mDateStart = QDate();
     }
     return ret;
 }
 
-vlePlanGroup *vlePlan::getGroup(int pos)
+vlePlanGroup *vlePlan::getGroup(int pos) const
 {
-    if (pos > mGroups.count())
+    if ((pos < 0) || (pos >= mGroups.count()))
         return NULL;
 
     return mGroups.at(pos);
 }
 
-bool vlePlan::isValid(void)
+int vlePlan::groupIndex(const QString &name) const
+{
+    return mGroupIndex.value(name, -1);
+}
+
+bool vlePlan::isValid(void) const
 {
     return mValid;
 }
 
+const vlePlanNames *vlePlan::names(void) const
+{
+    return mNames.get();
+}
+
+void vlePlan::setDecodeNames(bool enable)
+{
+    mDecodeNames = enable;
+}
+
+void vlePlan::shareStrings(vlePlan *other)
+{
+    // Both plans now use the same table (new strings are added by both)
+    mNames = other->mNames;
+    mShareStrings = true;
+    other->mShareStrings = true;
+    mSharePeer = other;
+    other->mSharePeer = this;
+}
+
+void vlePlan::setStatistics(bool enable)
+{
+    mStatsEnabled = enable;
+}
+
+const vlePlanStats *vlePlan::stats(void) const
+{
+    return mStats.get();
+}
+
+const vlePlanSchema &vlePlan::schema(void) const
+{
+    return mSchema;
+}
+
+void vlePlan::setSchema(const vlePlanSchema &schema)
+{
+    mSchema = schema;
+}
+
+vlePlanSnapshot vlePlan::snapshot(void) const
+{
+    return std::make_shared<const vlePlan>(*this);
+}
+
+vlePlanRange vlePlan::query(const QDate &start, const QDate &end,
+                            const QSet<QString> &classes,
+                            const QVector<int>  &groups) const
+{
+    if (( ! start.isValid()) || ( ! end.isValid()))
+        return vlePlanRange();
+    // The window contains the whole end day
+    return query(mTime.fromDate(start), mTime.fromDate(end.addDays(1)) - 1,
+                 classes, groups);
+}
+
+vlePlanRange vlePlan::query(vlePlanTick start, vlePlanTick end,
+                            const QSet<QString> &classes,
+                            const QVector<int>  &groups) const
+{
+    vlePlanRange range;
+    QVector<int> hits;
+
+    // If no group list has been specified, search into all groups
+    int count = groups.isEmpty() ? mGroups.count() : groups.count();
+
+    for (int i = 0; i < count; i++)
+    {
+        int pos = groups.isEmpty() ? i : groups.at(i);
+        if ((pos < 0) || (pos >= mGroups.count()))
+            continue;
+
+        vlePlanRange::Span span;
+        span.group      = mGroups.at(pos);
+        span.groupIndex = pos;
+        span.first      = range.mHits.count();
+
+        // The interval index only returns activities overlapping the window
+        hits.clear();
+        span.group->overlaps(start, end, &hits);
+        for (int j = 0; j < hits.count(); j++)
+        {
+            // An empty set means "all classes"
+            if (( ! classes.isEmpty()) &&
+                ( ! classes.contains(span.group->activities()[hits.at(j)]->getClass())))
+                continue;
+            range.mHits.append(hits.at(j));
+        }
+        span.last = range.mHits.count();
+        // Only keep groups with (at least) one activity
+        if (span.first < span.last)
+            range.mSpans.append(span);
+    }
+    return range;
+}
+
+// ******************** Range ******************** //
+
+vlePlanRange::vlePlanRange()
+{
+}
+
+vlePlanRange::const_iterator vlePlanRange::begin(void) const
+{
+    return const_iterator(this, 0, 0);
+}
+
+vlePlanRange::const_iterator vlePlanRange::end(void) const
+{
+    return const_iterator(this, mSpans.count(), mHits.count());
+}
+
+int vlePlanRange::count(void) const
+{
+    return mHits.count();
+}
+
+int vlePlanRange::countSpans(void) const
+{
+    return mSpans.count();
+}
+
+const vlePlanRange::Span &vlePlanRange::span(int pos) const
+{
+    return mSpans.at(pos);
+}
+
+int vlePlanRange::hit(int pos) const
+{
+    return mHits.at(pos);
+}
+
+vlePlanRange::const_iterator::const_iterator(const vlePlanRange *range, int span, int pos)
+{
+    mRange = range;
+    mSpan  = span;
+    mPos   = pos;
+}
+
+vlePlanActivity *vlePlanRange::const_iterator::operator*(void) const
+{
+    return mRange->mSpans.at(mSpan).group->activities()[mRange->mHits.at(mPos)];
+}
+
+vlePlanRange::const_iterator &vlePlanRange::const_iterator::operator++()
+{
+    // Spans are never empty, move to the next one at its end
+    mPos++;
+    if (mPos >= mRange->mSpans.at(mSpan).last)
+        mSpan++;
+    return *this;
+}
+
+bool vlePlanRange::const_iterator::operator==(const const_iterator &other) const
+{
+    return (mSpan == other.mSpan) && (mPos == other.mPos);
+}
+
+bool vlePlanRange::const_iterator::operator!=(const const_iterator &other) const
+{
+    return ! (*this == other);
+}
+
+int vlePlanRange::const_iterator::groupIndex(void) const
+{
+    return mRange->mSpans.at(mSpan).groupIndex;
+}
+
+int vlePlanRange::const_iterator::index(void) const
+{
+    return mRange->mHits.at(mPos);
+}
+
 // ******************** Activities ******************** //
 
-vlePlanActivity::vlePlanActivity(QString name)
+vlePlanActivity::vlePlanActivity(const QString &name)
 {
-    mName = name;
+    mName  = name;
+    mNames = NULL;
 }
 vlePlanActivity::~vlePlanActivity()
 {
     // Nothing to do
 }
 
-void vlePlanActivity::addAttribute(QString value)
+void vlePlanActivity::addAttribute(const QString &value)
 {
     mAttributes.append(value);
 }
 
-int vlePlanActivity::attributeCount(void)
+void vlePlanActivity::addAttribute(QString &&value)
 {
-    return mAttributes.size();
+    mAttributes.append(std::move(value));
 }
 
-QDate vlePlanActivity::dateEnd(void)
+int vlePlanActivity::attributeCount(void) const
 {
-    return mDateEnd;
+    return mAttributes.size();
 }
 
-QDate vlePlanActivity::dateStart(void)
+const QString &vlePlanActivity::getAttribute(int pos) const
 {
-    return mDateStart;
-}
+    static const QString empty;
 
-QString vlePlanActivity::getAttribute(int pos)
-{
-    if ((pos + 1) > mAttributes.size())
-        return QString();
+    if ((pos < 0) || (pos >= mAttributes.size()))
+        return empty;
 
     return mAttributes.at(pos);
 }
 
-QString vlePlanActivity::getClass(void)
+const QString &vlePlanActivity::getClass(void) const
 {
     return mClass;
 }
 
-QString vlePlanActivity::getName(void)
+QString vlePlanActivity::getName(void) const
 {
+    // Decoded names are rebuilt only when needed (display)
+    if (mNames)
+        return mNames->encode(mKey);
     return mName;
 }
 
-void vlePlanActivity::setClass(QString c)
+bool vlePlanActivity::hasKey(void) const
 {
-    mClass = c;
+    return (mNames != NULL);
+}
+
+const vlePlanActivityKey &vlePlanActivity::key(void) const
+{
+    return mKey;
+}
+
+void vlePlanActivity::reserveAttributes(int count)
+{
+    mAttributes.reserve(count);
 }
 
-void vlePlanActivity::setName(QString name)
+void vlePlanActivity::reset(const QString &name)
 {
     mName = name;
+    mNames = NULL;
+    mClass.clear();
+    mAttributes.clear();
 }
 
-void vlePlanActivity::setStart(QDate date)
+void vlePlanActivity::setClass(const QString &c)
 {
-    mDateStart = date;
+    mClass = c;
 }
 
-void vlePlanActivity::setEnd(QDate date)
+void vlePlanActivity::setClass(QString &&c)
 {
-    mDateEnd = date;
+    mClass = std::move(c);
+}
+
+void vlePlanActivity::setKey(const vlePlanNames *names, const vlePlanActivityKey &key)
+{
+    mName.clear();
+    mNames = names;
+    mKey   = key;
+}
+
+void vlePlanActivity::setName(const QString &name)
+{
+    mName  = name;
+    mNames = NULL;
 }
 
 // ******************** Groups ******************** //
 
-vlePlanGroup::vlePlanGroup(QString name)
+static QAtomicInteger<quint64> groupRevisions;
+
+static quint64 nextRevision(void)
+{
+    return (groupRevisions.fetchAndAddRelaxed(1) + 1);
+}
+
+vlePlanGroup::vlePlanGroup(const QString &name)
 {
     mName = name;
+    mPool = NULL;
+    mSorted = true;
+    mSortedCount = 0;
+    mRevision = nextRevision();
+    mMaxTick = vlePlanTime::invalid;
+    mIndexLevel = -1;
     mActivities.clear();
 }
 
 vlePlanGroup::~vlePlanGroup()
 {
-    // Delete all known activities
-    while ( ! mActivities.isEmpty())
-        delete mActivities.takeFirst();
+    // Activities allocated from a pool are released by the pool itself
+    if (mPool == NULL)
+        qDeleteAll(mActivities);
 }
 
-QDate vlePlanGroup::dateEnd(void)
+const QString &vlePlanGroup::getName(void) const
+{
+    return mName;
+}
+void vlePlanGroup::setName(const QString &name)
 {
-    if ( mDateEnd.isValid() )
-        return mDateEnd;
+    mName = name;
+    mRevision = nextRevision();
+}
 
-    QDate lastest;
+const QString &vlePlanGroup::path(void) const
+{
+    return mPath;
+}
 
-    for (int i = 0; i < mActivities.count(); i++)
-    {
-        vlePlanActivity *a = mActivities.at(i);
+void vlePlanGroup::setPath(const QString &path)
+{
+    mPath = path;
+}
 
-        // If the reference is not already set
-        if ( ! lastest.isValid())
-        {
-            // Use the start date of this activity as reference
-            lastest = a->dateEnd();
-            continue;
-        }
+void vlePlanGroup::setPool(vlePlanPool<vlePlanActivity> *pool)
+{
+    mPool = pool;
+}
 
-        // If the end of this activity is after the reference date
-        if (a->dateEnd() > lastest)
-            // Update to the lastest
-            lastest = a->dateEnd();
-    }
+void vlePlanGroup::reserve(int count)
+{
+    // Loaders reserve each batch : grow by steps to keep insertions linear
+    if (count <= mActivities.capacity())
+        return;
+    count = qMax(count, (mActivities.capacity() * 2));
+    mActivities.reserve(count);
+    mTickStart.reserve(count);
+    mTickEnd.reserve(count);
+}
 
-    // Save the start date (cache)
-    mDateEnd = lastest;
+void vlePlanGroup::reset(const QString &name)
+{
+    // Activities owned by the group must be deleted before reuse
+    if (mPool == NULL)
+        qDeleteAll(mActivities);
 
-    return mDateEnd;
+    mName = name;
+    mPath.clear();
+    mPool = NULL;
+    mSorted = true;
+    mSortedCount = 0;
+    mRevision = nextRevision();
+    mActivities.clear();
+    mTickEnd.clear();
+    mTickStart.clear();
+    mMaxTick = vlePlanTime::invalid;
+    mIndexMax.clear();
+    mIndexLevel = -1;
 }
 
-QDate vlePlanGroup::dateStart(void)
+int vlePlanGroup::count(void) const
 {
-    if ( mDateStart.isValid() )
-        return mDateStart;
+    return mActivities.count();
+}
 
-    QDate oldest;
+vlePlanActivity *vlePlanGroup::addActivity(const QString &name, vlePlanTick start, vlePlanTick end)
+{
+    vlePlanActivity *newAct;
 
-    for (int i = 0; i < mActivities.count(); i++)
-    {
-        vlePlanActivity *a = mActivities.at(i);
+    if (mPool)
+        newAct = mPool->alloc(name);
+    else
+        newAct = new vlePlanActivity(name);
 
-        // If the reference is not already set
-        if ( ! oldest.isValid())
-        {
-            // Use the start date of this activity as reference
-            oldest = a->dateStart();
-            continue;
-        }
+    // Insert it to the list of known activities, dates are only kept here
+    mActivities.push_back(newAct);
+    mTickStart.push_back(start);
+    mTickEnd.push_back(end);
+    mSorted = false;
 
-        // If the start of this activity is before the reference date
-        if (a->dateStart() < oldest)
-            // Update to the oldest
-            oldest = a->dateStart();
-    }
+    return newAct;
+}
 
-    // Save the start date (cache)
-    mDateStart = oldest;
+vlePlanActivity *vlePlanGroup::getActivity(int pos) const
+{
+    if ((pos < 0) || (pos >= mActivities.count()))
+        return NULL;
 
-    return mDateStart;
+    return mActivities.at(pos);
 }
 
-QString vlePlanGroup::getName(void)
+vlePlanActivity * const *vlePlanGroup::activities(void) const
 {
-    return mName;
+    return mActivities.constData();
 }
-void vlePlanGroup::setName(QString name)
+
+vlePlanGroup::const_iterator vlePlanGroup::begin(void) const
 {
-    mName = name;
+    return mActivities.constBegin();
 }
 
-int vlePlanGroup::count(void)
+vlePlanGroup::const_iterator vlePlanGroup::end(void) const
 {
-    return mActivities.count();
+    return mActivities.constEnd();
 }
 
-vlePlanActivity *vlePlanGroup::addActivity(QString name)
+const vlePlanTick *vlePlanGroup::tickEnds(void) const
 {
-    vlePlanActivity *newAct;
+    // Readers rely on the order of activities (and on the index)
+    Q_ASSERT_X(mSorted, "vlePlanGroup::tickEnds", "group not sorted");
+    return mTickEnd.constData();
+}
 
-    newAct = new vlePlanActivity(name);
+const vlePlanTick *vlePlanGroup::tickStarts(void) const
+{
+    Q_ASSERT_X(mSorted, "vlePlanGroup::tickStarts", "group not sorted");
+    return mTickStart.constData();
+}
 
-    // Insert it to the list of known activities
-    mActivities.push_back(newAct);
+vlePlanTick vlePlanGroup::tickEnd(void) const
+{
+    Q_ASSERT_X(mSorted, "vlePlanGroup::tickEnd", "group not sorted");
+    return mMaxTick;
+}
 
-    // Reset cache to NULL date
-    mDateEnd   = QDate();
-    mDateStart = QDate();
+vlePlanTick vlePlanGroup::tickStart(void) const
+{
+    Q_ASSERT_X(mSorted, "vlePlanGroup::tickStart", "group not sorted");
+    if (mTickStart.isEmpty())
+        return vlePlanTime::invalid;
+    return mTickStart.first();
+}
 
-    return newAct;
+bool vlePlanGroup::isSorted(void) const
+{
+    return mSorted;
 }
 
-vlePlanActivity *vlePlanGroup::getActivity(int pos)
+quint64 vlePlanGroup::revision(void) const
 {
-    if (pos > mActivities.count())
-        return NULL;
+    return mRevision;
+}
 
-    return mActivities.at(pos);
+void vlePlanGroup::sort(void)
+{
+    // Activities and their dates are moved together. Activities added in
+    // date order (live feed) don't need to be moved at all.
+    int done = qMin(mSortedCount, mActivities.count());
+    if ( ! std::is_sorted(mTickStart.constBegin() + qMax(0, done - 1), mTickStart.constEnd()))
+    {
+        QVector<int> order(mActivities.count());
+        for (int i = 0; i < order.count(); i++)
+            order[i] = i;
+        const vlePlanTick *starts = mTickStart.constData();
+        auto byStart = [starts](int a, int b)
+        {
+            return (starts[a] < starts[b]);
+        };
+        // Only the activities added since the last sort are sorted, then
+        // merged with the others (same result as a stable sort of all)
+        std::stable_sort(order.begin() + done, order.end(), byStart);
+        std::inplace_merge(order.begin(), order.begin() + done, order.end(), byStart);
+
+        QVector<vlePlanActivity *> activities(order.count());
+        QVector<vlePlanTick> tickStart(order.count());
+        QVector<vlePlanTick> tickEnd  (order.count());
+        for (int i = 0; i < order.count(); i++)
+        {
+            activities[i] = mActivities.at(order.at(i));
+            tickStart[i]  = mTickStart.at(order.at(i));
+            tickEnd[i]    = mTickEnd.at(order.at(i));
+        }
+        mActivities.swap(activities);
+        mTickStart.swap(tickStart);
+        mTickEnd.swap(tickEnd);
+    }
+
+    mMaxTick = vlePlanTime::invalid;
+    if ( ! mTickEnd.isEmpty())
+        mMaxTick = *std::max_element(mTickEnd.constBegin(), mTickEnd.constEnd());
+    buildIndex();
+    mSorted = true;
+    mSortedCount = mActivities.count();
+    mRevision = nextRevision();
 }
 
-bool sortActivityDate(vlePlanActivity *v1, vlePlanActivity *v2)
+void vlePlanGroup::buildIndex(void)
 {
-    return v1->dateStart() < v2->dateStart();
+    int n = mTickEnd.count();
+    mIndexMax   = mTickEnd;
+    mIndexLevel = -1;
+    if (n == 0)
+        return;
+
+    // Leaves (even positions) only contain their own activity. Nodes are
+    // updated level by level, bottom-up. The last node of each level may
+    // have no right child : the max of the last subtree is used instead.
+    int lastPos = 0;
+    vlePlanTick last = 0;
+    for (int i = 0; i < n; i += 2)
+    {
+        lastPos = i;
+        last    = mIndexMax.at(i);
+    }
+    int k;
+    for (k = 1; ((qint64)1 << k) <= n; k++)
+    {
+        int x    = (1 << (k - 1));
+        int step = (x << 2);
+        for (int i = ((x << 1) - 1); i < n; i += step)
+        {
+            vlePlanTick left  = mIndexMax.at(i - x);
+            vlePlanTick right = ((i + x) < n) ? mIndexMax.at(i + x) : last;
+            mIndexMax[i] = qMax(mTickEnd.at(i), qMax(left, right));
+        }
+        // Move to the parent of the last node
+        lastPos = ((lastPos >> k) & 1) ? (lastPos - x) : (lastPos + x);
+        if ((lastPos < n) && (mIndexMax.at(lastPos) > last))
+            last = mIndexMax.at(lastPos);
+    }
+    mIndexLevel = (k - 1);
 }
 
-void vlePlanGroup::sort(void)
+void vlePlanGroup::overlaps(vlePlanTick start, vlePlanTick end, QVector<int> *out) const
+{
+    struct Item
+    {
+        int  level;
+        int  pos;
+        bool leftDone;
+    };
+    if (mIndexLevel < 0)
+        return;
+
+    // Top-down walk of the tree, subtrees ended before start are skipped.
+    // Positions are appended in increasing order.
+    int  n = mTickStart.count();
+    Item stack[64];
+    int  top = 0;
+    stack[top++] = { mIndexLevel, ((1 << mIndexLevel) - 1), false };
+    while (top > 0)
+    {
+        Item z = stack[--top];
+        if (z.level <= 3)
+        {
+            // Small subtree : test all its activities
+            int i0 = ((z.pos >> z.level) << z.level);
+            int i1 = qMin((i0 + (1 << (z.level + 1)) - 1), n);
+            for (int i = i0; (i < i1) && (mTickStart.at(i) <= end); i++)
+            {
+                if (mTickEnd.at(i) >= start)
+                    out->append(i);
+            }
+        }
+        else if ( ! z.leftDone)
+        {
+            // Come back to this node after its left child
+            int left = (z.pos - (1 << (z.level - 1)));
+            stack[top++] = { z.level, z.pos, true };
+            if ((left >= n) || (mIndexMax.at(left) >= start))
+                stack[top++] = { (z.level - 1), left, false };
+        }
+        else if ((z.pos < n) && (mTickStart.at(z.pos) <= end))
+        {
+            if (mTickEnd.at(z.pos) >= start)
+                out->append(z.pos);
+            stack[top++] = { (z.level - 1), (z.pos + (1 << (z.level - 1))), false };
+        }
+    }
+}
+
+// ******************** Store ******************** //
+
+vlePlanStore::vlePlanStore()
+{
+    // Start with an empty plan, so readers always get a valid snapshot
+    mCurrent = std::make_shared<const vlePlan>();
+}
+
+vlePlanSnapshot vlePlanStore::current(void) const
+{
+    return std::atomic_load(&mCurrent);
+}
+
+void vlePlanStore::publish(const vlePlan &plan)
+{
+    publish(plan.snapshot());
+}
+
+void vlePlanStore::publish(const vlePlanSnapshot &snapshot)
 {
-    std::sort(mActivities.begin(), mActivities.end(), sortActivityDate);
+    std::atomic_store(&mCurrent, snapshot);
 }
@@ -9,70 +9,232 @@
 #define VLEPLAN_H
 
 #include <QDate>
+#include <QHash>
+#include <QIODevice>
 #include <QList>
+#include <QSet>
+#include <QVector>
+#include <memory>
+#include "vlePlanNames.h"
+#include "vlePlanPool.h"
+#include "vlePlanSchema.h"
+#include "vlePlanStats.h"
+#include "vlePlanTime.h"
 
 class vlePlanActivity
 {
 public:
-    vlePlanActivity (QString name);
+    vlePlanActivity (const QString &name);
     ~vlePlanActivity();
-    void    addAttribute(QString value);
-    int     attributeCount(void);
-    QDate   dateEnd   (void);
-    QDate   dateStart (void);
-    QString getAttribute(int pos);
-    QString getClass(void);
-    QString getName (void);
-    void    setClass(QString c);
-    void    setName (QString name);
-    void    setStart(QDate   date);
-    void    setEnd  (QDate   date);
+    void    addAttribute(const QString &value);
+    void    addAttribute(QString &&value);
+    int     attributeCount(void) const;
+    const QString &getAttribute(int pos) const;
+    const QString &getClass(void) const;
+    QString getName (void) const;
+    bool    hasKey  (void) const;
+    const vlePlanActivityKey &key(void) const;
+    void    reserveAttributes(int count);
+    void    reset   (const QString &name);
+    void    setClass(const QString &c);
+    void    setClass(QString &&c);
+    void    setKey  (const vlePlanNames *names, const vlePlanActivityKey &key);
+    void    setName (const QString &name);
 private:
-    QString mName;
+    QString mName;     // Name, when it has not been decoded into a key
+    const vlePlanNames *mNames;  // Table of the key strings (NULL if no key)
+    vlePlanActivityKey  mKey;
     QString mClass;
-    QDate   mDateStart;
-    QDate   mDateEnd;
-    QList<QString> mAttributes;
+    QVector<QString> mAttributes;
 };
 
 class vlePlanGroup
 {
 public:
-    vlePlanGroup   (QString name);
+    typedef QVector<vlePlanActivity *>::const_iterator const_iterator;
+public:
+    vlePlanGroup   (const QString &name);
     ~vlePlanGroup  ();
-    QDate   dateEnd  (void);
-    QDate   dateStart(void);
-    QString getName(void);
-    void    setName(QString name);
-    int     count(void);
-    vlePlanActivity *addActivity(QString name);
-    vlePlanActivity *getActivity(int pos);
+    const QString &getName(void) const;
+    void    setName(const QString &name);
+    const QString &path(void) const;
+    void    setPath(const QString &path);
+    void    setPool(vlePlanPool<vlePlanActivity> *pool);
+    void    reserve(int count);
+    void    reset  (const QString &name);
+    int     count(void) const;
+    vlePlanActivity *addActivity(const QString &name, vlePlanTick start, vlePlanTick end);
+    vlePlanActivity *getActivity(int pos) const;
+    // Direct access to the (contiguous) list of activities
+    vlePlanActivity * const *activities(void) const;
+    const_iterator   begin(void) const;
+    const_iterator   end  (void) const;
+    const vlePlanTick *tickEnds  (void) const;
+    const vlePlanTick *tickStarts(void) const;
+    vlePlanTick tickEnd  (void) const;
+    vlePlanTick tickStart(void) const;
+    void    overlaps(vlePlanTick start, vlePlanTick end, QVector<int> *out) const;
+    bool    isSorted(void) const;
+    quint64 revision(void) const;
     void    sort(void);
 private:
-    QDate   mDateEnd;    // Cache for the lastest "end date" of group activities
-    QDate   mDateStart;  // Cache for the earliest "start date"of group activities
+    void    buildIndex(void);
+private:
     QString mName;
-    QList<vlePlanActivity *> mActivities;
+    QString mPath;  // Position into the groups hierarchy (optional)
+    QVector<vlePlanActivity *> mActivities;
+    // Start/end of activities as ticks (same order as mActivities). This is
+    // the only copy of the dates, activities themselves don't store them.
+    QVector<vlePlanTick> mTickEnd;
+    QVector<vlePlanTick> mTickStart;
+    vlePlanTick mMaxTick;  // Latest end of the group
+    // Interval tree stored into the sorted arrays : each odd position is
+    // the node of a subtree, with the maximum end of this subtree
+    QVector<vlePlanTick> mIndexMax;
+    int     mIndexLevel;  // Level of the root (-1 if empty)
+    // Pool used to allocate activities (if NULL, activities are owned)
+    vlePlanPool<vlePlanActivity> *mPool;
+    bool    mSorted;  // False when activities were added since last sort
+    int     mSortedCount;  // Activities already sorted (the first ones)
+    // Version of the content, unique for all the groups : two groups (or
+    // snapshots of a group) with the same revision have the same content
+    quint64 mRevision;
+};
+
+/**
+ * Lightweight view of the activities overlapping a time window.
+ *
+ * The view only stores the positions of the matching activities, found
+ * with the interval index of each group : building a range costs the size
+ * of the result (not the size of the groups), and no plan object is copied.
+ */
+class vlePlanRange
+{
+public:
+    struct Span
+    {
+        vlePlanGroup *group;
+        int groupIndex;
+        int first;  // First position of this group into the hits
+        int last;   // Position after the last hit of this group
+    };
+    class const_iterator
+    {
+    public:
+        const_iterator(const vlePlanRange *range, int span, int pos);
+        vlePlanActivity *operator*(void) const;
+        const_iterator  &operator++();
+        bool operator==(const const_iterator &other) const;
+        bool operator!=(const const_iterator &other) const;
+        int  groupIndex(void) const;
+        int  index     (void) const;
+    private:
+        const vlePlanRange *mRange;
+        int mSpan;
+        int mPos;   // Position into the hits
+    };
+public:
+    vlePlanRange();
+    const_iterator begin(void) const;
+    const_iterator end  (void) const;
+    int  count(void) const;
+    int  countSpans(void) const;
+    const Span &span(int pos) const;
+    int  hit(int pos) const;
+private:
+    friend class vlePlan;
+    QVector<Span> mSpans;
+    QVector<int>  mHits;  // Positions into the groups, span by span
 };
 
+class vlePlan;
+
+// Immutable and reference-counted version of a plan, safe to share between threads
+typedef std::shared_ptr<const vlePlan> vlePlanSnapshot;
+
+/**
+ * A plan is written by one thread at a time (loader or live feed). Readers
+ * (views, renderers, exporters) must use a snapshot : a copy of the plan
+ * made by snapshot(), that is never modified afterwards.
+ *
+ * Copies are cheap : activities are shared (the activity pool is owned by
+ * all the copies) and groups only reference their implicitly shared arrays.
+ * When the writer adds activities to a group, only the arrays of this group
+ * are detached (copy-on-write at group level).
+ */
 class vlePlan
 {
 public:
     vlePlan();
+    vlePlan(const vlePlan &other);
+    ~vlePlan();
     void  clear(void);
-    QDate dateEnd  (void);
-    QDate dateStart(void);
-    void loadFile(const QString &filename);
-    vlePlanGroup *getGroup(QString name, bool create = false);
-    vlePlanGroup *getGroup(int pos);
-    int  countGroups(void);
-    int  countActivities(void);
-    bool isValid(void);
+    QDate dateEnd  (void) const;
+    QDate dateStart(void) const;
+    void loadDevice(QIODevice *dev);
+    bool loadFile(const QString &filename, QString *error = 0);
+    vlePlanGroup *getGroup(const QString &name, bool create = false);
+    vlePlanGroup *getGroup(int pos) const;
+    int  groupIndex(const QString &name) const;
+    int  countGroups(void) const;
+    int  countActivities(void) const;
+    bool isValid(void) const;
+    const vlePlanTime &time(void) const;
+    void setResolution(vlePlanTime::Resolution resolution);
+    vlePlanTick tickEnd  (void) const;
+    vlePlanTick tickStart(void) const;
+    const vlePlanSchema &schema(void) const;
+    void setSchema(const vlePlanSchema &schema);
+    vlePlanActivity *addActivity(vlePlanGroup *group, const QString &name,
+                                 vlePlanTick start, vlePlanTick end);
+    const vlePlanNames *names(void) const;
+    void setDecodeNames(bool enable);
+    void shareStrings(vlePlan *other);
+    void setStatistics(bool enable);
+    const vlePlanStats *stats(void) const;
+    vlePlanSnapshot snapshot(void) const;
+    void update(void);
+    vlePlanRange query(const QDate &start, const QDate &end,
+                       const QSet<QString> &classes = QSet<QString>(),
+                       const QVector<int>  &groups  = QVector<int>()) const;
+    vlePlanRange query(vlePlanTick start, vlePlanTick end,
+                       const QSet<QString> &classes = QSet<QString>(),
+                       const QVector<int>  &groups  = QVector<int>()) const;
 private:
     bool  mValid;
-    QDate mDateEnd;    // Cache for the start date
-    QDate mDateStart;  // Cache for the end date
-    QList<vlePlanGroup *> mGroups;
+    vlePlanTime mTime;       // Resolution of the ticks
+    vlePlanTick mTickEnd;    // End of the plan (set by update)
+    vlePlanTick mTickStart;  // Start of the plan (set by update)
+    QVector<vlePlanGroup *> mGroups;
+    QHash<QString, int>     mGroupIndex; // Group name to position into mGroups
+    vlePlanSchema mSchema;  // Columns of the loaded file, and attributes to load
+    bool  mDecodeNames;     // Store activity names as keys into mNames
+    bool  mShareStrings;    // Store all strings into mNames (shared with other plans)
+    vlePlan *mSharePeer;    // Plan sharing the strings table (not for snapshots)
+    std::shared_ptr<vlePlanNames> mNames;
+    bool  mStatsEnabled;    // Build statistics on each update
+    std::shared_ptr<const vlePlanStats> mStats;
+    // Plan objects are allocated from these pools (activities are shared with snapshots)
+    std::shared_ptr< vlePlanPool<vlePlanActivity> > mActivityPool;
+    vlePlanPool<vlePlanGroup> mGroupPool;
+};
+
+/**
+ * Holder of the last published snapshot of a plan.
+ *
+ * The writer publishes a new version with publish(), readers get it with
+ * current() from any thread. Readers keep their snapshot alive as long as
+ * they use it, even when newer versions are published.
+ */
+class vlePlanStore
+{
+public:
+    vlePlanStore();
+    vlePlanSnapshot current(void) const;
+    void publish(const vlePlan &plan);
+    void publish(const vlePlanSnapshot &snapshot);
+private:
+    vlePlanSnapshot mCurrent;
 };
 
 #endif // VLEPLAN_H
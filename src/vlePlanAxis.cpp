@@ -0,0 +1,261 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QPair>
+#include <QtMath>
+#include <algorithm>
+#include "vlePlanAxis.h"
+#include "vlePlanLayout.h"
+
+typedef QPair<vlePlanTick, vlePlanTick> vlePlanAxisPeriod;
+
+vlePlanAxis::vlePlanAxis()
+{
+    mBreakWidth = 20;
+}
+
+void vlePlanAxis::build(const QList<const vlePlan *> &plans, vlePlanTick start, vlePlanTick end,
+                        vlePlanTick minGap)
+{
+    mSegments.clear();
+    if (end < start)
+        return;
+
+    // Collect the busy periods of each group (activities are sorted by start)
+    QVector<vlePlanAxisPeriod> busy;
+    if (minGap > 0)
+    {
+        for (int k = 0; k < plans.count(); k++)
+        {
+            const vlePlan *plan = plans.at(k);
+            for (int i = 0; i < plan->countGroups(); i++)
+            {
+                const vlePlanGroup *g = plan->getGroup(i);
+                const vlePlanTick *starts = g->tickStarts();
+                const vlePlanTick *ends   = g->tickEnds();
+                if (g->count() == 0)
+                    continue;
+                vlePlanAxisPeriod cur(starts[0], ends[0]);
+                for (int j = 1; j < g->count(); j++)
+                {
+                    if (starts[j] > (cur.second + minGap))
+                    {
+                        busy.append(cur);
+                        cur.first = starts[j];
+                    }
+                    cur.second = qMax(cur.second, ends[j]);
+                }
+                busy.append(cur);
+            }
+        }
+        std::sort(busy.begin(), busy.end());
+    }
+
+    // Cut the axis at each gap larger than minGap, keeping a margin around
+    // the activities on both sides of the break
+    vlePlanTick margin  = (minGap / 4);
+    vlePlanTick pos     = start;
+    vlePlanTick busyEnd = start;
+    for (int i = 0; i < busy.count(); i++)
+    {
+        const vlePlanAxisPeriod &p = busy.at(i);
+        if ((p.first - busyEnd) > minGap)
+        {
+            Segment linear = { pos, (busyEnd + margin), 0, 0, 0, false };
+            Segment gap    = { (busyEnd + margin), (p.first - margin), 0, 0, 0, true };
+            mSegments.append(linear);
+            mSegments.append(gap);
+            pos = gap.tickEnd;
+        }
+        busyEnd = qMax(busyEnd, p.second);
+    }
+    Segment last = { pos, qMax(pos, end), 0, 0, 0, false };
+    mSegments.append(last);
+
+    setScale(1, mBreakWidth);
+}
+
+void vlePlanAxis::setScale(qreal scale, int breakWidth)
+{
+    mBreakWidth = breakWidth;
+
+    // Compute pixel positions of segments, from left to right
+    qint32 pixel = 0;
+    for (int i = 0; i < mSegments.count(); i++)
+    {
+        Segment &s = mSegments[i];
+        vlePlanTick len = (s.tickEnd - s.tickStart);
+        s.pixelStart = pixel;
+        if (s.isBreak)
+        {
+            s.pixelEnd = pixel + breakWidth;
+            s.scale    = (len > 0) ? ((qreal)breakWidth / len) : 0;
+        }
+        else
+        {
+            s.pixelEnd = pixel + (qint32)(len * scale);
+            s.scale    = scale;
+        }
+        pixel = s.pixelEnd;
+    }
+}
+
+vlePlanTick vlePlanAxis::activeTicks(void) const
+{
+    vlePlanTick count = 0;
+    for (int i = 0; i < mSegments.count(); i++)
+    {
+        if ( ! mSegments.at(i).isBreak)
+            count += (mSegments.at(i).tickEnd - mSegments.at(i).tickStart);
+    }
+    return count;
+}
+
+int vlePlanAxis::breakCount(void) const
+{
+    // Linear and break segments alternate
+    return (mSegments.count() / 2);
+}
+
+int vlePlanAxis::breakWidth(void) const
+{
+    return mBreakWidth;
+}
+
+int vlePlanAxis::count(void) const
+{
+    return mSegments.count();
+}
+
+const vlePlanAxis::Segment &vlePlanAxis::segment(int pos) const
+{
+    return mSegments.at(pos);
+}
+
+bool vlePlanAxis::isBreak(vlePlanTick tick) const
+{
+    if (mSegments.isEmpty())
+        return false;
+    const Segment &s = mSegments.at(segmentAtTick(tick));
+    return s.isBreak && (tick > s.tickStart) && (tick < s.tickEnd);
+}
+
+bool vlePlanAxis::isEmpty(void) const
+{
+    return mSegments.isEmpty();
+}
+
+int vlePlanAxis::width(void) const
+{
+    if (mSegments.isEmpty())
+        return 0;
+    return mSegments.last().pixelEnd;
+}
+
+qint32 vlePlanAxis::toPixel(vlePlanTick tick) const
+{
+    if (mSegments.isEmpty())
+        return 0;
+    // Ticks outside the axis are extrapolated from the first or last segment
+    const Segment &s = mSegments.at(segmentAtTick(tick));
+    return s.pixelStart + (qint32)((tick - s.tickStart) * s.scale);
+}
+
+vlePlanTick vlePlanAxis::toTick(qint32 pixel) const
+{
+    if (mSegments.isEmpty())
+        return 0;
+    const Segment &s = mSegments.at(segmentAtPixel(pixel));
+    if (s.scale <= 0)
+        return s.tickStart;
+    return s.tickStart + qFloor((pixel - s.pixelStart) / s.scale);
+}
+
+void vlePlanAxis::map(const vlePlanTick *start, const vlePlanTick *end, int count,
+                      qint32 clipStart, qint32 clipEnd, qint32 *x, qint32 *width) const
+{
+    int i = 0;
+    while (i < count)
+    {
+        // Activities are sorted by start : those of a segment are contiguous
+        int seg = segmentAtTick(start[i]);
+        const Segment &s = mSegments.at(seg);
+        int n = (count - i);
+        if (seg < (mSegments.count() - 1))
+            n = (std::upper_bound(start + i, start + count, s.tickEnd) - (start + i));
+        if (n < 1)
+            n = 1;
+
+        // Each segment is linear, use the layout kernel relative to it
+        vlePlanLayout::map(start + i, end + i, n, s.tickStart, s.scale,
+                           clipStart - s.pixelStart, clipEnd - s.pixelStart,
+                           x + i, width + i);
+        for (int j = i; j < (i + n); j++)
+            x[j] += s.pixelStart;
+        i += n;
+    }
+}
+
+int vlePlanAxis::segmentAtTick(vlePlanTick tick) const
+{
+    // First segment ending after the tick (a tick at the end of a segment
+    // belongs to it, not to the following break)
+    int pos = 0;
+    int len = mSegments.count();
+    while (len > 0)
+    {
+        int half = (len / 2);
+        if (mSegments.at(pos + half).tickEnd < tick)
+        {
+            pos += (half + 1);
+            len -= (half + 1);
+        }
+        else
+            len = half;
+    }
+    return qMin(pos, mSegments.count() - 1);
+}
+
+int vlePlanAxis::segmentAtPixel(qint32 pixel) const
+{
+    int pos = 0;
+    int len = mSegments.count();
+    while (len > 0)
+    {
+        int half = (len / 2);
+        if (mSegments.at(pos + half).pixelEnd < pixel)
+        {
+            pos += (half + 1);
+            len -= (half + 1);
+        }
+        else
+            len = half;
+    }
+    return qMin(pos, mSegments.count() - 1);
+}
+
+bool vlePlanAxis::operator==(const vlePlanAxis &other) const
+{
+    // Same segments, at the same pixels : ticks are drawn at the same place
+    if (mSegments.count() != other.mSegments.count())
+        return false;
+    for (int i = 0; i < mSegments.count(); i++)
+    {
+        const Segment &a = mSegments.at(i);
+        const Segment &b = other.mSegments.at(i);
+        if ((a.tickStart  != b.tickStart)  || (a.tickEnd  != b.tickEnd) ||
+            (a.pixelStart != b.pixelStart) || (a.pixelEnd != b.pixelEnd) ||
+            (a.scale != b.scale) || (a.isBreak != b.isBreak))
+            return false;
+    }
+    return true;
+}
+
+bool vlePlanAxis::operator!=(const vlePlanAxis &other) const
+{
+    return ! (*this == other);
+}
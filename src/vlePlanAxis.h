@@ -0,0 +1,64 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANAXIS_H
+#define VLEPLANAXIS_H
+
+#include <QList>
+#include <QVector>
+#include "vlePlan.h"
+#include "vlePlanTime.h"
+
+/**
+ * Mapping between ticks and pixels along the time axis.
+ *
+ * The axis is a table of segments, sorted both by ticks and by pixels.
+ * Each segment is linear. By default the axis has only one segment. With
+ * gap compression, long periods without any activity (into all the plans)
+ * become "breaks" : segments with a fixed width in pixels. Both conversions
+ * are made with a binary search into the table.
+ */
+class vlePlanAxis
+{
+public:
+    struct Segment
+    {
+        vlePlanTick tickStart;
+        vlePlanTick tickEnd;
+        qint32      pixelStart;
+        qint32      pixelEnd;
+        qreal       scale;    // Pixels per tick
+        bool        isBreak;
+    };
+public:
+    vlePlanAxis();
+    void   build(const QList<const vlePlan *> &plans, vlePlanTick start, vlePlanTick end,
+                 vlePlanTick minGap = 0);
+    void   setScale(qreal scale, int breakWidth = 20);
+    vlePlanTick activeTicks(void) const;
+    int    breakCount(void) const;
+    int    breakWidth(void) const;
+    int    count(void) const;
+    const Segment &segment(int pos) const;
+    bool   isBreak(vlePlanTick tick) const;
+    bool   isEmpty(void) const;
+    int    width(void) const;
+    qint32      toPixel(vlePlanTick tick) const;
+    vlePlanTick toTick (qint32 pixel) const;
+    void   map(const vlePlanTick *start, const vlePlanTick *end, int count,
+               qint32 clipStart, qint32 clipEnd, qint32 *x, qint32 *width) const;
+    bool   operator==(const vlePlanAxis &other) const;
+    bool   operator!=(const vlePlanAxis &other) const;
+private:
+    int    segmentAtTick (vlePlanTick tick) const;
+    int    segmentAtPixel(qint32 pixel) const;
+private:
+    QVector<Segment> mSegments;
+    int mBreakWidth;
+};
+
+#endif // VLEPLANAXIS_H
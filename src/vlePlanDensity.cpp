@@ -0,0 +1,175 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include "vlePlan.h"
+#include "vlePlanDensity.h"
+
+vlePlanDensity::vlePlanDensity()
+{
+    mOrigin = 0;
+}
+
+void vlePlanDensity::build(const vlePlan *plan, int buckets, const vlePlanDensity *previous)
+{
+    mLevels.clear();
+    mGroups.clear();
+
+    if ((plan == NULL) || (plan->tickStart() == vlePlanTime::invalid) || (buckets < 1))
+        return;
+
+    // Cut the plan period into buckets, both count and length are powers of two
+    mOrigin = plan->tickStart();
+    vlePlanTick span = qMax((vlePlanTick)1, (plan->tickEnd() - mOrigin + 1));
+    int count = 1;
+    while ((count < buckets) && (count < span))
+        count *= 2;
+    vlePlanTick len = 1;
+    while ((len * count) < span)
+        len *= 2;
+
+    // Levels from the finest one, each one merges the buckets of the previous one by pairs
+    int offset = 0;
+    for (int n = count; n >= 1; n /= 2)
+    {
+        Level l;
+        l.buckets = n;
+        l.ticks   = (len * (count / n));
+        l.offset  = offset;
+        l.max     = 0;
+        mLevels.append(l);
+        offset += n;
+    }
+
+    // Groups not modified since the previous density (with the same grid) are kept
+    bool reuse = previous && (previous->mOrigin == mOrigin) && ( ! previous->mLevels.isEmpty()) &&
+                 (previous->mLevels.first().buckets == count) && (previous->mLevels.first().ticks == len);
+
+    int groups = plan->countGroups();
+    mGroups.reserve(groups);
+    for (int i = 0; i < groups; i++)
+    {
+        if (reuse && (i < previous->mGroups.count()) &&
+            (previous->mGroups.at(i)->revision == plan->getGroup(i)->revision()))
+            mGroups.append(previous->mGroups.at(i));
+        else
+        {
+            std::shared_ptr<Group> g = std::make_shared<Group>();
+            buildGroup(plan, i, g.get());
+            mGroups.append(g);
+        }
+        for (int k = 0; k < mLevels.count(); k++)
+            mLevels[k].max = qMax(mLevels.at(k).max, mGroups.last()->max.at(k));
+    }
+}
+
+void vlePlanDensity::buildGroup(const vlePlan *plan, int group, Group *out) const
+{
+    const vlePlanGroup *g = plan->getGroup(group);
+    const vlePlanTick *tickStarts = g->tickStarts();
+    const vlePlanTick *tickEnds   = g->tickEnds();
+    int         count = mLevels.first().buckets;
+    vlePlanTick len   = mLevels.first().ticks;
+
+    out->revision = g->revision();
+    out->values.fill(0, mLevels.last().offset + 1);
+    out->max.fill(0, mLevels.count());
+
+    // Ticks of each bucket covered by activities : buckets fully covered are
+    // counted with a difference array, partial ones are summed directly
+    QVector<qint64> full(count + 1, 0);
+    QVector<qint64> part(count, 0);
+    for (int j = 0; j < g->count(); j++)
+    {
+        // A punctual activity covers one tick
+        vlePlanTick s = (tickStarts[j] - mOrigin);
+        vlePlanTick e = qMax((tickEnds[j] - mOrigin), (s + 1));
+        int b0 = (int)(s / len);
+        int b1 = qMin((int)((e - 1) / len), (count - 1));
+        if ((s < 0) || (b0 >= count))
+            continue;
+
+        if (b0 == b1)
+            part[b0] += (e - s);
+        else
+        {
+            part[b0] += (((b0 + 1) * len) - s);
+            part[b1] += qMin((e - (b1 * len)), len);
+            full[b0 + 1] += 1;
+            full[b1]     -= 1;
+        }
+    }
+
+    // Mean number of activities running into each bucket
+    float  *values  = out->values.data();
+    qint64  running = 0;
+    for (int b = 0; b < count; b++)
+    {
+        running  += full[b];
+        values[b] = (float)((running * len) + part[b]) / len;
+        out->max[0] = qMax(out->max.at(0), values[b]);
+    }
+
+    // Next levels merge buckets by pairs
+    for (int k = 1; k < mLevels.count(); k++)
+    {
+        const float *src = values + mLevels.at(k - 1).offset;
+        float       *dst = values + mLevels.at(k).offset;
+        for (int b = 0; b < mLevels.at(k).buckets; b++)
+        {
+            dst[b] = ((src[2 * b] + src[(2 * b) + 1]) / 2);
+            out->max[k] = qMax(out->max.at(k), dst[b]);
+        }
+    }
+}
+
+int vlePlanDensity::bucketCount(int level) const
+{
+    return mLevels.at(level).buckets;
+}
+
+vlePlanTick vlePlanDensity::bucketTicks(int level) const
+{
+    return mLevels.at(level).ticks;
+}
+
+int vlePlanDensity::groupCount(void) const
+{
+    return mGroups.count();
+}
+
+int vlePlanDensity::levelCount(void) const
+{
+    return mLevels.count();
+}
+
+int vlePlanDensity::levelFor(int width) const
+{
+    // Finest level with (at least) one pixel per bucket
+    for (int i = 0; i < mLevels.count(); i++)
+    {
+        if (mLevels.at(i).buckets <= width)
+            return i;
+    }
+    return (mLevels.count() - 1);
+}
+
+float vlePlanDensity::maxValue(int level) const
+{
+    return mLevels.at(level).max;
+}
+
+vlePlanTick vlePlanDensity::origin(void) const
+{
+    return mOrigin;
+}
+
+const float *vlePlanDensity::values(int level, int group) const
+{
+    if ((group < 0) || (group >= mGroups.count()))
+        return NULL;
+    return mGroups.at(group)->values.constData() + mLevels.at(level).offset;
+}
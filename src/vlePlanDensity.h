@@ -0,0 +1,65 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANDENSITY_H
+#define VLEPLANDENSITY_H
+
+#include <QVector>
+#include <memory>
+#include "vlePlanTime.h"
+
+class vlePlan;
+
+/**
+ * Activity density of a plan, per group and time bucket.
+ *
+ * The finest level cuts the plan period into buckets of the same length,
+ * each value is the mean number of activities running during the bucket.
+ * Each following level merges the buckets of the previous one by pairs,
+ * down to a single bucket. An overview of any width is then drawn from the
+ * nearest level, at a cost that does not depend on the activity count.
+ *
+ * The bucket count (about the width of the overview, never more than the
+ * ticks of the plan) and the bucket length are powers of two : the grid
+ * stays the same while a plan grows, and the groups that did not change
+ * since the previous density are shared with it.
+ */
+class vlePlanDensity
+{
+public:
+    vlePlanDensity();
+    void   build(const vlePlan *plan, int buckets, const vlePlanDensity *previous = NULL);
+    int    bucketCount(int level) const;
+    vlePlanTick bucketTicks(int level) const;
+    int    groupCount(void) const;
+    int    levelCount(void) const;
+    int    levelFor(int width) const;
+    float  maxValue(int level) const;
+    vlePlanTick origin(void) const;
+    const float *values(int level, int group) const;
+private:
+    struct Level
+    {
+        int         buckets;
+        vlePlanTick ticks;    // Length of one bucket
+        int         offset;   // Position of the level into the values of a group
+        float       max;      // Highest value of the level (all groups)
+    };
+    struct Group
+    {
+        quint64        revision; // Revision of the plan group
+        QVector<float> values;   // All the levels, from the finest one
+        QVector<float> max;      // Highest value of each level
+    };
+    void   buildGroup(const vlePlan *plan, int group, Group *out) const;
+private:
+    vlePlanTick    mOrigin;
+    QVector<Level> mLevels;
+    QVector< std::shared_ptr<const Group> > mGroups;
+};
+
+#endif // VLEPLANDENSITY_H
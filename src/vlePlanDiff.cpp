@@ -0,0 +1,216 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <algorithm>
+#include "vlePlanDiff.h"
+
+vlePlanDiff::vlePlanDiff()
+{
+    for (int i = 0; i <= Shifted; i++)
+        mCount[i] = 0;
+}
+
+void vlePlanDiff::compare(const vlePlan *a, const vlePlan *b)
+{
+    for (int i = 0; i <= Shifted; i++)
+        mCount[i] = 0;
+
+    mStatusA.clear();
+    mStatusB.clear();
+    mStatusA.resize(a->countGroups());
+    mStatusB.resize(b->countGroups());
+
+    // Groups of the first plan, compared with the same group into the second
+    for (int i = 0; i < a->countGroups(); i++)
+    {
+        const vlePlanGroup *ga = a->getGroup(i);
+        int j = b->groupIndex(ga->getName());
+        if (j < 0)
+            mergeGroup(ga, &mStatusA[i], NULL, NULL);
+        else
+            mergeGroup(ga, &mStatusA[i], b->getGroup(j), &mStatusB[j]);
+    }
+    // Groups only found into the second plan
+    for (int j = 0; j < b->countGroups(); j++)
+    {
+        const vlePlanGroup *gb = b->getGroup(j);
+        if (a->groupIndex(gb->getName()) < 0)
+            mergeGroup(NULL, NULL, gb, &mStatusB[j]);
+    }
+}
+
+int vlePlanDiff::count(Status status) const
+{
+    return mCount[status];
+}
+
+bool vlePlanDiff::isEmpty(void) const
+{
+    return mStatusA.isEmpty() && mStatusB.isEmpty();
+}
+
+vlePlanDiff::Status vlePlanDiff::statusA(int group, int pos) const
+{
+    if ((group < 0) || (group >= mStatusA.count()) ||
+        (pos < 0)   || (pos >= mStatusA.at(group).count()))
+        return Same;
+    return (Status)mStatusA.at(group).at(pos);
+}
+
+vlePlanDiff::Status vlePlanDiff::statusB(int group, int pos) const
+{
+    if ((group < 0) || (group >= mStatusB.count()) ||
+        (pos < 0)   || (pos >= mStatusB.at(group).count()))
+        return Same;
+    return (Status)mStatusB.at(group).at(pos);
+}
+
+void vlePlanDiff::mergeGroup(const vlePlanGroup *ga, QVector<quint8> *sa,
+                             const vlePlanGroup *gb, QVector<quint8> *sb)
+{
+    QVector<QString> namesA;
+    QVector<QString> namesB;
+    QVector<int> orderA;
+    QVector<int> orderB;
+    int countA = 0;
+    int countB = 0;
+
+    if (ga)
+    {
+        orderA = sortedOrder(ga, &namesA);
+        countA = ga->count();
+        sa->fill(Removed, countA);
+    }
+    if (gb)
+    {
+        orderB = sortedOrder(gb, &namesB);
+        countB = gb->count();
+        sb->fill(Added, countB);
+    }
+
+    // Sorted merge of both lists
+    int i = 0;
+    int j = 0;
+    while ((i < countA) && (j < countB))
+    {
+        int pa = orderA.at(i);
+        int pb = orderB.at(j);
+        int cmp = QString::compare(namesA.at(pa), namesB.at(pb));
+        if (cmp < 0)
+            i++;
+        else if (cmp > 0)
+            j++;
+        else
+        {
+            // Same name into both plans : compare all the activities with this name
+            int ie = i + 1;
+            while ((ie < countA) && (namesA.at(orderA.at(ie)) == namesA.at(pa)))
+                ie++;
+            int je = j + 1;
+            while ((je < countB) && (namesB.at(orderB.at(je)) == namesB.at(pb)))
+                je++;
+            mergeRun(ga, orderA.mid(i, ie - i), sa, gb, orderB.mid(j, je - j), sb);
+            i = ie;
+            j = je;
+        }
+    }
+
+    // Update counters (a shifted activity is counted once)
+    for (int k = 0; k < countA; k++)
+    {
+        if (sa->at(k) != Shifted)
+            mCount[sa->at(k)]++;
+    }
+    for (int k = 0; k < countB; k++)
+    {
+        if (sb->at(k) == Shifted)
+            mCount[Shifted]++;
+        else if (sb->at(k) == Added)
+            mCount[Added]++;
+    }
+}
+
+void vlePlanDiff::mergeRun(const vlePlanGroup *ga, QVector<int> runA, QVector<quint8> *sa,
+                           const vlePlanGroup *gb, QVector<int> runB, QVector<quint8> *sb)
+{
+    // Activities with the same name, sorted by dates (compared plans use
+    // the same resolution)
+    std::sort(runA.begin(), runA.end(), [ga](int x, int y)
+    {
+        return (compareDates(ga, x, ga, y) < 0);
+    });
+    std::sort(runB.begin(), runB.end(), [gb](int x, int y)
+    {
+        return (compareDates(gb, x, gb, y) < 0);
+    });
+
+    // First, match the activities with the same dates into both plans ...
+    QVector<int> leftA;
+    QVector<int> leftB;
+    int i = 0;
+    int j = 0;
+    while ((i < runA.count()) && (j < runB.count()))
+    {
+        int cmp = compareDates(ga, runA.at(i), gb, runB.at(j));
+        if (cmp < 0)
+            leftA.append(runA.at(i++));
+        else if (cmp > 0)
+            leftB.append(runB.at(j++));
+        else
+        {
+            (*sa)[runA.at(i++)] = Same;
+            (*sb)[runB.at(j++)] = Same;
+        }
+    }
+    for ( ; i < runA.count(); i++)
+        leftA.append(runA.at(i));
+    for ( ; j < runB.count(); j++)
+        leftB.append(runB.at(j));
+
+    // ... then pair the other ones by date order : they have been shifted
+    int count = qMin(leftA.count(), leftB.count());
+    for (int k = 0; k < count; k++)
+    {
+        (*sa)[leftA.at(k)] = Shifted;
+        (*sb)[leftB.at(k)] = Shifted;
+    }
+}
+
+int vlePlanDiff::compareDates(const vlePlanGroup *ga, int pa, const vlePlanGroup *gb, int pb)
+{
+    vlePlanTick startA = ga->tickStarts()[pa];
+    vlePlanTick startB = gb->tickStarts()[pb];
+    if (startA != startB)
+        return (startA < startB) ? -1 : 1;
+
+    vlePlanTick endA = ga->tickEnds()[pa];
+    vlePlanTick endB = gb->tickEnds()[pb];
+    if (endA != endB)
+        return (endA < endB) ? -1 : 1;
+    return 0;
+}
+
+QVector<int> vlePlanDiff::sortedOrder(const vlePlanGroup *group, QVector<QString> *names)
+{
+    // Names are built once (they may be decoded keys)
+    names->resize(group->count());
+    for (int k = 0; k < group->count(); k++)
+        (*names)[k] = group->activities()[k]->getName();
+
+    QVector<int> order(group->count());
+    for (int k = 0; k < order.count(); k++)
+        order[k] = k;
+
+    // Sort by name, then by start date (activities are already sorted by date,
+    // a stable sort keeps this order for activities with the same name)
+    const QVector<QString> &n = *names;
+    std::stable_sort(order.begin(), order.end(), [&n](int x, int y)
+    {
+        return (QString::compare(n.at(x), n.at(y)) < 0);
+    });
+    return order;
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANDIFF_H
+#define VLEPLANDIFF_H
+
+#include <QVector>
+#include "vlePlan.h"
+
+/**
+ * Differences between two plans (for example two runs of a simulation).
+ *
+ * Groups are matched by name. Into each group, activities of both plans are
+ * sorted by name and dates, then merged. For each name, activities with the
+ * same dates into both plans are unchanged, the other ones are paired by
+ * date order and have been shifted. Activities left into the first plan
+ * are removed, the ones left into the second plan are added.
+ */
+class vlePlanDiff
+{
+public:
+    enum Status { Same = 0, Added, Removed, Shifted };
+public:
+    vlePlanDiff();
+    void   compare(const vlePlan *a, const vlePlan *b);
+    int    count (Status status) const;
+    bool   isEmpty(void) const;
+    Status statusA(int group, int pos) const;
+    Status statusB(int group, int pos) const;
+private:
+    void   mergeGroup(const vlePlanGroup *ga, QVector<quint8> *sa,
+                      const vlePlanGroup *gb, QVector<quint8> *sb);
+    void   mergeRun  (const vlePlanGroup *ga, QVector<int> runA, QVector<quint8> *sa,
+                      const vlePlanGroup *gb, QVector<int> runB, QVector<quint8> *sb);
+    static int compareDates(const vlePlanGroup *ga, int pa, const vlePlanGroup *gb, int pb);
+    static QVector<int> sortedOrder(const vlePlanGroup *group, QVector<QString> *names);
+private:
+    // Status of each activity, for each group of both plans
+    QVector< QVector<quint8> > mStatusA;
+    QVector< QVector<quint8> > mStatusB;
+    int mCount[Shifted + 1];
+};
+
+#endif // VLEPLANDIFF_H
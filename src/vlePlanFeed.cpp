@@ -0,0 +1,310 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QDataStream>
+#include <QHash>
+#include <QThread>
+#include <QtDebug>
+#include "vlePlanFeed.h"
+
+// Data buffered by Qt for each socket, a frame must fit into this buffer
+static const int feedBufferSize = (256 * 1024);
+static const quint32 feedMaxFrame = (feedBufferSize - 4);
+
+vlePlanFeed::vlePlanFeed(vlePlan *plan, QObject *parent)
+    : QObject(parent)
+{
+    mPlan         = plan;
+    mServer       = NULL;
+    mPendingReset = false;
+    mMaxPending   = 50000;
+
+    // By default, publish the plan at most 5 times per second
+    setMaxRate(5);
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(publish()));
+}
+
+vlePlanFeed::~vlePlanFeed()
+{
+    close();
+}
+
+bool vlePlanFeed::listen(const QString &name)
+{
+    close();
+
+    mServer = new QLocalServer(this);
+    connect(mServer, SIGNAL(newConnection()), this, SLOT(newConnection()));
+
+    // Remove a socket file left by a previous (crashed) instance
+    QLocalServer::removeServer(name);
+    if ( ! mServer->listen(name))
+    {
+        qWarning() << "vlePlanFeed: failed to listen on" << name << mServer->errorString();
+        delete mServer;
+        mServer = NULL;
+        return false;
+    }
+    mTimer.start();
+    return true;
+}
+
+void vlePlanFeed::close(void)
+{
+    mTimer.stop();
+
+    while ( ! mSockets.isEmpty())
+    {
+        QLocalSocket *s = mSockets.takeFirst();
+        s->disconnect(this);
+        s->abort();
+        s->deleteLater();
+    }
+    if (mServer)
+    {
+        mServer->close();
+        delete mServer;
+        mServer = NULL;
+    }
+    mPending.clear();
+    mPendingReset = false;
+}
+
+void vlePlanFeed::setMaxPending(int count)
+{
+    mMaxPending = count;
+}
+
+void vlePlanFeed::setMaxRate(int updatesPerSecond)
+{
+    mTimer.setInterval(1000 / qMax(1, updatesPerSecond));
+}
+
+vlePlanSnapshot vlePlanFeed::snapshot(void) const
+{
+    return mStore.current();
+}
+
+void vlePlanFeed::newConnection(void)
+{
+    while (mServer->hasPendingConnections())
+    {
+        QLocalSocket *s = mServer->nextPendingConnection();
+        // Limit data buffered by Qt : when the feed stops reading, the
+        // producer is blocked by the socket
+        s->setReadBufferSize(feedBufferSize);
+        connect(s, SIGNAL(readyRead()),    this, SLOT(readSockets()));
+        connect(s, SIGNAL(disconnected()), this, SLOT(socketClosed()));
+        mSockets.append(s);
+    }
+    readSockets();
+}
+
+void vlePlanFeed::publish(void)
+{
+    if (( ! mPendingReset) && mPending.isEmpty())
+        return;
+
+    if (mPendingReset)
+    {
+        mPlan->clear();
+        mPendingReset = false;
+    }
+
+    // Insert the batch of received rows into the plan, groups are first
+    // grown once to their new size
+    QVector<vlePlanGroup *> groups(mPending.count());
+    QHash<vlePlanGroup *, int> counts;
+    for (int i = 0; i < mPending.count(); i++)
+    {
+        groups[i] = mPlan->getGroup(mPending.at(i).group, true);
+        counts[groups.at(i)]++;
+    }
+    QHash<vlePlanGroup *, int>::const_iterator it;
+    for (it = counts.constBegin(); it != counts.constEnd(); ++it)
+        it.key()->reserve(it.key()->count() + it.value());
+
+    const vlePlanTime &time = mPlan->time();
+    for (int i = 0; i < mPending.count(); i++)
+    {
+        const Row &row = mPending.at(i);
+        vlePlanGroup    *g = groups.at(i);
+        vlePlanActivity *a = mPlan->addActivity(g, row.name, time.fromMinutes(row.start),
+                                                time.fromMinutes(row.end));
+        a->setClass(row.className);
+        a->reserveAttributes(row.attributes.count());
+        for (int j = 0; j < row.attributes.count(); j++)
+            a->addAttribute(row.attributes.at(j));
+    }
+    mPending.clear();
+    mPlan->update();
+
+    // Publish the new version for readers
+    mStore.publish(*mPlan);
+    emit planUpdated();
+
+    // There is room for new rows, continue to read sockets
+    readSockets();
+}
+
+void vlePlanFeed::readSockets(void)
+{
+    // Sockets with an invalid frame are removed while reading
+    QList<QLocalSocket *> sockets = mSockets;
+    for (int i = 0; i < sockets.count(); i++)
+    {
+        QLocalSocket *s = sockets.at(i);
+        // Stop reading when the batch is full (back-pressure)
+        while ((mPending.count() < mMaxPending) && readFrame(s))
+            ;
+    }
+}
+
+void vlePlanFeed::socketClosed(void)
+{
+    QLocalSocket *s = qobject_cast<QLocalSocket *>(sender());
+    if (s == NULL)
+        return;
+
+    // Read frames still buffered before releasing the socket
+    while (readFrame(s))
+        ;
+    mSockets.removeAll(s);
+    s->deleteLater();
+}
+
+bool vlePlanFeed::readFrame(QLocalSocket *socket)
+{
+    // Wait for a complete frame : length, then payload
+    if (socket->bytesAvailable() < 4)
+        return false;
+
+    QByteArray head = socket->peek(4);
+    quint32 len = ((quint32)(uchar)head.at(0) << 24) |
+                  ((quint32)(uchar)head.at(1) << 16) |
+                  ((quint32)(uchar)head.at(2) <<  8) |
+                   (quint32)(uchar)head.at(3);
+    // A larger frame could never be received (or the length is corrupted),
+    // this producer is disconnected
+    if (len > feedMaxFrame)
+    {
+        qWarning() << "vlePlanFeed: frame of" << len << "bytes refused, producer disconnected";
+        mSockets.removeAll(socket);
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+        return false;
+    }
+    if (socket->bytesAvailable() < (qint64)(4 + len))
+        return false;
+
+    socket->read(4);
+    QByteArray payload = socket->read(len);
+
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint8 type;
+    in >> type;
+
+    if (type == FrameReset)
+    {
+        // Rows received before the reset are obsolete
+        mPending.clear();
+        mPendingReset = true;
+    }
+    else if (type == FrameActivity)
+    {
+        Row row;
+        in >> row.name >> row.group >> row.className
+           >> row.start >> row.end >> row.attributes;
+        if (in.status() == QDataStream::Ok)
+            mPending.append(row);
+        else
+            qWarning() << "vlePlanFeed: malformed activity frame";
+    }
+    else
+        qWarning() << "vlePlanFeed: unknown frame type" << type;
+
+    return true;
+}
+
+QByteArray vlePlanFeed::encodeActivity(const vlePlanGroup *group, int pos, const vlePlanTime &time)
+{
+    const vlePlanActivity *activity = group->getActivity(pos);
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    QStringList attributes;
+    for (int i = 0; i < activity->attributeCount(); i++)
+        attributes.append(activity->getAttribute(i));
+
+    out << (quint8)FrameActivity
+        << activity->getName() << group->getName() << activity->getClass()
+        << (qint64)time.toMinutes(group->tickStarts()[pos])
+        << (qint64)time.toMinutes(group->tickEnds()[pos])
+        << attributes;
+
+    return frame(payload);
+}
+
+QByteArray vlePlanFeed::encodeReset(void)
+{
+    QByteArray payload;
+    payload.append((char)FrameReset);
+    return frame(payload);
+}
+
+QByteArray vlePlanFeed::frame(const QByteArray &payload)
+{
+    QByteArray data;
+    quint32 len = payload.size();
+    data.append((char)((len >> 24) & 0xFF));
+    data.append((char)((len >> 16) & 0xFF));
+    data.append((char)((len >>  8) & 0xFF));
+    data.append((char)( len        & 0xFF));
+    data.append(payload);
+    return data;
+}
+
+bool vlePlanFeed::sendPlan(const vlePlan *plan, const QString &name, int rowsPerSecond)
+{
+    QLocalSocket socket;
+
+    // Stand-in producer : replay a loaded plan as a simulation would do
+    socket.connectToServer(name);
+    if ( ! socket.waitForConnected(5000))
+    {
+        qWarning() << "vlePlanFeed: failed to connect to" << name << socket.errorString();
+        return false;
+    }
+
+    socket.write(encodeReset());
+
+    int sent = 0;
+    for (int i = 0; i < plan->countGroups(); i++)
+    {
+        vlePlanGroup *g = plan->getGroup(i);
+        for (int j = 0; j < g->count(); j++)
+        {
+            socket.write(encodeActivity(g, j, plan->time()));
+            sent++;
+
+            // Wait until the feed reads data (blocks when it applies back-pressure)
+            if (socket.bytesToWrite() > (64 * 1024))
+                socket.waitForBytesWritten(-1);
+            if ((rowsPerSecond > 0) && ((sent % qMax(1, rowsPerSecond / 10)) == 0))
+                QThread::msleep(100);
+        }
+    }
+    socket.flush();
+    while (socket.bytesToWrite() > 0)
+        socket.waitForBytesWritten(-1);
+    socket.disconnectFromServer();
+
+    return true;
+}
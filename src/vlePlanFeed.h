@@ -0,0 +1,85 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANFEED_H
+#define VLEPLANFEED_H
+
+#include <QByteArray>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include "vlePlan.h"
+
+/**
+ * Live feed of activities, pushed by a running simulation.
+ *
+ * The feed listens on a local socket. Each message is a frame made of a
+ * 32 bits (big endian) length followed by a QDataStream payload (of less
+ * than 256 KB, a producer that sends a larger frame is disconnected):
+ *   - quint8 type (1 = activity, 2 = reset)
+ *   - for activities : QString name, group and class, qint64 start and
+ *     end (minutes since julian day 0, whatever the resolution of the
+ *     plans), then a QStringList of attributes
+ *
+ * Received activities are batched, and inserted into the plan at a capped
+ * rate. When too many activities are waiting, sockets are no longer read
+ * until the next publication : the producer is then slowed down by the
+ * socket buffers (back-pressure).
+ *
+ * After each publication, a snapshot of the plan is available for readers
+ * (the plan itself is only modified by the feed).
+ */
+class vlePlanFeed : public QObject
+{
+    Q_OBJECT
+public:
+    enum FrameType { FrameActivity = 1, FrameReset = 2 };
+public:
+    vlePlanFeed(vlePlan *plan, QObject *parent = 0);
+    ~vlePlanFeed();
+    bool listen(const QString &name);
+    void close(void);
+    void setMaxPending(int count);
+    void setMaxRate(int updatesPerSecond);
+    vlePlanSnapshot snapshot(void) const;
+    static QByteArray encodeActivity(const vlePlanGroup *group, int pos, const vlePlanTime &time);
+    static QByteArray encodeReset(void);
+    static bool sendPlan(const vlePlan *plan, const QString &name, int rowsPerSecond = 0);
+signals:
+    void planUpdated(void);
+private slots:
+    void newConnection(void);
+    void publish(void);
+    void readSockets(void);
+    void socketClosed(void);
+private:
+    struct Row
+    {
+        QString name;
+        QString group;
+        QString className;
+        qint64  start;  // Minutes
+        qint64  end;
+        QStringList attributes;
+    };
+    bool readFrame(QLocalSocket *socket);
+    static QByteArray frame(const QByteArray &payload);
+private:
+    vlePlan      *mPlan;
+    vlePlanStore  mStore;
+    QLocalServer *mServer;
+    QList<QLocalSocket *> mSockets;
+    QTimer        mTimer;
+    QList<Row>    mPending;
+    bool          mPendingReset;
+    int           mMaxPending;
+};
+
+#endif // VLEPLANFEED_H
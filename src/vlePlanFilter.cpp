@@ -0,0 +1,295 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include "vlePlanFilter.h"
+
+vlePlanFilter::vlePlanFilter()
+{
+    mClassFilter = false;
+    mRevision    = 0;
+    mSearchMatcher.setCaseSensitivity(Qt::CaseInsensitive);
+}
+
+void vlePlanFilter::clear(void)
+{
+    mClassFilter = false;
+    mClasses.clear();
+    mGroupPattern = QRegExp();
+    mSearch.clear();
+    mSearchMatcher.setPattern(QString());
+    mRevision++;
+
+    // Re-evaluate all bitmaps without criteria
+    for (int k = 0; k < mStates.count(); k++)
+    {
+        mStates[k].revisions.clear();
+        updatePlan(mStates[k], mStates.at(k).plan);
+    }
+}
+
+const vlePlan *vlePlanFilter::plan(int index) const
+{
+    if ((index < 0) || (index >= mStates.count()))
+        return NULL;
+    return mStates.at(index).plan.get();
+}
+
+void vlePlanFilter::setPlans(const QList<vlePlanSnapshot> &plans)
+{
+    mStates.resize(plans.count());
+    for (int k = 0; k < plans.count(); k++)
+        updatePlan(mStates[k], plans.at(k));
+}
+
+void vlePlanFilter::setClasses(const QSet<QString> &classes)
+{
+    // Only the activities of these classes are shown (none if empty)
+    if (mClassFilter && (classes == mClasses))
+        return;
+    mClassFilter = true;
+    mClasses = classes;
+    mRevision++;
+
+    for (int k = 0; k < mStates.count(); k++)
+    {
+        State &s = mStates[k];
+        for (int i = 0; i < s.classBits.count(); i++)
+        {
+            updateClass (s, i);
+            updateResult(s, i);
+        }
+    }
+}
+
+void vlePlanFilter::clearClasses(void)
+{
+    if ( ! mClassFilter)
+        return;
+    mClassFilter = false;
+    mClasses.clear();
+    mRevision++;
+
+    for (int k = 0; k < mStates.count(); k++)
+    {
+        State &s = mStates[k];
+        for (int i = 0; i < s.classBits.count(); i++)
+        {
+            updateClass (s, i);
+            updateResult(s, i);
+        }
+    }
+}
+
+void vlePlanFilter::setGroupPattern(const QString &pattern)
+{
+    if (pattern == mGroupPattern.pattern())
+        return;
+
+    if (pattern.isEmpty())
+        mGroupPattern = QRegExp();
+    else
+        mGroupPattern = QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+    mRevision++;
+
+    // Only the group mask depends on the pattern
+    for (int k = 0; k < mStates.count(); k++)
+    {
+        State &s = mStates[k];
+        updateGroups(s);
+        for (int i = 0; i < s.bitmaps.count(); i++)
+            updateVisible(s, i);
+    }
+}
+
+void vlePlanFilter::setSearch(const QString &term)
+{
+    if (term == mSearch)
+        return;
+
+    // If the new term contains the old one, only current matches can still match
+    bool refine = ( ! mSearch.isEmpty()) && term.contains(mSearch, Qt::CaseInsensitive);
+
+    mSearch = term;
+    mSearchMatcher.setPattern(term);
+    mRevision++;
+
+    for (int k = 0; k < mStates.count(); k++)
+    {
+        State &s = mStates[k];
+        for (int i = 0; i < s.searchBits.count(); i++)
+        {
+            updateSearch(s, i, refine);
+            updateResult(s, i);
+        }
+    }
+}
+
+bool vlePlanFilter::isActive(void) const
+{
+    return ( mClassFilter            ||
+             ( ! mSearch.isEmpty())  ||
+             ( ! mGroupPattern.isEmpty()) );
+}
+
+quint64 vlePlanFilter::revision(void) const
+{
+    return mRevision;
+}
+
+bool vlePlanFilter::accept(int plan, int group, int pos) const
+{
+    // Unknown positions (plan modified since last update) are not filtered
+    if ((plan < 0) || (plan >= mStates.count()))
+        return true;
+    const QVector<QBitArray> &bitmaps = mStates.at(plan).bitmaps;
+    if ((group < 0) || (group >= bitmaps.count()))
+        return true;
+    const QBitArray &bits = bitmaps.at(group);
+    if ((pos < 0) || (pos >= bits.size()))
+        return true;
+
+    return bits.testBit(pos);
+}
+
+bool vlePlanFilter::acceptGroup(int plan, int group) const
+{
+    if ((plan < 0) || (plan >= mStates.count()))
+        return true;
+    const QBitArray &visible = mStates.at(plan).groupVisible;
+    if ((group < 0) || (group >= visible.size()))
+        return true;
+
+    return visible.testBit(group);
+}
+
+const QBitArray &vlePlanFilter::bitmap(int plan, int group) const
+{
+    return mStates.at(plan).bitmaps.at(group);
+}
+
+bool vlePlanFilter::matchSearch(const vlePlanActivity *a) const
+{
+    for (int k = 0; k < a->attributeCount(); k++)
+    {
+        if (mSearchMatcher.indexIn(a->getAttribute(k)) >= 0)
+            return true;
+    }
+    return false;
+}
+
+void vlePlanFilter::updatePlan(State &s, const vlePlanSnapshot &plan)
+{
+    s.plan = plan;
+
+    int count = s.plan ? s.plan->countGroups() : 0;
+
+    s.classBits.resize   (count);
+    s.searchBits.resize  (count);
+    s.bitmaps.resize     (count);
+    s.groupVisible.resize(count);
+    s.revisions.resize   (count);
+
+    // Evaluate the criteria for the groups modified since the last plan
+    updateGroups(s);
+    for (int i = 0; i < count; i++)
+    {
+        quint64 revision = s.plan->getGroup(i)->revision();
+        if (revision == s.revisions.at(i))
+        {
+            updateVisible(s, i);
+            continue;
+        }
+        s.revisions[i] = revision;
+        updateClass (s, i);
+        updateSearch(s, i, false);
+        updateResult(s, i);
+    }
+}
+
+void vlePlanFilter::updateClass(State &s, int group)
+{
+    vlePlanGroup *g = s.plan->getGroup(group);
+    QBitArray &bits = s.classBits[group];
+
+    // Without class criterion, all activities match
+    bits.fill( ! mClassFilter, g->count());
+    if (( ! mClassFilter) || mClasses.isEmpty())
+        return;
+
+    vlePlanActivity * const *activities = g->activities();
+    for (int j = 0; j < g->count(); j++)
+    {
+        if (mClasses.contains(activities[j]->getClass()))
+            bits.setBit(j);
+    }
+}
+
+void vlePlanFilter::updateGroups(State &s)
+{
+    int count = s.plan ? s.plan->countGroups() : 0;
+
+    s.groupMask.fill(true, count);
+    if (mGroupPattern.isEmpty())
+        return;
+
+    for (int i = 0; i < count; i++)
+    {
+        if ( ! mGroupPattern.exactMatch(s.plan->getGroup(i)->getName()))
+            s.groupMask.clearBit(i);
+    }
+}
+
+void vlePlanFilter::updateSearch(State &s, int group, bool refine)
+{
+    vlePlanGroup *g = s.plan->getGroup(group);
+    QBitArray &bits = s.searchBits[group];
+
+    if (bits.size() != g->count())
+        refine = false;
+
+    // Without search term, all activities match
+    if (mSearch.isEmpty())
+    {
+        bits.fill(true, g->count());
+        return;
+    }
+
+    vlePlanActivity * const *activities = g->activities();
+
+    // Refine the previous result : only test activities that still match
+    if (refine)
+    {
+        for (int j = 0; j < bits.size(); j++)
+        {
+            if (bits.testBit(j) && ! matchSearch(activities[j]))
+                bits.clearBit(j);
+        }
+        return;
+    }
+
+    bits.fill(false, g->count());
+    for (int j = 0; j < g->count(); j++)
+    {
+        if (matchSearch(activities[j]))
+            bits.setBit(j);
+    }
+}
+
+void vlePlanFilter::updateResult(State &s, int group)
+{
+    s.bitmaps[group] = (s.classBits.at(group) & s.searchBits.at(group));
+    updateVisible(s, group);
+}
+
+void vlePlanFilter::updateVisible(State &s, int group)
+{
+    // A group is hidden if no activity match the activity criteria
+    bool visible = s.groupMask.testBit(group);
+    if (visible && (mClassFilter || ! mSearch.isEmpty()))
+        visible = (s.bitmaps.at(group).count(true) > 0);
+    s.groupVisible.setBit(group, visible);
+}
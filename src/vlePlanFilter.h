@@ -0,0 +1,79 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANFILTER_H
+#define VLEPLANFILTER_H
+
+#include <QBitArray>
+#include <QList>
+#include <QRegExp>
+#include <QSet>
+#include <QString>
+#include <QStringMatcher>
+#include <QVector>
+#include "vlePlan.h"
+
+/**
+ * Filter of plan activities.
+ *
+ * Each criterion (class set, group name pattern, attribute search) is
+ * compiled when set, and evaluated into its own bitmap. When a criterion
+ * change, only its bitmap is updated, then merged with the others to
+ * give one bitmap of visible activities per group.
+ *
+ * The same criteria are applied to all the shown plans (when two plans
+ * are compared), bitmaps are kept per plan.
+ */
+class vlePlanFilter
+{
+public:
+    vlePlanFilter();
+    void  clear(void);
+    const vlePlan *plan(int index = 0) const;
+    void  setPlans(const QList<vlePlanSnapshot> &plans);
+    void  setClasses     (const QSet<QString> &classes);
+    void  clearClasses   (void);
+    void  setGroupPattern(const QString &pattern);
+    void  setSearch      (const QString &term);
+    bool  isActive(void) const;
+    quint64 revision(void) const;
+    bool  accept     (int plan, int group, int pos) const;
+    bool  acceptGroup(int plan, int group) const;
+    const QBitArray &bitmap(int plan, int group) const;
+private:
+    struct State
+    {
+        vlePlanSnapshot    plan;
+        QVector<quint64>   revisions;  // Group revisions of the bitmaps
+        // Result of each criterion
+        QBitArray          groupMask;
+        QVector<QBitArray> classBits;
+        QVector<QBitArray> searchBits;
+        // Merged result
+        QBitArray          groupVisible;
+        QVector<QBitArray> bitmaps;
+    };
+    bool  matchSearch (const vlePlanActivity *a) const;
+    void  updatePlan  (State &s, const vlePlanSnapshot &plan);
+    void  updateClass (State &s, int group);
+    void  updateGroups(State &s);
+    void  updateSearch(State &s, int group, bool refine);
+    void  updateResult(State &s, int group);
+    void  updateVisible(State &s, int group);
+private:
+    // Compiled criteria
+    bool           mClassFilter;   // False : all classes
+    QSet<QString>  mClasses;       // Classes shown (may be empty : none)
+    QRegExp        mGroupPattern;  // Empty pattern means "all groups"
+    QString        mSearch;
+    QStringMatcher mSearchMatcher;
+    quint64        mRevision;      // Incremented when the criteria change
+    // Bitmaps of each plan
+    QVector<State> mStates;
+};
+
+#endif // VLEPLANFILTER_H
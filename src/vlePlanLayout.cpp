@@ -0,0 +1,123 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#include "vlePlanLayout.h"
+
+#if defined(__SSE2__)
+// SSE2 has no 32bits integer min/max, use a compare and a blend
+static inline __m128i layoutMax(__m128i a, __m128i b)
+{
+    __m128i m = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+static inline __m128i layoutMin(__m128i a, __m128i b)
+{
+    __m128i m = _mm_cmplt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+// Load four 64 bits ticks, and keep the low 32 bits of (tick - origin)
+static inline __m128i layoutLoad(const qint64 *p, __m128i origin)
+{
+    __m128i a = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(p)),     origin);
+    __m128i b = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(p + 2)), origin);
+    return _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Multiply four integers by a scale factor, then truncate (like a C cast)
+static inline __m128i layoutScale(__m128i v, double scale)
+{
+#if defined(__AVX__)
+    __m256d d = _mm256_mul_pd(_mm256_cvtepi32_pd(v), _mm256_set1_pd(scale));
+    return _mm256_cvttpd_epi32(d);
+#else
+    __m128d sc = _mm_set1_pd(scale);
+    __m128i lo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(v), sc));
+    __m128i hi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), sc));
+    return _mm_unpacklo_epi64(lo, hi);
+#endif
+}
+#endif
+
+void vlePlanLayout::map(const qint64 *start, const qint64 *end, int count,
+                        qint64 origin, qreal scale,
+                        qint32 clipStart, qint32 clipEnd,
+                        qint32 *x, qint32 *width)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i vOrigin    = _mm_set1_epi64x(origin);
+    const __m128i vOne       = _mm_set1_epi32(1);
+    const __m128i vClipStart = _mm_set1_epi32(clipStart);
+    const __m128i vClipEnd   = _mm_set1_epi32(clipEnd);
+
+    for ( ; (i + 4) <= count; i += 4)
+    {
+        // Ticks relative to the origin
+        __m128i s = layoutLoad(start + i, vOrigin);
+        __m128i e = layoutLoad(end   + i, vOrigin);
+
+        // Convert ticks to pixels, with a minimum length of one pixel
+        __m128i px  = layoutScale(s, scale);
+        __m128i len = layoutScale(_mm_sub_epi32(e, s), scale);
+        len = layoutMax(len, vOne);
+        __m128i right = _mm_add_epi32(px, len);
+
+        // An activity is visible if it intersects the clip range
+        __m128i visible = _mm_and_si128(_mm_cmpgt_epi32(right, vClipStart),
+                                        _mm_cmplt_epi32(px,    vClipEnd));
+        __m128i cx = layoutMax(px, vClipStart);
+        __m128i cw = _mm_sub_epi32(layoutMin(right, vClipEnd), cx);
+
+        cx = _mm_or_si128(_mm_and_si128(visible, cx), _mm_andnot_si128(visible, px));
+        cw = _mm_and_si128(visible, cw);
+
+        _mm_storeu_si128((__m128i *)(x     + i), cx);
+        _mm_storeu_si128((__m128i *)(width + i), cw);
+    }
+#endif
+
+    // Process remaining entries (or all of them without SIMD support)
+    mapScalar(start + i, end + i, count - i, origin, scale,
+              clipStart, clipEnd, x + i, width + i);
+}
+
+void vlePlanLayout::mapScalar(const qint64 *start, const qint64 *end, int count,
+                              qint64 origin, qreal scale,
+                              qint32 clipStart, qint32 clipEnd,
+                              qint32 *x, qint32 *width)
+{
+    for (int i = 0; i < count; i++)
+    {
+        qint32 s   = (qint32)(start[i] - origin);
+        qint32 e   = (qint32)(end[i]   - origin);
+        qint32 px  = (qint32)(s * scale);
+        qint32 len = (qint32)((e - s) * scale);
+        if (len < 1)
+            len = 1;
+        qint32 right = px + len;
+
+        // If the activity is outside the clip range, hide it
+        if ((right <= clipStart) || (px >= clipEnd))
+        {
+            x[i]     = px;
+            width[i] = 0;
+            continue;
+        }
+        x[i]     = qMax(px,    clipStart);
+        width[i] = qMin(right, clipEnd) - x[i];
+    }
+}
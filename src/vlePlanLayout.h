@@ -0,0 +1,31 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANLAYOUT_H
+#define VLEPLANLAYOUT_H
+
+#include <QtGlobal>
+
+class vlePlanLayout
+{
+public:
+    // Convert a block of [start, end] ticks into pixel x/width (scale is
+    // in pixels per tick). Widths are clamped to 1 pixel minimum, then
+    // clipped to the [clipStart, clipEnd[ range. Fully clipped entries get
+    // a zero width. Ticks minus origin must fit into 32 bits.
+    static void map(const qint64 *start, const qint64 *end, int count,
+                    qint64 origin, qreal scale,
+                    qint32 clipStart, qint32 clipEnd,
+                    qint32 *x, qint32 *width);
+private:
+    static void mapScalar(const qint64 *start, const qint64 *end, int count,
+                          qint64 origin, qreal scale,
+                          qint32 clipStart, qint32 clipEnd,
+                          qint32 *x, qint32 *width);
+};
+
+#endif // VLEPLANLAYOUT_H
@@ -0,0 +1,158 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include "vlePlanNames.h"
+
+vlePlanNames::vlePlanNames()
+{
+    for (int i = 0; i < maxBlocks; i++)
+        mBlocks[i] = NULL;
+    mCount.storeRelease(0);
+}
+
+vlePlanNames::~vlePlanNames()
+{
+    for (int i = 0; i < maxBlocks; i++)
+        delete[] mBlocks[i];
+}
+
+int vlePlanNames::count(void) const
+{
+    return mCount.loadAcquire();
+}
+
+bool vlePlanNames::decode(const QString &name, vlePlanActivityKey *key)
+{
+    int at = name.indexOf(QChar('@'));
+    if (at <= 0)
+        return false;
+
+    // Search the end of the parcel (start of cycle or repeat)
+    int colon = name.indexOf(QChar(':'), at + 1);
+    int hash  = name.indexOf(QChar('#'), at + 1);
+    if ((colon >= 0) && (hash >= 0) && (hash < colon))
+        return false;
+    int parcelEnd = (colon >= 0) ? colon : ((hash >= 0) ? hash : name.size());
+
+    key->cycle        = -1;
+    key->repeat       = -1;
+    key->cycleDigits  = 0;
+    key->repeatDigits = 0;
+
+    if (colon >= 0)
+    {
+        int cycleEnd = (hash >= 0) ? hash : name.size();
+        if ( ! parseNumber(name, colon + 1, cycleEnd, &key->cycle, &key->cycleDigits))
+            return false;
+    }
+    if (hash >= 0)
+    {
+        if ( ! parseNumber(name, hash + 1, name.size(), &key->repeat, &key->repeatDigits))
+            return false;
+    }
+
+    // Table is full, keep the name as a string
+    if ((count() + 2) > (blockSize * maxBlocks))
+        return false;
+
+    // The key must give back the same name, else keep the name as a string
+    QString operation = name.left(at);
+    QString parcel    = name.mid(at + 1, parcelEnd - at - 1);
+    if (format(operation, parcel, *key) != name)
+        return false;
+
+    key->operation = intern(operation);
+    key->parcel    = intern(parcel);
+
+    return true;
+}
+
+QString vlePlanNames::encode(const vlePlanActivityKey &key) const
+{
+    return format(string(key.operation), string(key.parcel), key);
+}
+
+QString vlePlanNames::format(const QString &operation, const QString &parcel, const vlePlanActivityKey &key)
+{
+    QString name = operation + QChar('@') + parcel;
+
+    if (key.cycleDigits)
+        name += QChar(':') + QString("%1").arg(key.cycle,  key.cycleDigits,  10, QChar('0'));
+    if (key.repeatDigits)
+        name += QChar('#') + QString("%1").arg(key.repeat, key.repeatDigits, 10, QChar('0'));
+
+    return name;
+}
+
+quint32 vlePlanNames::intern(const QString &str)
+{
+    QHash<QString, quint32>::const_iterator it = mIndex.constFind(str);
+    if (it != mIndex.constEnd())
+        return it.value();
+
+    // Allocate a new block when needed (existing blocks never move)
+    int pos   = mCount.loadAcquire();
+    int block = (pos / blockSize);
+    if (mBlocks[block] == NULL)
+        mBlocks[block] = new QString[blockSize];
+
+    quint32 id = pos;
+    mBlocks[block][pos % blockSize] = str;
+    mIndex.insert(str, id);
+    mCount.storeRelease(pos + 1);
+
+    return id;
+}
+
+bool vlePlanNames::parseNumber(const QString &name, int start, int end, qint16 *value, quint8 *digits)
+{
+    int len = (end - start);
+    // Only small numbers are supported (else, name is kept as a string)
+    if ((len < 1) || (len > 4))
+        return false;
+
+    int v = 0;
+    for (int i = start; i < end; i++)
+    {
+        ushort c = name.at(i).unicode();
+        if ((c < '0') || (c > '9'))
+            return false;
+        v = (v * 10) + (c - '0');
+    }
+    *value  = (qint16)v;
+    *digits = (quint8)len;
+    return true;
+}
+
+void vlePlanNames::reset(void)
+{
+    // Strings are kept allocated, only the content is released
+    int count = mCount.loadAcquire();
+    for (int i = 0; i < count; i++)
+        mBlocks[i / blockSize][i % blockSize].clear();
+    mCount.storeRelease(0);
+    mIndex.clear();
+}
+
+QString vlePlanNames::share(const QString &str)
+{
+    // When the table is full, the string is used as is
+    if (( ! mIndex.contains(str)) && (count() >= (blockSize * maxBlocks)))
+        return str;
+
+    return string(intern(str));
+}
+
+const QString &vlePlanNames::string(quint32 id) const
+{
+    static const QString empty;
+
+    if (id >= (quint32)count())
+        return empty;
+
+    return mBlocks[id / blockSize][id % blockSize];
+}
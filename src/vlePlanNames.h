@@ -0,0 +1,64 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANNAMES_H
+#define VLEPLANNAMES_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QString>
+
+/**
+ * Structured form of a VLE activity name "Operation@parcel:cycle#repeat"
+ * (for example "Irrigation@p4:01#02"). Cycle and repeat are optional (-1
+ * when absent), the number of digits is kept to rebuild the same name.
+ */
+struct vlePlanActivityKey
+{
+    quint32 operation;   // Id of the operation name into the table
+    quint32 parcel;      // Id of the parcel name into the table
+    qint16  cycle;
+    qint16  repeat;
+    quint8  cycleDigits;
+    quint8  repeatDigits;
+};
+
+/**
+ * Table of interned strings used by decoded activity names.
+ *
+ * The table only grows (until reset) and strings are stored by blocks
+ * that never move : readers holding a plan snapshot may get strings by
+ * id while the writer interns new ones. Only the writer uses the index.
+ *
+ * The table may also be shared by several plans (see vlePlan::shareStrings)
+ * so equal strings of similar plans use the same (implicitly shared) data.
+ */
+class vlePlanNames
+{
+public:
+    vlePlanNames();
+    ~vlePlanNames();
+    int   count(void) const;
+    bool  decode(const QString &name, vlePlanActivityKey *key);
+    QString encode(const vlePlanActivityKey &key) const;
+    quint32 intern(const QString &str);
+    void  reset(void);
+    QString share(const QString &str);
+    const QString &string(quint32 id) const;
+private:
+    Q_DISABLE_COPY(vlePlanNames)
+    static QString format(const QString &operation, const QString &parcel, const vlePlanActivityKey &key);
+    static bool parseNumber(const QString &name, int start, int end, qint16 *value, quint8 *digits);
+private:
+    static const int blockSize = 1024;
+    static const int maxBlocks = 1024;
+    QString *mBlocks[maxBlocks];
+    QAtomicInt mCount;  // Published with release semantic, after the string
+    QHash<QString, quint32> mIndex;
+};
+
+#endif // VLEPLANNAMES_H
@@ -0,0 +1,125 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QHash>
+#include <algorithm>
+#include <limits>
+#include "vlePlanOrder.h"
+
+vlePlanOrder::vlePlanOrder()
+{
+    mPlan = NULL;
+    mKey  = Plan;
+    mCache.resize(KeyCount);
+}
+
+const vlePlan *vlePlanOrder::plan(void) const
+{
+    return mPlan;
+}
+
+void vlePlanOrder::setPlan(const vlePlan *plan)
+{
+    if (plan == mPlan)
+        return;
+    mPlan = plan;
+
+    // Permutations of the previous plan are useless now
+    for (int i = 0; i < mCache.count(); i++)
+        mCache[i].clear();
+}
+
+vlePlanOrder::Key vlePlanOrder::key(void) const
+{
+    return mKey;
+}
+
+void vlePlanOrder::setKey(Key key)
+{
+    mKey = key;
+}
+
+void vlePlanOrder::setCustomOrder(const QStringList &names)
+{
+    if (names == mCustom)
+        return;
+    mCustom = names;
+    mCache[Custom].clear();
+}
+
+const QVector<int> &vlePlanOrder::permutation(void)
+{
+    QVector<int> &perm = mCache[mKey];
+    int count = mPlan ? mPlan->countGroups() : 0;
+    if (perm.count() != count)
+        build(mKey, &perm);
+    return perm;
+}
+
+void vlePlanOrder::build(Key key, QVector<int> *out) const
+{
+    int count = mPlan ? mPlan->countGroups() : 0;
+    out->resize(count);
+    for (int i = 0; i < count; i++)
+        (*out)[i] = i;
+    if ((count == 0) || (key == Plan))
+        return;
+
+    // Sort values are read once, then only indexes are sorted
+    QVector<qint64>  values(count, 0);
+    QVector<QString> names;
+    if (key == Name)
+    {
+        names.resize(count);
+        for (int i = 0; i < count; i++)
+            names[i] = mPlan->getGroup(i)->getName();
+    }
+    else if (key == Start)
+    {
+        // Empty groups are sent to the end
+        for (int i = 0; i < count; i++)
+        {
+            const vlePlanGroup *g = mPlan->getGroup(i);
+            values[i] = (g->count() > 0) ? g->tickStart() : std::numeric_limits<qint64>::max();
+        }
+    }
+    else if (key == Activity)
+    {
+        // Total duration of activities, longest first
+        for (int i = 0; i < count; i++)
+        {
+            const vlePlanGroup *g = mPlan->getGroup(i);
+            const vlePlanTick *starts = g->tickStarts();
+            const vlePlanTick *ends   = g->tickEnds();
+            qint64 total = 0;
+            for (int j = 0; j < g->count(); j++)
+                total += (ends[j] - starts[j]);
+            values[i] = -total;
+        }
+    }
+    else if (key == Custom)
+    {
+        // Groups of the custom list first (in list order), then the others
+        QHash<QString, int> rank;
+        for (int i = 0; i < mCustom.count(); i++)
+            rank.insert(mCustom.at(i), i);
+        for (int i = 0; i < count; i++)
+            values[i] = rank.value(mPlan->getGroup(i)->getName(), mCustom.count());
+    }
+
+    // Stable sort : equal groups keep the plan order
+    if (key == Name)
+        std::stable_sort(out->begin(), out->end(), [&names](int a, int b)
+        {
+            return (names.at(a).compare(names.at(b), Qt::CaseInsensitive) < 0);
+        });
+    else
+        std::stable_sort(out->begin(), out->end(), [&values](int a, int b)
+        {
+            return (values.at(a) < values.at(b));
+        });
+}
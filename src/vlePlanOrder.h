@@ -0,0 +1,44 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANORDER_H
+#define VLEPLANORDER_H
+
+#include <QStringList>
+#include <QVector>
+#include "vlePlan.h"
+
+/**
+ * Order of the groups of a plan.
+ *
+ * Groups are never moved : each sort key gives a permutation (positions
+ * of groups into the plan, in display order). Permutations are computed
+ * the first time a key is used and kept until the plan changes, so
+ * switching between keys costs nothing.
+ */
+class vlePlanOrder
+{
+public:
+    enum Key { Plan, Name, Start, Activity, Custom, KeyCount };
+public:
+    vlePlanOrder();
+    const vlePlan *plan(void) const;
+    void  setPlan(const vlePlan *plan);
+    Key   key(void) const;
+    void  setKey(Key key);
+    void  setCustomOrder(const QStringList &names);
+    const QVector<int> &permutation(void);
+private:
+    void  build(Key key, QVector<int> *out) const;
+private:
+    const vlePlan *mPlan;
+    Key            mKey;
+    QStringList    mCustom;  // Names of the groups shown first (custom key)
+    QVector< QVector<int> > mCache;  // One permutation per key (empty = not computed)
+};
+
+#endif // VLEPLANORDER_H
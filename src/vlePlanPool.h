@@ -0,0 +1,86 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANPOOL_H
+#define VLEPLANPOOL_H
+
+#include <QList>
+#include <QString>
+#include <new>
+
+/**
+ * Pool of plan objects, allocated by blocks.
+ *
+ * Objects are constructed the first time a slot is used, then kept alive
+ * when the pool is reset. A reset only rewinds the allocation cursor, and
+ * slots are recycled (using T::reset) by the next allocations. Memory is
+ * only given back to the system by release() or the pool destructor.
+ */
+template <typename T> class vlePlanPool
+{
+public:
+    vlePlanPool(int blockSize = 1024)
+    {
+        mBlockSize   = blockSize;
+        mUsed        = 0;
+        mConstructed = 0;
+    }
+    ~vlePlanPool()
+    {
+        release();
+    }
+    T *alloc(const QString &name)
+    {
+        T *obj;
+
+        // If the next slot contains an old object, recycle it
+        if (mUsed < mConstructed)
+        {
+            obj = slot(mUsed);
+            obj->reset(name);
+        }
+        else
+        {
+            // If all blocks are full, allocate a new one
+            if (mConstructed == (mBlocks.count() * mBlockSize))
+                mBlocks.append(static_cast<T *>(::operator new(sizeof(T) * mBlockSize)));
+            obj = new (slot(mConstructed)) T(name);
+            mConstructed++;
+        }
+        mUsed++;
+
+        return obj;
+    }
+    int  capacity(void) { return (mBlocks.count() * mBlockSize); }
+    int  count   (void) { return mUsed; }
+    void reset   (void) { mUsed = 0; }
+    void release (void)
+    {
+        // Destroy all objects ever constructed into the pool ...
+        for (int i = 0; i < mConstructed; i++)
+            slot(i)->~T();
+        // ... then free the blocks
+        for (int i = 0; i < mBlocks.count(); i++)
+            ::operator delete(mBlocks.at(i));
+        mBlocks.clear();
+        mUsed        = 0;
+        mConstructed = 0;
+    }
+private:
+    Q_DISABLE_COPY(vlePlanPool)
+    T *slot(int pos)
+    {
+        return (mBlocks.at(pos / mBlockSize) + (pos % mBlockSize));
+    }
+private:
+    int mBlockSize;
+    int mUsed;         // Number of slots allocated since last reset
+    int mConstructed;  // Number of slots that contain a live object
+    QList<T *> mBlocks;
+};
+
+#endif // VLEPLANPOOL_H
@@ -0,0 +1,180 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QtDebug>
+#include "vlePlanSchema.h"
+
+vlePlanSchema::vlePlanSchema()
+{
+    mSeparator     = ';';
+    mAllAttributes = true;
+    mLastColumn    = -1;
+    mRequired      = 0;
+}
+
+void vlePlanSchema::selectAllAttributes(void)
+{
+    mAllAttributes = true;
+    mSelected.clear();
+}
+
+void vlePlanSchema::selectAttributes(const QStringList &names)
+{
+    mAllAttributes = false;
+    mSelected = names;
+}
+
+bool vlePlanSchema::parseHeader(const QByteArray &line, char separator)
+{
+    mSeparator = separator;
+    mColumnNames.clear();
+    mAttributeNames.clear();
+    mRoles.clear();
+    mAttributes.clear();
+    mLastColumn = -1;
+    mRequired   = 0;
+
+    // Split the header, without the end of line
+    QStringList names = QString::fromUtf8(line).trimmed().split(QChar(separator));
+    if (names.count() < 4)
+        return false;
+
+    for (int i = 0; i < names.count(); i++)
+        mColumnNames.append(names.at(i).trimmed());
+
+    mRoles.fill(Ignored, names.count());
+    mAttributes.fill(-1, names.count());
+
+    // First, search the columns by name
+    bool found[Attribute] = { false };
+    for (int i = 0; i < mColumnNames.count(); i++)
+    {
+        Role r = roleFromName(mColumnNames.at(i));
+        // Only the first column with a given role is used
+        if ((r != Attribute) && found[r])
+            r = Attribute;
+        if (r != Attribute)
+            found[r] = true;
+        setRole(i, r);
+    }
+
+    // If mandatory columns are missing, use the legacy layout (by position)
+    if ( ! (found[Name] && found[Group] && found[Start] && found[End]))
+    {
+        mAttributeNames.clear();
+        mRoles.fill(Ignored);
+        mAttributes.fill(-1);
+        mLastColumn = -1;
+
+        bool hasClass = (names.count() > 4);
+        setRole(0, Name);
+        setRole(1, Group);
+        if (hasClass)
+        {
+            setRole(2, Class);
+            setRole(3, Start);
+            setRole(4, End);
+        }
+        else
+        {
+            setRole(2, Start);
+            setRole(3, End);
+        }
+        for (int i = (hasClass ? 5 : 4); i < names.count(); i++)
+            setRole(i, Attribute);
+    }
+
+    // A row must contain (at least) all the mandatory columns
+    for (int i = 0; i < mRoles.count(); i++)
+    {
+        Role r = mRoles.at(i);
+        if ((r == Name) || (r == Group) || (r == Start) || (r == End))
+            mRequired = qMax(mRequired, (i + 1));
+    }
+    return true;
+}
+
+int vlePlanSchema::attributeCount(void) const
+{
+    return mAttributeNames.count();
+}
+
+const QStringList &vlePlanSchema::attributeNames(void) const
+{
+    return mAttributeNames;
+}
+
+int vlePlanSchema::attributeIndex(int column) const
+{
+    if ((column < 0) || (column >= mAttributes.count()))
+        return -1;
+    return mAttributes.at(column);
+}
+
+int vlePlanSchema::columnCount(void) const
+{
+    return mRoles.count();
+}
+
+int vlePlanSchema::lastColumn(void) const
+{
+    return mLastColumn;
+}
+
+int vlePlanSchema::requiredColumns(void) const
+{
+    return mRequired;
+}
+
+vlePlanSchema::Role vlePlanSchema::role(int column) const
+{
+    if ((column < 0) || (column >= mRoles.count()))
+        return Ignored;
+    return mRoles.at(column);
+}
+
+char vlePlanSchema::separator(void) const
+{
+    return mSeparator;
+}
+
+void vlePlanSchema::setRole(int column, Role role)
+{
+    // Attributes not selected by caller are not loaded
+    if ((role == Attribute) && ( ! mAllAttributes) &&
+        ( ! mSelected.contains(mColumnNames.at(column), Qt::CaseInsensitive)))
+        role = Ignored;
+
+    mRoles[column] = role;
+
+    if (role == Attribute)
+    {
+        mAttributes[column] = mAttributeNames.count();
+        mAttributeNames.append(mColumnNames.at(column));
+    }
+    if (role != Ignored)
+        mLastColumn = qMax(mLastColumn, column);
+}
+
+vlePlanSchema::Role vlePlanSchema::roleFromName(const QString &name)
+{
+    QString n = name.toLower();
+
+    if ((n == "field") || (n == "name") || (n == "activity"))
+        return Name;
+    if (n == "group")
+        return Group;
+    if ((n == "class") || (n == "type"))
+        return Class;
+    if ((n == "startdate") || (n == "start") || (n == "begin"))
+        return Start;
+    if ((n == "enddate") || (n == "end") || (n == "finish"))
+        return End;
+    if ((n == "path") || (n == "parent") || (n == "hierarchy"))
+        return Path;
+    return Attribute;
+}
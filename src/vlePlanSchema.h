@@ -0,0 +1,61 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANSCHEMA_H
+#define VLEPLANSCHEMA_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Mapping of the CSV columns of a plan file to activity fields.
+ *
+ * Columns are identified by the names found into the header line
+ * (Field, Group, Class, StartDate, EndDate, Path ...), all other columns
+ * are attributes. The optional Path column places the group into a
+ * hierarchy (like "farm/parcel"). When the header does not contain the
+ * expected names, the historical layout is used, based on the number of
+ * columns.
+ *
+ * Callers may select the attribute columns to load : other columns are
+ * skipped by the tokenizer, without being converted or stored.
+ */
+class vlePlanSchema
+{
+public:
+    enum Role { Ignored, Name, Group, Class, Start, End, Path, Attribute };
+public:
+    vlePlanSchema();
+    void  selectAllAttributes(void);
+    void  selectAttributes(const QStringList &names);
+    bool  parseHeader(const QByteArray &line, char separator = ';');
+    int   attributeCount(void) const;
+    const QStringList &attributeNames(void) const;
+    int   attributeIndex(int column) const;
+    int   columnCount(void) const;
+    int   lastColumn(void) const;
+    int   requiredColumns(void) const;
+    Role  role(int column) const;
+    char  separator(void) const;
+private:
+    void  setRole(int column, Role role);
+    static Role roleFromName(const QString &name);
+private:
+    char  mSeparator;
+    bool  mAllAttributes;
+    QStringList mSelected;       // Attributes requested by caller
+    QStringList mColumnNames;    // Names found into the header
+    QStringList mAttributeNames; // Names of the loaded attributes
+    QVector<Role> mRoles;        // Role of each column
+    QVector<int>  mAttributes;   // Position of each column into activity attributes
+    int   mLastColumn;           // Last column that must be decoded
+    int   mRequired;             // Number of columns needed for a valid row
+};
+
+#endif // VLEPLANSCHEMA_H
@@ -0,0 +1,207 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <algorithm>
+#include "vlePlan.h"
+#include "vlePlanStats.h"
+
+vlePlanStats::vlePlanStats()
+{
+    mDayFirst = 0;
+    mDayLast  = -1;
+}
+
+void vlePlanStats::build(const vlePlan *plan, const vlePlanStats *previous)
+{
+    mClasses.clear();
+    mClassIndex.clear();
+    mGroups.clear();
+    mDayFirst = 0;
+    mDayLast  = -1;
+
+    if ((plan == NULL) || ( ! plan->dateStart().isValid()) || ( ! plan->dateEnd().isValid()))
+        return;
+
+    mDayFirst = (qint32)plan->dateStart().toJulianDay();
+    mDayLast  = (qint32)plan->dateEnd().toJulianDay();
+
+    // Classes keep the index they had into the previous statistics
+    if (previous)
+    {
+        mClasses    = previous->mClasses;
+        mClassIndex = previous->mClassIndex;
+    }
+
+    // Only the groups modified since the previous statistics are computed
+    int count = plan->countGroups();
+    mGroups.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        quint64 revision = plan->getGroup(i)->revision();
+        if (previous && (i < previous->mGroups.count()) &&
+            (previous->mGroups.at(i)->revision == revision))
+        {
+            mGroups.append(previous->mGroups.at(i));
+            continue;
+        }
+        std::shared_ptr<Group> g = std::make_shared<Group>();
+        buildGroup(plan, i, g.get());
+        mGroups.append(g);
+    }
+}
+
+void vlePlanStats::buildGroup(const vlePlan *plan, int group, Group *out)
+{
+    const vlePlanTime &time = plan->time();
+    vlePlanGroup *g = plan->getGroup(group);
+    const vlePlanTick *tickStarts = g->tickStarts();
+    const vlePlanTick *tickEnds   = g->tickEnds();
+    vlePlanActivity * const *activities = g->activities();
+
+    out->revision = g->revision();
+
+    // First, get the first and last day of the activities of each class
+    for (int j = 0; j < g->count(); j++)
+    {
+        // Statistics are made per day, whatever the plan resolution
+        qint32 first = (qint32)time.toJulianDay(tickStarts[j]);
+        qint32 last  = (qint32)time.toJulianDay(tickEnds[j]);
+        if (last < first)
+            continue;
+
+        const QString &name = activities[j]->getClass();
+        int cls = mClassIndex.value(name, -1);
+        if (cls < 0)
+        {
+            cls = mClasses.count();
+            mClassIndex.insert(name, cls);
+            mClasses.append(name);
+        }
+        Cell &c = out->cells[cls];
+        c.firsts.append(first);
+        c.lasts.append(last);
+    }
+
+    // Then merge the sorted starts and ends to get the breakpoints
+    for (QHash<int, Cell>::iterator it = out->cells.begin(); it != out->cells.end(); ++it)
+    {
+        Cell &c = it.value();
+        std::sort(c.firsts.begin(), c.firsts.end());
+        std::sort(c.lasts.begin(),  c.lasts.end());
+
+        int n = c.firsts.count();
+        int i = 0;
+        int k = 0;
+        qint32 active = 0;
+        qint64 sum    = 0;
+        // An activity is active from its first day until the day after its last one
+        while (k < n)
+        {
+            qint32 day = (c.lasts.at(k) + 1);
+            if (i < n)
+                day = qMin(day, c.firsts.at(i));
+            if ( ! c.days.isEmpty())
+                sum += (qint64)c.active.last() * (day - c.days.last());
+            for ( ; (i < n) && (c.firsts.at(i) == day); i++)
+                active++;
+            for ( ; (k < n) && ((c.lasts.at(k) + 1) == day); k++)
+                active--;
+            c.days.append(day);
+            c.active.append(active);
+            c.before.append(sum);
+        }
+    }
+}
+
+int vlePlanStats::classCount(void) const
+{
+    return mClasses.count();
+}
+
+int vlePlanStats::classIndex(const QString &name) const
+{
+    return mClassIndex.value(name, -1);
+}
+
+const QString &vlePlanStats::className(int pos) const
+{
+    static const QString empty;
+
+    if ((pos < 0) || (pos >= mClasses.count()))
+        return empty;
+
+    return mClasses.at(pos);
+}
+
+int vlePlanStats::groupCount(void) const
+{
+    return mGroups.count();
+}
+
+qint32 vlePlanStats::dayFirst(void) const
+{
+    return mDayFirst;
+}
+
+qint32 vlePlanStats::dayLast(void) const
+{
+    return mDayLast;
+}
+
+qint64 vlePlanStats::activeDays(int group, int cls, qint32 dayStart, qint32 dayEnd) const
+{
+    const Cell *c = cell(group, cls);
+    if ((c == NULL) || (dayEnd < dayStart))
+        return 0;
+
+    // Activity-days before the end of the window, minus the ones before its start
+    return (daysBefore(c, dayEnd + 1) - daysBefore(c, dayStart));
+}
+
+qint64 vlePlanStats::activeDays(int group, int cls, const QDate &start, const QDate &end) const
+{
+    return activeDays(group, cls, (qint32)start.toJulianDay(), (qint32)end.toJulianDay());
+}
+
+int vlePlanStats::activities(int group, int cls, qint32 dayStart, qint32 dayEnd) const
+{
+    const Cell *c = cell(group, cls);
+    if ((c == NULL) || (dayEnd < dayStart))
+        return 0;
+
+    // Activities started before the end of the window, minus the ones ended before its start
+    int started = (std::upper_bound(c->firsts.begin(), c->firsts.end(), dayEnd)  - c->firsts.begin());
+    int ended   = (std::lower_bound(c->lasts.begin(),  c->lasts.end(),  dayStart) - c->lasts.begin());
+    return (started - ended);
+}
+
+int vlePlanStats::activities(int group, int cls, const QDate &start, const QDate &end) const
+{
+    return activities(group, cls, (qint32)start.toJulianDay(), (qint32)end.toJulianDay());
+}
+
+const vlePlanStats::Cell *vlePlanStats::cell(int group, int cls) const
+{
+    if ((group < 0) || (group >= mGroups.count()))
+        return NULL;
+
+    const QHash<int, Cell> &cells = mGroups.at(group)->cells;
+    QHash<int, Cell>::const_iterator it = cells.constFind(cls);
+    if (it == cells.constEnd())
+        return NULL;
+    return &it.value();
+}
+
+qint64 vlePlanStats::daysBefore(const Cell *c, qint32 day)
+{
+    // Last breakpoint at or before the day (none : no activity yet)
+    int k = (std::upper_bound(c->days.begin(), c->days.end(), day) - c->days.begin()) - 1;
+    if (k < 0)
+        return 0;
+
+    return (c->before.at(k) + ((qint64)c->active.at(k) * (day - c->days.at(k))));
+}
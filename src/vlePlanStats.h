@@ -0,0 +1,71 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANSTATS_H
+#define VLEPLANSTATS_H
+
+#include <QDate>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+class vlePlan;
+
+/**
+ * Statistics of a plan, per group and activity class.
+ *
+ * Each (group, class) cell holds the sorted days where the number of
+ * running activities changes, with the activity-days summed before each
+ * of these days, and the sorted first and last days of its activities.
+ * Any total between two dates is then found by binary search, and the
+ * size of a cell only depends on its activity count (not on the period).
+ *
+ * Statistics are built by vlePlan::update and never modified. The groups
+ * that did not change since the previous statistics are shared with them.
+ */
+class vlePlanStats
+{
+public:
+    vlePlanStats();
+    void    build(const vlePlan *plan, const vlePlanStats *previous = NULL);
+    int     classCount(void) const;
+    int     classIndex(const QString &name) const;
+    const QString &className(int pos) const;
+    int     groupCount(void) const;
+    qint32  dayFirst(void) const;
+    qint32  dayLast (void) const;
+    qint64  activeDays(int group, int cls, qint32 dayStart, qint32 dayEnd) const;
+    qint64  activeDays(int group, int cls, const QDate &start, const QDate &end) const;
+    int     activities(int group, int cls, qint32 dayStart, qint32 dayEnd) const;
+    int     activities(int group, int cls, const QDate &start, const QDate &end) const;
+private:
+    struct Cell
+    {
+        QVector<qint32> days;    // Days where the active count changes
+        QVector<qint32> active;  // Active count from this day to the next one
+        QVector<qint64> before;  // Activity-days before this day
+        QVector<qint32> firsts;  // First day of each activity (sorted)
+        QVector<qint32> lasts;   // Last day of each activity (sorted)
+    };
+    struct Group
+    {
+        quint64 revision;        // Revision of the plan group
+        QHash<int, Cell> cells;  // Indexed by class
+    };
+    void    buildGroup(const vlePlan *plan, int group, Group *out);
+    const Cell *cell(int group, int cls) const;
+    static qint64 daysBefore(const Cell *c, qint32 day);
+private:
+    qint32  mDayFirst;
+    qint32  mDayLast;
+    QStringList         mClasses;
+    QHash<QString, int> mClassIndex;
+    QVector< std::shared_ptr<const Group> > mGroups;
+};
+
+#endif // VLEPLANSTATS_H
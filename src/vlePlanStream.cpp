@@ -0,0 +1,353 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QFile>
+#include <QMutexLocker>
+#include <QtDebug>
+#include <zlib.h>
+#ifdef VLE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "vlePlanStream.h"
+
+// Size of decoded blocks, and max number of blocks waiting for the reader
+static const int streamChunkSize  = (256 * 1024);
+static const int streamQueueDepth = 16;
+
+vlePlanStreamThread::vlePlanStreamThread(vlePlanStream *stream)
+{
+    mStream = stream;
+}
+
+void vlePlanStreamThread::run()
+{
+    mStream->produce();
+}
+
+vlePlanStream::vlePlanStream(const QString &fileName)
+{
+    mFileName = fileName;
+    mFormat   = Plain;
+    mThread   = NULL;
+    mAbort    = false;
+    mFinished = true;
+    mOffset   = 0;
+}
+
+vlePlanStream::~vlePlanStream()
+{
+    close();
+}
+
+bool vlePlanStream::atEnd(void) const
+{
+    // Some data already buffered by QIODevice or into current block
+    if ((QIODevice::bytesAvailable() > 0) || (mOffset < mCurrent.size()))
+        return false;
+
+    // Wait for the producer to push a block, or to finish
+    QMutexLocker lock(&mLock);
+    while (mChunks.isEmpty() && ( ! mFinished))
+        mNotEmpty.wait(&mLock);
+
+    return mChunks.isEmpty();
+}
+
+qint64 vlePlanStream::bytesAvailable(void) const
+{
+    qint64 count = QIODevice::bytesAvailable() + (mCurrent.size() - mOffset);
+
+    QMutexLocker lock(&mLock);
+    for (int i = 0; i < mChunks.count(); i++)
+        count += mChunks.at(i).size();
+    return count;
+}
+
+void vlePlanStream::close(void)
+{
+    if (mThread)
+    {
+        // Stop the producer (it may wait for free space into the queue)
+        mLock.lock();
+        mAbort = true;
+        mNotFull.wakeAll();
+        mLock.unlock();
+
+        mThread->wait();
+        delete mThread;
+        mThread = NULL;
+    }
+    mChunks.clear();
+    mCurrent.clear();
+    mOffset = 0;
+
+    QIODevice::close();
+}
+
+QString vlePlanStream::decodeError(void) const
+{
+    QMutexLocker lock(&mLock);
+    return mDecodeError;
+}
+
+vlePlanStream::Format vlePlanStream::detect(const QString &fileName)
+{
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::ReadOnly))
+        return Plain;
+
+    // Search the "magic number" of known compression formats
+    QByteArray magic = file.read(4);
+    file.close();
+
+    if (magic.startsWith("\x1f\x8b"))
+        return Gzip;
+    if (magic == QByteArray("\x28\xb5\x2f\xfd", 4))
+        return Zstd;
+    return Plain;
+}
+
+bool vlePlanStream::isSequential(void) const
+{
+    return true;
+}
+
+bool vlePlanStream::open(OpenMode mode)
+{
+    // Only read access is supported
+    if (mode & QIODevice::WriteOnly)
+        return false;
+
+    mFormat = detect(mFileName);
+#ifndef VLE_HAVE_ZSTD
+    if (mFormat == Zstd)
+    {
+        setErrorString("Zstd support not available");
+        return false;
+    }
+#endif
+
+    mAbort    = false;
+    mFinished = false;
+    mDecodeError.clear();
+    mChunks.clear();
+    mCurrent.clear();
+    mOffset   = 0;
+
+    QIODevice::open(mode);
+
+    // Start decompression
+    mThread = new vlePlanStreamThread(this);
+    mThread->start();
+
+    return true;
+}
+
+qint64 vlePlanStream::readData(char *data, qint64 maxSize)
+{
+    qint64 done = 0;
+
+    while (done < maxSize)
+    {
+        // If the current block has been consumed, take the next one
+        if (mOffset >= mCurrent.size())
+        {
+            QMutexLocker lock(&mLock);
+            // Only wait for the producer if nothing has been read yet
+            while (mChunks.isEmpty() && ( ! mFinished) && (done == 0))
+                mNotEmpty.wait(&mLock);
+            if (mChunks.isEmpty())
+                break;
+            mCurrent = mChunks.dequeue();
+            mOffset  = 0;
+            mNotFull.wakeOne();
+        }
+
+        int len = qMin((qint64)(mCurrent.size() - mOffset), (maxSize - done));
+        memcpy(data + done, mCurrent.constData() + mOffset, len);
+        mOffset += len;
+        done    += len;
+    }
+
+    // No data and no more to come : end of stream
+    if (done == 0)
+    {
+        QMutexLocker lock(&mLock);
+        if (mFinished && mChunks.isEmpty())
+            return -1;
+    }
+    return done;
+}
+
+qint64 vlePlanStream::writeData(const char *data, qint64 maxSize)
+{
+    (void)data;
+    (void)maxSize;
+    return -1;
+}
+
+void vlePlanStream::produce(void)
+{
+    QFile in(mFileName);
+
+    if (in.open(QIODevice::ReadOnly))
+    {
+        if (mFormat == Gzip)
+            produceGzip(&in);
+        else if (mFormat == Zstd)
+            produceZstd(&in);
+        in.close();
+    }
+    else
+        setDecodeError(in.errorString());
+
+    // Inform the reader that no more data will come
+    QMutexLocker lock(&mLock);
+    mFinished = true;
+    mNotEmpty.wakeAll();
+}
+
+bool vlePlanStream::push(const char *data, int size)
+{
+    QMutexLocker lock(&mLock);
+
+    // Wait for free space into the queue (back-pressure from the reader)
+    while ((mChunks.count() >= streamQueueDepth) && ( ! mAbort))
+        mNotFull.wait(&mLock);
+    if (mAbort)
+        return false;
+
+    mChunks.enqueue(QByteArray(data, size));
+    mNotEmpty.wakeOne();
+    return true;
+}
+
+void vlePlanStream::setDecodeError(const QString &error)
+{
+    qWarning() << "vlePlanStream:" << error << "into" << mFileName;
+
+    QMutexLocker lock(&mLock);
+    mDecodeError = error;
+}
+
+void vlePlanStream::produceGzip(QIODevice *in)
+{
+    QByteArray inBuffer;
+    QByteArray outBuffer(streamChunkSize, 0);
+    z_stream z;
+
+    memset(&z, 0, sizeof(z));
+    // Window bits + 32 : automatic detection of gzip or zlib header
+    if (inflateInit2(&z, 15 + 32) != Z_OK)
+    {
+        setDecodeError("gzip decoder not available");
+        return;
+    }
+
+    int  ret  = Z_OK;
+    bool ok   = true;
+    bool full = false;
+    bool complete = false;  // Last member decoded up to its end
+    while (true)
+    {
+        // Read more input, unless inflate still has output to flush
+        if ((z.avail_in == 0) && ( ! full))
+        {
+            inBuffer = in->read(streamChunkSize);
+            if (inBuffer.isEmpty())
+                break;
+            z.next_in  = (Bytef *)inBuffer.data();
+            z.avail_in = inBuffer.size();
+        }
+
+        z.next_out  = (Bytef *)outBuffer.data();
+        z.avail_out = outBuffer.size();
+        ret = inflate(&z, Z_NO_FLUSH);
+        if ((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+        {
+            setDecodeError(QString("gzip error %1").arg(ret));
+            ok = false;
+            break;
+        }
+
+        full = (z.avail_out == 0);
+        int len = (outBuffer.size() - z.avail_out);
+        if ((len > 0) && ( ! push(outBuffer.constData(), len)))
+        {
+            ok = false;
+            break;
+        }
+
+        // A gzip file may contain many members, continue with the next one
+        // (a new member starts with input, nothing is left to flush)
+        complete = (ret == Z_STREAM_END);
+        if (complete)
+        {
+            inflateReset(&z);
+            full = false;
+        }
+    }
+    // At the end of the file, the last member must be complete
+    if (ok && ( ! complete))
+        setDecodeError("truncated gzip stream");
+    inflateEnd(&z);
+}
+
+void vlePlanStream::produceZstd(QIODevice *in)
+{
+#ifdef VLE_HAVE_ZSTD
+    QByteArray inBuffer;
+    QByteArray outBuffer(ZSTD_DStreamOutSize(), 0);
+    ZSTD_DStream *zs = ZSTD_createDStream();
+    if (zs == NULL)
+    {
+        setDecodeError("zstd decoder not available");
+        return;
+    }
+    size_t init = ZSTD_initDStream(zs);
+    if (ZSTD_isError(init))
+    {
+        setDecodeError(QString("zstd error %1").arg(ZSTD_getErrorName(init)));
+        ZSTD_freeDStream(zs);
+        return;
+    }
+
+    size_t ret = 0;
+    bool   ok  = true;
+    while (ok)
+    {
+        inBuffer = in->read(ZSTD_DStreamInSize());
+        if (inBuffer.isEmpty())
+            break;
+
+        // Decode until all the input is consumed, and while the output is
+        // full (zstd may still hold decoded data for this input)
+        ZSTD_inBuffer zin = { inBuffer.constData(), (size_t)inBuffer.size(), 0 };
+        bool full = false;
+        while (ok && ((zin.pos < zin.size) || full))
+        {
+            ZSTD_outBuffer zout = { outBuffer.data(), (size_t)outBuffer.size(), 0 };
+            ret = ZSTD_decompressStream(zs, &zout, &zin);
+            if (ZSTD_isError(ret))
+            {
+                setDecodeError(QString("zstd error %1").arg(ZSTD_getErrorName(ret)));
+                ok = false;
+                break;
+            }
+            full = (zout.pos == zout.size);
+            if (zout.pos > 0)
+                ok = push(outBuffer.constData(), zout.pos);
+        }
+    }
+    // At the end of the file, the last frame must be complete
+    if (ok && (ret != 0))
+        setDecodeError("truncated zstd frame");
+    ZSTD_freeDStream(zs);
+#else
+    (void)in;
+#endif
+}
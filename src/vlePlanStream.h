@@ -0,0 +1,81 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANSTREAM_H
+#define VLEPLANSTREAM_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+class vlePlanStream;
+
+class vlePlanStreamThread : public QThread
+{
+public:
+    vlePlanStreamThread(vlePlanStream *stream);
+protected:
+    void run();
+private:
+    vlePlanStream *mStream;
+};
+
+/**
+ * Sequential device to read a compressed plan file.
+ *
+ * Decompression is made by a producer thread, that pushes blocks of
+ * decoded data into a bounded queue. The reader (CSV parser) consumes
+ * these blocks at the same time, so decompression and parsing overlap.
+ * A corrupted or truncated file ends the stream early, decodeError() then
+ * explains why.
+ */
+class vlePlanStream : public QIODevice
+{
+public:
+    enum Format { Plain, Gzip, Zstd };
+public:
+    vlePlanStream(const QString &fileName);
+    ~vlePlanStream();
+    bool   atEnd(void) const;
+    qint64 bytesAvailable(void) const;
+    void   close(void);
+    QString decodeError(void) const;
+    bool   isSequential(void) const;
+    bool   open(OpenMode mode);
+    static Format detect(const QString &fileName);
+protected:
+    qint64 readData (char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+private:
+    friend class vlePlanStreamThread;
+    void   produce(void);
+    bool   push(const char *data, int size);
+    void   setDecodeError(const QString &error);
+    void   produceGzip(QIODevice *in);
+    void   produceZstd(QIODevice *in);
+private:
+    QString mFileName;
+    Format  mFormat;
+    vlePlanStreamThread *mThread;
+    // Queue of decoded blocks, shared with the producer thread
+    mutable QMutex         mLock;
+    mutable QWaitCondition mNotEmpty;
+    QWaitCondition         mNotFull;
+    QQueue<QByteArray>     mChunks;
+    bool    mAbort;
+    bool    mFinished;
+    QString mDecodeError;  // Set by the producer, empty if none
+    // Block currently read (only used by the reader)
+    QByteArray mCurrent;
+    int        mOffset;
+};
+
+#endif // VLEPLANSTREAM_H
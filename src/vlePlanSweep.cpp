@@ -0,0 +1,170 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <QBitArray>
+#include <algorithm>
+#include "vlePlanSweep.h"
+
+vlePlanSweep::vlePlanSweep()
+{
+    mPlan = NULL;
+    clear();
+}
+
+void vlePlanSweep::build(const vlePlan *plan)
+{
+    clear();
+    update(plan);
+}
+
+void vlePlanSweep::update(const vlePlan *plan, QSet<int> *changed)
+{
+    int oldCount = mActive.count();
+    int count    = plan ? plan->countGroups() : 0;
+    mPlan = plan;
+
+    // Groups modified since the previous version (or added, or removed)
+    QBitArray modified(qMax(oldCount, count));
+    for (int i = 0; i < modified.size(); i++)
+    {
+        if ((i >= count) || (i >= oldCount) || (mRevisions.at(i) != plan->getGroup(i)->revision()))
+        {
+            modified.setBit(i);
+            if (changed)
+                changed->insert(i);
+        }
+    }
+
+    // Events of the other groups are kept (still sorted) ...
+    QVector<Event> kept;
+    kept.reserve(mEvents.count());
+    for (int k = 0; k < mEvents.count(); k++)
+    {
+        if ( ! modified.testBit(mEvents.at(k).group))
+            kept.append(mEvents.at(k));
+    }
+
+    // ... and merged with the sorted events of the modified groups. Two
+    // events per activity : it is running from its start to its end
+    // (included), so the end event is one tick after the end
+    QVector<Event> added;
+    mActive.resize(count);
+    mRevisions.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        if ( ! modified.testBit(i))
+            continue;
+        const vlePlanGroup *g = plan->getGroup(i);
+        const vlePlanTick *starts = g->tickStarts();
+        const vlePlanTick *ends   = g->tickEnds();
+        mActive[i].clear();
+        mRevisions[i] = g->revision();
+        for (int j = 0; j < g->count(); j++)
+        {
+            Event start = { starts[j], i, j };
+            Event end   = { qMax(starts[j], ends[j]) + 1, i, ~j };
+            added.append(start);
+            added.append(end);
+            // Activities running at the cursor
+            if ((mCursor != vlePlanTime::invalid) && (start.tick <= mCursor) && (end.tick > mCursor))
+                mActive[i].insert(j);
+        }
+    }
+    // The end of an activity is always after its start, so they are
+    // applied in the right order whatever the order of equal ticks
+    std::sort(added.begin(), added.end(), before);
+    mEvents.resize(kept.count() + added.count());
+    std::merge(kept.begin(), kept.end(), added.begin(), added.end(), mEvents.begin(), before);
+
+    // Events up to the cursor are applied
+    if (mCursor == vlePlanTime::invalid)
+        mNext = 0;
+    else
+    {
+        Event at = { mCursor, 0, 0 };
+        mNext = (std::upper_bound(mEvents.begin(), mEvents.end(), at, before) - mEvents.begin());
+    }
+    mActiveCount = 0;
+    for (int i = 0; i < count; i++)
+        mActiveCount += mActive.at(i).count();
+}
+
+void vlePlanSweep::clear(void)
+{
+    mEvents.clear();
+    mActive.clear();
+    mRevisions.clear();
+    mNext        = 0;
+    mCursor      = vlePlanTime::invalid;
+    mActiveCount = 0;
+}
+
+const vlePlan *vlePlanSweep::plan(void) const
+{
+    return mPlan;
+}
+
+vlePlanTick vlePlanSweep::cursor(void) const
+{
+    return mCursor;
+}
+
+int vlePlanSweep::activeCount(void) const
+{
+    return mActiveCount;
+}
+
+const QSet<int> &vlePlanSweep::active(int group) const
+{
+    static const QSet<int> empty;
+    if ((group < 0) || (group >= mActive.count()))
+        return empty;
+    return mActive.at(group);
+}
+
+int vlePlanSweep::moveTo(vlePlanTick tick, QSet<int> *changed)
+{
+    // Only the events crossed by the cursor are applied (or reverted)
+    int crossed = 0;
+    while ((mNext < mEvents.count()) && (mEvents.at(mNext).tick <= tick))
+    {
+        apply(mEvents.at(mNext++), true, changed);
+        crossed++;
+    }
+    while ((mNext > 0) && (mEvents.at(mNext - 1).tick > tick))
+    {
+        apply(mEvents.at(--mNext), false, changed);
+        crossed++;
+    }
+    mCursor = tick;
+    return crossed;
+}
+
+bool vlePlanSweep::before(const Event &a, const Event &b)
+{
+    return (a.tick < b.tick);
+}
+
+void vlePlanSweep::apply(const Event &e, bool forward, QSet<int> *changed)
+{
+    bool start = (e.pos >= 0);
+    int  pos   = start ? e.pos : ~e.pos;
+
+    // A start moving forward (or an end moving backward) adds the activity
+    if (start == forward)
+    {
+        mActive[e.group].insert(pos);
+        mActiveCount++;
+    }
+    else
+    {
+        mActive[e.group].remove(pos);
+        mActiveCount--;
+    }
+    if (changed)
+        changed->insert(e.group);
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANSWEEP_H
+#define VLEPLANSWEEP_H
+
+#include <QSet>
+#include <QVector>
+#include "vlePlan.h"
+
+/**
+ * Activities running at a moving date (time cursor).
+ *
+ * The start and end of all activities are sorted once as a list of
+ * events. The set of running activities is kept for the current cursor :
+ * when the cursor moves (forward or backward), only the events between
+ * the old and the new position are applied.
+ *
+ * For a new version of the plan, only the events of the modified groups
+ * are sorted again and merged with the kept ones, the cursor stays at
+ * the same date.
+ */
+class vlePlanSweep
+{
+public:
+    vlePlanSweep();
+    void  build(const vlePlan *plan);
+    void  update(const vlePlan *plan, QSet<int> *changed = NULL);
+    void  clear(void);
+    const vlePlan *plan(void) const;
+    vlePlanTick cursor(void) const;
+    int   activeCount(void) const;
+    const QSet<int> &active(int group) const;
+    int   moveTo(vlePlanTick tick, QSet<int> *changed = NULL);
+private:
+    struct Event
+    {
+        vlePlanTick tick;
+        qint32 group;
+        qint32 pos;    // Position into the group, ~pos for an end event
+    };
+    void  apply(const Event &e, bool forward, QSet<int> *changed);
+    static bool before(const Event &a, const Event &b);
+private:
+    const vlePlan  *mPlan;
+    QVector<Event>  mEvents;  // Sorted by tick
+    int             mNext;    // Events before this one have been applied
+    vlePlanTick     mCursor;
+    int             mActiveCount;
+    QVector< QSet<int> > mActive;  // Running activities of each group
+    QVector<quint64>     mRevisions; // Revision of each group into the events
+};
+
+#endif // VLEPLANSWEEP_H
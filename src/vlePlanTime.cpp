@@ -0,0 +1,156 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <limits>
+#include "vlePlanTime.h"
+
+const vlePlanTick vlePlanTime::invalid = std::numeric_limits<vlePlanTick>::min();
+
+// Integer division rounded toward minus infinity
+static inline qint64 floorDiv(qint64 a, qint64 b)
+{
+    qint64 q = (a / b);
+    if (((a % b) != 0) && ((a < 0) != (b < 0)))
+        q--;
+    return q;
+}
+
+// Read a fixed number of digits, return -1 if one of them is not a digit
+static inline int parseDigits(const char *data, int count)
+{
+    int v = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int d = (data[i] - '0');
+        if ((d < 0) || (d > 9))
+            return -1;
+        v = (v * 10) + d;
+    }
+    return v;
+}
+
+vlePlanTime::vlePlanTime(Resolution resolution)
+{
+    mResolution = resolution;
+}
+
+vlePlanTime::Resolution vlePlanTime::resolution(void) const
+{
+    return mResolution;
+}
+
+int vlePlanTime::ticksPerDay(void) const
+{
+    return (int)mResolution;
+}
+
+vlePlanTick vlePlanTime::fromDate(const QDate &date) const
+{
+    if ( ! date.isValid())
+        return invalid;
+    return (date.toJulianDay() * ticksPerDay());
+}
+
+vlePlanTick vlePlanTime::fromDateTime(const QDateTime &dateTime) const
+{
+    if ( ! dateTime.isValid())
+        return invalid;
+    // Seconds into the day are truncated to the resolution
+    int secs = dateTime.time().msecsSinceStartOfDay() / 1000;
+    return (dateTime.date().toJulianDay() * ticksPerDay()) +
+           (secs / (86400 / ticksPerDay()));
+}
+
+vlePlanTick vlePlanTime::fromMinutes(qint64 minutes) const
+{
+    return floorDiv(minutes, (Minute / ticksPerDay()));
+}
+
+QDate vlePlanTime::toDate(vlePlanTick tick) const
+{
+    if (tick == invalid)
+        return QDate();
+    return QDate::fromJulianDay(toJulianDay(tick));
+}
+
+QDateTime vlePlanTime::toDateTime(vlePlanTick tick) const
+{
+    if (tick == invalid)
+        return QDateTime();
+    qint64 day  = toJulianDay(tick);
+    int    secs = (int)(tick - (day * ticksPerDay())) * (86400 / ticksPerDay());
+    return QDateTime(QDate::fromJulianDay(day), QTime(0, 0).addSecs(secs));
+}
+
+qint64 vlePlanTime::toJulianDay(vlePlanTick tick) const
+{
+    return floorDiv(tick, ticksPerDay());
+}
+
+qint64 vlePlanTime::toMinutes(vlePlanTick tick) const
+{
+    return (tick * (Minute / ticksPerDay()));
+}
+
+// Convert an ISO date (YYYY-MM-DD) or datetime (YYYY-MM-DDTHH:MM[:SS])
+// without building a QString
+vlePlanTick vlePlanTime::parse(const char *data, int len) const
+{
+    if ((len >= 10) && (data[4] == '-') && (data[7] == '-'))
+    {
+        int year  = parseDigits(data,     4);
+        int month = parseDigits(data + 5, 2);
+        int day   = parseDigits(data + 8, 2);
+        int hour  = 0;
+        int min   = 0;
+        int sec   = 0;
+        bool ok   = (year >= 0) && (month >= 0) && (day >= 0);
+
+        if (len == 10)
+            ;
+        else if (((len == 16) || (len == 19)) &&
+                 ((data[10] == 'T') || (data[10] == ' ')) && (data[13] == ':'))
+        {
+            hour = parseDigits(data + 11, 2);
+            min  = parseDigits(data + 14, 2);
+            if (len == 19)
+                sec = (data[16] == ':') ? parseDigits(data + 17, 2) : -1;
+            ok = ok && (hour >= 0) && (hour < 24) && (min >= 0) && (min < 60) &&
+                 (sec >= 0) && (sec < 60);
+        }
+        else
+            ok = false;
+
+        QDate date(year, month, day);
+        if (ok && date.isValid())
+        {
+            int secs = (hour * 3600) + (min * 60) + sec;
+            return (date.toJulianDay() * ticksPerDay()) + (secs / (86400 / ticksPerDay()));
+        }
+    }
+
+    // Other formats (time zone, milliseconds ...) are handled by Qt
+    QString str = QString::fromUtf8(data, len).trimmed();
+    QDateTime dt = QDateTime::fromString(str, Qt::ISODate);
+    if (dt.isValid() && str.contains(QLatin1Char(':')))
+        return fromDateTime(dt);
+    return fromDate(QDate::fromString(str, Qt::ISODate));
+}
+
+bool vlePlanTime::parseResolution(const QString &name, Resolution *resolution)
+{
+    QString n = name.trimmed().toLower();
+    if (n == "day")
+        *resolution = Day;
+    else if (n == "hour")
+        *resolution = Hour;
+    else if (n == "minute")
+        *resolution = Minute;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANTIME_H
+#define VLEPLANTIME_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QString>
+#include <QtGlobal>
+
+// Position on the time axis, as a number of ticks since julian day 0
+typedef qint64 vlePlanTick;
+
+/**
+ * Time model of a plan : converts dates to ticks and back.
+ *
+ * The length of a tick is set by the resolution (one day, hour or minute).
+ * A tick is a plain 64 bits integer : it is as small as a QDate, and much
+ * smaller than a QDateTime, even with a minute resolution.
+ */
+class vlePlanTime
+{
+public:
+    // Value of each resolution is the number of ticks per day
+    enum Resolution { Day = 1, Hour = 24, Minute = 1440 };
+    static const vlePlanTick invalid;
+public:
+    vlePlanTime(Resolution resolution = Day);
+    Resolution resolution(void) const;
+    int         ticksPerDay(void) const;
+    vlePlanTick fromDate    (const QDate &date) const;
+    vlePlanTick fromDateTime(const QDateTime &dateTime) const;
+    vlePlanTick fromMinutes (qint64 minutes) const;
+    QDate       toDate      (vlePlanTick tick) const;
+    QDateTime   toDateTime  (vlePlanTick tick) const;
+    qint64      toJulianDay (vlePlanTick tick) const;
+    qint64      toMinutes   (vlePlanTick tick) const;
+    vlePlanTick parse(const char *data, int len) const;
+    static bool parseResolution(const QString &name, Resolution *resolution);
+private:
+    Resolution mResolution;
+};
+
+#endif // VLEPLANTIME_H
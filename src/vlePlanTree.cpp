@@ -0,0 +1,327 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#include <functional>
+#include <queue>
+#include <vector>
+#include "vlePlanTree.h"
+
+vlePlanTree::vlePlanTree()
+{
+    // Nothing to do
+}
+
+void vlePlanTree::build(const QStringList &names, const QStringList &paths, const QString &separator)
+{
+    // Same groups : the tree (and the unions already computed) are kept
+    if (( ! mNodes.isEmpty()) && (names == mNames) && (paths == mPaths) && (separator == mSeparator))
+        return;
+
+    // Unions are kept when only the order of the groups has changed
+    QHash<QString, QString> groups;
+    for (int i = 0; i < names.count(); i++)
+        groups.insert(names.at(i), paths.value(i));
+    if ((groups != mGroups) || (separator != mSeparator))
+        mAggregates.clear();
+
+    mNodes.clear();
+    mKeys.clear();
+    mNames     = names;
+    mPaths     = paths;
+    mGroups    = groups;
+    mSeparator = separator;
+
+    Node root;
+    root.parent   = -1;
+    root.depth    = -1;
+    root.group    = -1;
+    root.expanded = true;
+    mNodes.append(root);
+
+    QString pathSeparator = separator.isEmpty() ? QString("/") : separator;
+    for (int i = 0; i < names.count(); i++)
+    {
+        // Path column first, else the group name itself
+        QStringList parts;
+        if ((i < paths.count()) && ( ! paths.at(i).isEmpty()))
+        {
+            parts = paths.at(i).split(pathSeparator, QString::SkipEmptyParts);
+            parts.append(names.at(i));
+        }
+        else if ( ! separator.isEmpty())
+            parts = names.at(i).split(separator, QString::SkipEmptyParts);
+        if (parts.isEmpty())
+            parts.append(names.at(i));
+
+        int n = 0;
+        for (int j = 0; j < parts.count(); j++)
+            n = child(n, parts.at(j));
+        // Many groups with the same path : each next one gets its own node,
+        // numbered after the nodes already taken
+        if (mNodes.at(n).group >= 0)
+        {
+            int     parent = mNodes.at(n).parent;
+            QString label  = mNodes.at(n).name;
+            for (int k = 1; mNodes.at(n).group >= 0; k++)
+                n = child(parent, label + QChar('\n') + QString::number(k));
+            // Their keys depend on the order of the groups
+            mAggregates.clear();
+        }
+        mNodes[n].group = i;
+    }
+}
+
+void vlePlanTree::clearAggregates(void)
+{
+    mAggregates.clear();
+}
+
+int vlePlanTree::count(void) const
+{
+    return mNodes.count();
+}
+
+const QString &vlePlanTree::groupName(int node) const
+{
+    static const QString empty;
+    int group = mNodes.at(node).group;
+    if (group < 0)
+        return empty;
+    return mNames.at(group);
+}
+
+QStringList vlePlanTree::groupNames(int node) const
+{
+    // Groups of the node and of all its descendants
+    QStringList out;
+    QVector<int> pending;
+    pending.append(node);
+    while ( ! pending.isEmpty())
+    {
+        int n = pending.takeLast();
+        if (hasGroup(n))
+            out.append(groupName(n));
+        pending += mNodes.at(n).children;
+    }
+    return out;
+}
+
+bool vlePlanTree::hasGroup(int node) const
+{
+    return (mNodes.at(node).group >= 0);
+}
+
+bool vlePlanTree::isSummary(int node) const
+{
+    // Nodes without their own group, and collapsed nodes, show the union
+    const Node &n = mNodes.at(node);
+    if (n.group < 0)
+        return true;
+    return ( ! n.expanded) && ( ! n.children.isEmpty());
+}
+
+const vlePlanTree::Node &vlePlanTree::node(int pos) const
+{
+    return mNodes.at(pos);
+}
+
+void vlePlanTree::setExpanded(int node, bool expanded)
+{
+    if ((node <= 0) || (node >= mNodes.count()))
+        return;
+
+    mNodes[node].expanded = expanded;
+    // Remember it, so the state is kept when the tree is built again
+    if (expanded)
+        mCollapsed.remove(mNodes.at(node).key);
+    else
+        mCollapsed.insert(mNodes.at(node).key);
+}
+
+QVector<int> vlePlanTree::visible(void) const
+{
+    // Depth-first order, children of collapsed nodes are hidden
+    QVector<int> out;
+    if ( ! mNodes.isEmpty())
+        visit(0, &out);
+    return out;
+}
+
+void vlePlanTree::visit(int node, QVector<int> *out) const
+{
+    const Node &n = mNodes.at(node);
+    if (node > 0)
+        out->append(node);
+    if ( ! n.expanded)
+        return;
+    for (int i = 0; i < n.children.count(); i++)
+        visit(n.children.at(i), out);
+}
+
+vlePlanIntervals vlePlanTree::aggregate(const vlePlan *plan, int node,
+                                        const vlePlanFilter *filter, int index)
+{
+    QPair<const vlePlan *, QString> key(plan, mNodes.at(node).key);
+    QHash<QPair<const vlePlan *, QString>, vlePlanIntervals>::const_iterator it = mAggregates.constFind(key);
+    if (it != mAggregates.constEnd())
+        return it.value();
+
+    // Activities of the node itself (only the ones accepted by the filter) ...
+    vlePlanIntervals own;
+    QVector<const vlePlanIntervals *> lists;
+    if (hasGroup(node))
+    {
+        int g = plan->groupIndex(groupName(node));
+        if (g >= 0)
+        {
+            const QBitArray *visible = NULL;
+            if (filter && filter->isActive() && (filter->plan(index) == plan))
+                visible = &filter->bitmap(index, g);
+            groupIntervals(plan->getGroup(g), &own, visible);
+            lists.append(&own);
+        }
+    }
+    // ... and the unions of all children, merged at once
+    const QVector<int> &children = mNodes.at(node).children;
+    QVector<vlePlanIntervals> unions(children.count());
+    for (int i = 0; i < children.count(); i++)
+        unions[i] = aggregate(plan, children.at(i), filter, index);
+    for (int i = 0; i < unions.count(); i++)
+        lists.append(&unions.at(i));
+
+    vlePlanIntervals result;
+    if (lists.count() == 1)
+        result = *lists.first();
+    else
+        unite(lists, &result);
+
+    mAggregates.insert(key, result);
+    return result;
+}
+
+void vlePlanTree::groupIntervals(const vlePlanGroup *group, vlePlanIntervals *out, const QBitArray *visible)
+{
+    out->starts.clear();
+    out->ends.clear();
+
+    // Activities are sorted by start : one pass merges overlapping ones
+    const vlePlanTick *starts = group->tickStarts();
+    const vlePlanTick *ends   = group->tickEnds();
+    for (int i = 0; i < group->count(); i++)
+    {
+        if (visible && (i < visible->size()) && ( ! visible->testBit(i)))
+            continue;
+        if (( ! out->ends.isEmpty()) && (starts[i] <= out->ends.last()))
+            out->ends.last() = qMax(out->ends.last(), ends[i]);
+        else
+        {
+            out->starts.append(starts[i]);
+            out->ends.append  (ends[i]);
+        }
+    }
+}
+
+void vlePlanTree::unite(const vlePlanIntervals &a, const vlePlanIntervals &b, vlePlanIntervals *out)
+{
+    out->starts.clear();
+    out->ends.clear();
+    out->starts.reserve(a.starts.count() + b.starts.count());
+    out->ends.reserve  (a.starts.count() + b.starts.count());
+
+    // Merge both sorted lists, joining the periods that overlap
+    int i = 0;
+    int j = 0;
+    while ((i < a.starts.count()) || (j < b.starts.count()))
+    {
+        vlePlanTick s, e;
+        if ((j >= b.starts.count()) || ((i < a.starts.count()) && (a.starts.at(i) <= b.starts.at(j))))
+        {
+            s = a.starts.at(i);
+            e = a.ends.at(i);
+            i++;
+        }
+        else
+        {
+            s = b.starts.at(j);
+            e = b.ends.at(j);
+            j++;
+        }
+        if (( ! out->ends.isEmpty()) && (s <= out->ends.last()))
+            out->ends.last() = qMax(out->ends.last(), e);
+        else
+        {
+            out->starts.append(s);
+            out->ends.append  (e);
+        }
+    }
+}
+
+void vlePlanTree::unite(const QVector<const vlePlanIntervals *> &lists, vlePlanIntervals *out)
+{
+    out->starts.clear();
+    out->ends.clear();
+
+    // Heap of the next period of each list, the earliest start on top
+    typedef QPair<vlePlanTick, int> Head;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heap;
+    QVector<int> pos(lists.count(), 0);
+    int total = 0;
+    for (int k = 0; k < lists.count(); k++)
+    {
+        total += lists.at(k)->starts.count();
+        if ( ! lists.at(k)->starts.isEmpty())
+            heap.push(Head(lists.at(k)->starts.first(), k));
+    }
+    out->starts.reserve(total);
+    out->ends.reserve  (total);
+
+    // Take the periods by start, joining the ones that overlap
+    while ( ! heap.empty())
+    {
+        int k = heap.top().second;
+        heap.pop();
+        const vlePlanIntervals *l = lists.at(k);
+        int p = pos[k]++;
+        vlePlanTick s = l->starts.at(p);
+        vlePlanTick e = l->ends.at(p);
+        if (( ! out->ends.isEmpty()) && (s <= out->ends.last()))
+            out->ends.last() = qMax(out->ends.last(), e);
+        else
+        {
+            out->starts.append(s);
+            out->ends.append  (e);
+        }
+        if (pos.at(k) < l->starts.count())
+            heap.push(Head(l->starts.at(pos.at(k)), k));
+    }
+}
+
+int vlePlanTree::child(int parent, const QString &name)
+{
+    QString key = mNodes.at(parent).key + QChar('\n') + name;
+
+    // Search into existing nodes
+    QHash<QString, int>::const_iterator it = mKeys.constFind(key);
+    if (it != mKeys.constEnd())
+        return it.value();
+
+    Node n;
+    n.name     = name;
+    // Duplicated groups have a marker into their key, not into their label
+    int mark = n.name.indexOf(QChar('\n'));
+    if (mark >= 0)
+        n.name.truncate(mark);
+    n.key      = key;
+    n.parent   = parent;
+    n.depth    = mNodes.at(parent).depth + 1;
+    n.group    = -1;
+    n.expanded = ! mCollapsed.contains(key);
+    mNodes.append(n);
+    mNodes[parent].children.append(mNodes.count() - 1);
+    mKeys.insert(key, mNodes.count() - 1);
+    return (mNodes.count() - 1);
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of VLE, a framework for multi-modeling,
+ * simulation and analysis of complex dynamical systems.
+ * http://www.vle-project.org
+ *
+ * Copyright (c) 2016 Agilack
+ */
+#ifndef VLEPLANTREE_H
+#define VLEPLANTREE_H
+
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include "vlePlan.h"
+#include "vlePlanFilter.h"
+
+// Sorted and disjoint periods (union of the activities of some groups)
+struct vlePlanIntervals
+{
+    QVector<vlePlanTick> starts;
+    QVector<vlePlanTick> ends;
+};
+
+/**
+ * Hierarchy of groups (like farm / parcel / sub-parcel).
+ *
+ * The position of a group into the tree comes from its name (split with a
+ * separator) or from its path (Path column of the plan file). Each node
+ * can be collapsed : it is then shown as one row, the union of the
+ * activities (accepted by the filter) of all its children. These unions
+ * are computed on demand, by merging the unions of the children at once,
+ * and kept until the plans, the groups or the filter change.
+ */
+class vlePlanTree
+{
+public:
+    struct Node
+    {
+        QString name;   // Last part of the path (label)
+        QString key;    // Full path
+        int     parent;
+        int     depth;
+        int     group;  // Position of the group into names list (-1 if none)
+        bool    expanded;
+        QVector<int> children;
+    };
+public:
+    vlePlanTree();
+    void build(const QStringList &names, const QStringList &paths, const QString &separator);
+    void clearAggregates(void);
+    int  count(void) const;
+    const QString &groupName(int node) const;
+    QStringList groupNames(int node) const;
+    bool hasGroup (int node) const;
+    bool isSummary(int node) const;
+    const Node &node(int pos) const;
+    void setExpanded(int node, bool expanded);
+    QVector<int> visible(void) const;
+    vlePlanIntervals aggregate(const vlePlan *plan, int node,
+                               const vlePlanFilter *filter = NULL, int index = 0);
+    static void groupIntervals(const vlePlanGroup *group, vlePlanIntervals *out,
+                               const QBitArray *visible = NULL);
+    static void unite(const vlePlanIntervals &a, const vlePlanIntervals &b, vlePlanIntervals *out);
+    static void unite(const QVector<const vlePlanIntervals *> &lists, vlePlanIntervals *out);
+private:
+    int  child(int parent, const QString &name);
+    void visit(int node, QVector<int> *out) const;
+private:
+    QVector<Node> mNodes;      // First node is the (hidden) root
+    QStringList   mNames;      // Names of the groups
+    QStringList   mPaths;      // Path of each group (may be empty)
+    QString       mSeparator;
+    QHash<QString, QString> mGroups;  // Path of each group, by name
+    QHash<QString, int> mKeys; // Key to node
+    QSet<QString> mCollapsed;  // Keys of collapsed nodes (kept by build)
+    // Unions of children, by plan and node key
+    QHash<QPair<const vlePlan *, QString>, vlePlanIntervals> mAggregates;
+};
+
+#endif // VLEPLANTREE_H